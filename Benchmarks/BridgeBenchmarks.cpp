@@ -0,0 +1,352 @@
+// Benchmarks for the CJuceTracktion bridge layer.
+//
+// Usage: BridgeBenchmarks [--output results.json] [--samples <dir>] [--quick]
+//
+// Results are written as JSON ({ "results": [ { "name", "value", "unit" } ] }) so a CI
+// job can compare them against a stored baseline. Without --output the JSON is the only
+// thing on stdout; progress and engine logs go to stderr. Samples/*.wav are the fixtures.
+
+#include "AudioEngine.h"
+#include "MidiClipManager.h"
+#include "TrackManager.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+#ifndef SWIFTTRACKTIONKIT_SAMPLES_DIR
+#define SWIFTTRACKTIONKIT_SAMPLES_DIR "Samples"
+#endif
+
+namespace
+{
+  class Results
+  {
+  public:
+    void add(const juce::String &name, double value, const juce::String &unit)
+    {
+      auto *entry = new juce::DynamicObject();
+      entry->setProperty("name", name);
+      entry->setProperty("value", value);
+      entry->setProperty("unit", unit);
+      results.add(juce::var(entry));
+
+      std::cerr << name << ": " << value << " " << unit << std::endl;
+    }
+
+    juce::String toJson(bool quick) const
+    {
+      auto *root = new juce::DynamicObject();
+      root->setProperty("version", 1);
+      root->setProperty("timestamp", juce::Time::getCurrentTime().toISO8601(true));
+      root->setProperty("platform", juce::SystemStats::getOperatingSystemName());
+      root->setProperty("cpus", juce::SystemStats::getNumCpus());
+      root->setProperty("quick", quick);
+      root->setProperty("results", results);
+      return juce::JSON::toString(juce::var(root));
+    }
+
+  private:
+    juce::Array<juce::var> results;
+  };
+
+  template <typename Fn>
+  double timeMs(Fn &&fn)
+  {
+    const double start = juce::Time::getMillisecondCounterHiRes();
+    fn();
+    return juce::Time::getMillisecondCounterHiRes() - start;
+  }
+
+  double median(std::vector<double> values)
+  {
+    std::sort(values.begin(), values.end());
+    return values.empty() ? 0.0 : values[values.size() / 2];
+  }
+
+  // Lets async updates (graph rebuilds, proxies, loop sync) settle between measurements
+  void pumpMessages(int milliseconds = 50)
+  {
+    juce::MessageManager::getInstance()->runDispatchLoopUntil(milliseconds);
+  }
+
+  using EnginePtr = std::unique_ptr<AudioEngine>;
+
+  EnginePtr createEngine()
+  {
+    return EnginePtr(AudioEngine::create("Benchmark"));
+  }
+
+  std::unique_ptr<TrackManager> createTrackManager(AudioEngine &engine)
+  {
+    return std::unique_ptr<TrackManager>(TrackManager::create(engine.getEdit()));
+  }
+
+  std::unique_ptr<MidiClipManager> createMidiClipManager(AudioEngine &engine)
+  {
+    return std::unique_ptr<MidiClipManager>(MidiClipManager::create(engine.getEdit()));
+  }
+
+  void benchmarkEngineCreation(Results &results, bool quick)
+  {
+    results.add("engine.create.cold", timeMs([] { createEngine(); }), "ms");
+
+    std::vector<double> times;
+    for (int i = 0; i < (quick ? 3 : 10); ++i)
+      times.push_back(timeMs([] { createEngine(); }));
+
+    results.add("engine.create.warm", median(times), "ms");
+  }
+
+  void benchmarkTrackCreation(Results &results, bool quick)
+  {
+    for (int count : {10, 100, quick ? 200 : 500})
+    {
+      {
+        auto engine = createEngine();
+        auto tracks = createTrackManager(*engine);
+
+        const double ms = timeMs([&]
+                                 {
+                                   for (int i = 0; i < count; ++i)
+                                     tracks->createAudioTrack("Track " + std::to_string(i));
+                                 });
+
+        results.add("tracks.create." + juce::String(count), ms, "ms");
+      }
+
+      {
+        auto engine = createEngine();
+        auto tracks = createTrackManager(*engine);
+
+        const double ms = timeMs([&]
+                                 {
+                                   tracks->beginBatch();
+                                   for (int i = 0; i < count; ++i)
+                                     tracks->createAudioTrack("Track " + std::to_string(i));
+                                   tracks->commitBatch();
+                                 });
+
+        results.add("tracks.create_batched." + juce::String(count), ms, "ms");
+      }
+    }
+  }
+
+  void benchmarkNotes(Results &results, bool quick)
+  {
+    for (int count : {1000, 10000, 100000})
+    {
+      if (quick && count > 10000)
+        break;
+
+      auto engine = createEngine();
+      auto clips = createMidiClipManager(*engine);
+      const int trackID = createTrackManager(*engine)->createAudioTrack("Notes");
+      const int clipID = clips->createMidiClip(trackID, "Notes", 0.0, 4.0);
+
+      const double addMs = timeMs([&]
+                                  {
+                                    clips->beginBatch();
+                                    for (int i = 0; i < count; ++i)
+                                      clips->addNote(clipID, MidiNote((uint8_t)(36 + i % 48), i * 0.25, 0.25, 100));
+                                    clips->commitBatch();
+                                  });
+
+      size_t numRead = 0;
+      const double getMs = timeMs([&] { numRead = clips->getNotes(clipID).size(); });
+
+      if ((int)numRead != count)
+        std::cerr << "getNotes returned " << numRead << " of " << count << " notes" << std::endl;
+
+      results.add("notes.add." + juce::String(count), addMs, "ms");
+      results.add("notes.get." + juce::String(count), getMs, "ms");
+    }
+  }
+
+  // Notes played into the virtual MIDI input from a thread of their own, as a device's
+  // MIDI thread would, and merged into the clip when the take ends
+  void benchmarkMidiRecording(Results &results, bool quick)
+  {
+    const int count = quick ? 1000 : 2000;
+    auto engine = createEngine();
+    auto clips = createMidiClipManager(*engine);
+    const int trackID = createTrackManager(*engine)->createAudioTrack("Recording");
+    const int clipID = clips->createMidiClip(trackID, "Take", 0.0, 4.0);
+
+    engine->startMidiRecording(clipID, false);
+
+    const double sendMs = timeMs([&]
+                                 {
+                                   std::thread sender([&]
+                                                      {
+                                                        for (int i = 0; i < count; ++i)
+                                                        {
+                                                          const int note = 36 + i % 48;
+                                                          engine->sendVirtualNoteOn(1, note, 100, i * 0.125);
+                                                          engine->sendVirtualNoteOff(1, note, i * 0.125 + 0.1);
+                                                        }
+                                                      });
+                                   sender.join();
+                                 });
+
+    int numRecorded = 0;
+    const double mergeMs = timeMs([&] { numRecorded = engine->stopMidiRecording(); });
+
+    if (numRecorded != count)
+      std::cerr << "Recorded " << numRecorded << " of " << count << " notes ("
+                << engine->getMidiRecordingStats().eventsDropped << " events dropped)" << std::endl;
+
+    results.add("midi_record.send_per_event", sendMs * 1000.0 / (2 * count), "us");
+    results.add("midi_record.merge." + juce::String(count), mergeMs, "ms");
+  }
+
+  SamplerPluginBuilder createBuilder(const juce::Array<juce::File> &samples)
+  {
+    SamplerPluginBuilder builder;
+    int note = 36;
+
+    for (const auto &file : samples)
+      builder.addSample(file.getFullPathName().toStdString(), note++);
+
+    return builder;
+  }
+
+  void benchmarkSamplerBuild(Results &results, const juce::Array<juce::File> &samples, bool quick)
+  {
+    auto engine = createEngine();
+    auto tracks = createTrackManager(*engine);
+    const auto builder = createBuilder(samples);
+    const int rounds = quick ? 3 : 10;
+
+    // The first build decodes the files, later ones hit the sample cache
+    std::vector<double> sampler, drumSampler;
+
+    for (int i = 0; i < rounds; ++i)
+    {
+      const int trackID = tracks->createAudioTrack("Sampler " + std::to_string(i));
+      sampler.push_back(timeMs([&] { tracks->createSamplerPluginWithBuilder(trackID, builder); }));
+
+      const int drumTrackID = tracks->createAudioTrack("Drums " + std::to_string(i));
+      drumSampler.push_back(timeMs([&] { tracks->createDrumSamplerPluginWithBuilder(drumTrackID, builder); }));
+    }
+
+    results.add("sampler.build.first", sampler.front(), "ms");
+    results.add("sampler.build.median", median(sampler), "ms");
+    results.add("drum_sampler.build.first", drumSampler.front(), "ms");
+    results.add("drum_sampler.build.median", median(drumSampler), "ms");
+  }
+
+  // A drum pattern on the high-performance sampler plus the fixtures as audio clips
+  void buildExportEdit(AudioEngine &engine, const juce::Array<juce::File> &samples, double lengthInBeats)
+  {
+    auto tracks = createTrackManager(engine);
+    auto clips = createMidiClipManager(engine);
+
+    tracks->beginBatch();
+
+    const int drumTrackID = tracks->createAudioTrack("Drums");
+    tracks->createDrumSamplerPluginWithBuilder(drumTrackID, createBuilder(samples));
+
+    for (const auto &file : samples)
+    {
+      const int trackID = tracks->createAudioTrack(file.getFileNameWithoutExtension().toStdString());
+      tracks->addAudioClip(trackID, file.getFullPathName().toStdString(), 0.0, 1.0);
+    }
+
+    tracks->commitBatch();
+
+    auto *edit = engine.getEdit();
+    auto *drumTrack = dynamic_cast<te::AudioTrack *>(te::findTrackForID(*edit, te::EditItemID::fromRawID(drumTrackID)));
+    auto *clip = drumTrack->insertNewClip(te::TrackItem::Type::midi, "Pattern",
+                                          te::TimeRange(te::TimePosition(), te::toTime(te::BeatPosition::fromBeats(lengthInBeats),
+                                                                                        edit->tempoSequence)),
+                                          nullptr);
+
+    clips->beginBatch();
+    for (int step = 0; step < (int)(lengthInBeats * 4); ++step)
+      clips->addNote(clip->itemID.getRawID(), MidiNote((uint8_t)(36 + step % samples.size()), step * 0.25, 0.25, 100));
+    clips->commitBatch();
+  }
+
+  void benchmarkExport(Results &results, const juce::Array<juce::File> &samples, bool quick)
+  {
+    auto engine = createEngine();
+    buildExportEdit(*engine, samples, quick ? 32.0 : 256.0);
+    pumpMessages();
+
+    const double editSeconds = engine->getEdit()->getLength().inSeconds();
+    auto directory = juce::File::createTempFile("bridge-benchmarks");
+    directory.createDirectory();
+
+    const double exportMs = timeMs([&]
+                                   { engine->exportAudio(directory.getChildFile("export.wav").getFullPathName().toStdString(),
+                                                         nullptr); });
+
+    const double chunkedMs = timeMs([&]
+                                    { engine->exportAudioChunked(directory.getChildFile("chunked.wav").getFullPathName().toStdString(),
+                                                                 0, 2.0, nullptr); });
+
+    directory.deleteRecursively();
+
+    results.add("export.edit_length", editSeconds, "s");
+    results.add("export.sequential", exportMs, "ms");
+    results.add("export.sequential.realtime_multiple", editSeconds * 1000.0 / juce::jmax(1.0, exportMs), "x");
+    results.add("export.chunked", chunkedMs, "ms");
+    results.add("export.chunked.realtime_multiple", editSeconds * 1000.0 / juce::jmax(1.0, chunkedMs), "x");
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+  juce::StringArray args;
+  for (int i = 1; i < argc; ++i)
+    args.add(argv[i]);
+
+  const bool quick = args.contains("--quick");
+  const int outputIndex = args.indexOf("--output");
+  const int samplesIndex = args.indexOf("--samples");
+
+  const juce::File samplesDir = samplesIndex >= 0 ? juce::File::getCurrentWorkingDirectory().getChildFile(args[samplesIndex + 1])
+                                                  : juce::File(SWIFTTRACKTIONKIT_SAMPLES_DIR);
+  auto samples = samplesDir.findChildFiles(juce::File::findFiles, false, "*.wav");
+  samples.sort();
+
+  if (samples.isEmpty())
+  {
+    std::cerr << "No .wav fixtures in " << samplesDir.getFullPathName().toStdString() << std::endl;
+    return 1;
+  }
+
+  // The engine logs to std::cout, which must only carry the JSON
+  auto *stdoutBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+
+  Results results;
+  benchmarkEngineCreation(results, quick);
+  benchmarkTrackCreation(results, quick);
+  benchmarkNotes(results, quick);
+  benchmarkMidiRecording(results, quick);
+  benchmarkSamplerBuild(results, samples, quick);
+  benchmarkExport(results, samples, quick);
+
+  std::cout.flush();
+  std::cout.rdbuf(stdoutBuffer);
+
+  const auto json = results.toJson(quick);
+
+  if (outputIndex >= 0)
+  {
+    juce::File output = juce::File::getCurrentWorkingDirectory().getChildFile(args[outputIndex + 1]);
+    if (!output.replaceWithText(json))
+    {
+      std::cerr << "Cannot write " << output.getFullPathName().toStdString() << std::endl;
+      return 1;
+    }
+  }
+  else
+  {
+    std::cout << json << std::endl;
+  }
+
+  return 0;
+}
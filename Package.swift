@@ -128,8 +128,30 @@ let cjuceTracktionCxxSettings: [CXXSetting] = [
 
 let cjuceTracktionSources: [String] = [
     "AudioEngine/AudioEngine.cpp",
+    "AudioRecorder/AudioRecorder.cpp",
+    "ChunkedRenderer/ChunkedRenderer.cpp",
+    "DrumSamplerPlugin/DrumSamplerPlugin.cpp",
+    "EditAutosaver/EditAutosaver.cpp",
+    "EditSnapshot/EditSnapshot.cpp",
+    "GraphRebuildTimer/GraphRebuildTimer.cpp",
+    "LoopSwitcher/LoopSwitcher.cpp",
+    "LoudnessMeter/LoudnessMeter.cpp",
+    "MemoryAccountant/MemoryAccountant.cpp",
+    "MeterPlugin/MeterPlugin.cpp",
     "MidiClipManager/MidiClipManager.cpp",
+    "MidiRecorder/MidiRecorder.cpp",
+    "MultiFormatExporter/MultiFormatExporter.cpp",
+    "OscServer/OscServer.cpp",
     "TrackManager/TrackManager.cpp",
+    "PresetRegistry/PresetRegistry.cpp",
+    "RealtimeSafetyChecker/RealtimeSafetyChecker.cpp",
+    "RenderCache/RenderCache.cpp",
+    "SampleCache/SampleCache.cpp",
+    "TimeStretchProxies/TimeStretchProxies.cpp",
+    "TrackFreezer/TrackFreezer.cpp",
+    "TransportProbe/TransportProbe.cpp",
+    "TransportScheduler/TransportScheduler.cpp",
+    "TruePeakLimiter/TruePeakLimiter.cpp",
     "JuceLibraryCode/include_juce_audio_basics.cpp",
     "JuceLibraryCode/include_juce_audio_devices.cpp",
     "JuceLibraryCode/include_juce_audio_formats.cpp",
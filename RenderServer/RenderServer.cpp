@@ -0,0 +1,489 @@
+// Headless render worker: builds each project through the bridge managers and renders it.
+//
+// Usage: RenderServer [--jobs N] [--threads N] [--output-dir <dir>] [--stats stats.json]
+//                     [--overwrite] [project.json ...]
+//
+// With no project files, project paths are read from stdin one per line, so a dispatcher
+// can feed the worker; each project starts as soon as its line arrives. Edits are built on the message thread while up to --jobs earlier
+// projects render on worker threads, each with its own engine; --threads is the graph
+// thread count per engine.
+//
+// Project description (paths are relative to the project file):
+//
+// {
+//   "tempo": 90,
+//   "output": "mix.wav",
+//   "kits": {
+//     "boombap": { "type": "drum", "maxPolyphony": 32,
+//                  "samples": [ { "file": "kick.wav", "note": 36, "choke": 0 } ] }
+//   },
+//   "tracks": [
+//     { "name": "Drums", "kit": "boombap",
+//       "midiClips": [ { "startBar": 0, "lengthInBars": 32,
+//                        "notes": [ { "note": 36, "startBeat": 0, "lengthInBeats": 0.5, "velocity": 110 } ] } ] },
+//     { "name": "Loop",
+//       "audioClips": [ { "file": "loop.wav", "startBar": 0, "lengthInBars": 16, "bpm": 90 } ] }
+//   ]
+// }
+//
+// Kits are "drum" (DrumSamplerPlugin) or "sampler" (te::SamplerPlugin). Positions and
+// lengths are passed to TrackManager and MidiClipManager as they are.
+//
+// Throughput is printed per job and in total; --stats also writes it as JSON.
+
+#include "AudioEngine.h"
+#include "MidiClipManager.h"
+#include "TrackManager.h"
+#include <atomic>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+  struct Options
+  {
+    int jobs = 1;
+    int threadsPerJob = 1;
+    juce::File outputDirectory;
+    bool overwrite = false;
+  };
+
+  struct Job
+  {
+    juce::File project;
+    juce::File output;
+    std::unique_ptr<AudioEngine> engine;
+    std::unique_ptr<TrackManager> tracks;
+    std::unique_ptr<MidiClipManager> clips;
+
+    int numTracks = 0;
+    int numNotes = 0;
+    double buildMs = 0.0;
+    double renderMs = 0.0;
+    double editSeconds = 0.0;
+
+    bool ok = false;
+    juce::String error;
+    std::atomic<bool> finished{false};
+
+    // The managers follow the engine's edit, so they go first
+    void release()
+    {
+      clips.reset();
+      tracks.reset();
+      engine.reset();
+    }
+  };
+
+  template <typename Fn>
+  double timeMs(Fn &&fn)
+  {
+    const double start = juce::Time::getMillisecondCounterHiRes();
+    fn();
+    return juce::Time::getMillisecondCounterHiRes() - start;
+  }
+
+  std::string path(const juce::File &base, const juce::var &relative)
+  {
+    return base.getChildFile(relative.toString()).getFullPathName().toStdString();
+  }
+
+  double property(const juce::var &object, const char *name, double fallback)
+  {
+    return object.hasProperty(name) ? (double)object[name] : fallback;
+  }
+
+  SamplerPluginBuilder createBuilder(const juce::var &kit, const juce::File &base)
+  {
+    SamplerPluginBuilder builder;
+    builder.setMaxPolyphony((int)property(kit, "maxPolyphony", 32));
+
+    if (auto *samples = kit["samples"].getArray())
+      for (const auto &sample : *samples)
+        builder.addSample(path(base, sample["file"]), (int)sample["note"], (int)property(sample, "choke", 0));
+
+    return builder;
+  }
+
+  bool buildEdit(Job &job, const juce::var &project)
+  {
+    const auto base = job.project.getParentDirectory();
+    job.tracks.reset(TrackManager::create(job.engine->getEdit()));
+    job.clips.reset(MidiClipManager::create(job.engine->getEdit()));
+    auto &tracks = *job.tracks;
+    auto &clips = *job.clips;
+
+    if (project.hasProperty("tempo"))
+      job.engine->setTempo((double)project["tempo"]);
+
+    // The whole project is one batch, so the graph is built once at the end
+    tracks.beginBatch();
+    clips.beginBatch();
+
+    if (auto *trackList = project["tracks"].getArray())
+    {
+      for (const auto &track : *trackList)
+      {
+        const int trackID = tracks.createAudioTrack(track["name"].toString().toStdString());
+        if (trackID < 0)
+        {
+          job.error = "cannot create track " + track["name"].toString();
+          break;
+        }
+
+        ++job.numTracks;
+
+        if (track.hasProperty("kit"))
+        {
+          const auto kit = project["kits"][juce::Identifier(track["kit"].toString())];
+          if (!kit.isObject())
+          {
+            job.error = "no kit named " + track["kit"].toString();
+            break;
+          }
+
+          if (kit["type"].toString() == "sampler")
+            tracks.createSamplerPluginWithBuilder(trackID, createBuilder(kit, base));
+          else
+            tracks.createDrumSamplerPluginWithBuilder(trackID, createBuilder(kit, base));
+        }
+
+        if (auto *audioClips = track["audioClips"].getArray())
+          for (const auto &clip : *audioClips)
+            if (!tracks.addAudioClip(trackID, path(base, clip["file"]), property(clip, "startBar", 0.0),
+                                     property(clip, "lengthInBars", 1.0), property(clip, "bpm", 0.0)))
+              job.error = "cannot add audio clip " + clip["file"].toString();
+
+        if (auto *midiClips = track["midiClips"].getArray())
+        {
+          for (const auto &clip : *midiClips)
+          {
+            const int clipID = tracks.addMidiClip(trackID, property(clip, "startBar", 0.0),
+                                                  property(clip, "lengthInBars", 1.0));
+
+            if (auto *notes = clip["notes"].getArray())
+              for (const auto &note : *notes)
+                if (clips.addNote(clipID, MidiNote((uint8_t)(int)note["note"], property(note, "startBeat", 0.0),
+                                                   property(note, "lengthInBeats", 0.25),
+                                                   (uint8_t)(int)property(note, "velocity", 100))))
+                  ++job.numNotes;
+          }
+        }
+      }
+    }
+
+    clips.commitBatch();
+    tracks.commitBatch();
+
+    job.editSeconds = job.engine->getEdit()->getLength().inSeconds();
+    if (job.error.isEmpty() && job.editSeconds <= 0.0)
+      job.error = "project is empty";
+
+    return job.error.isEmpty();
+  }
+
+  // Runs on the message thread, so rendering starts as soon as a worker is free
+  bool prepareJob(Job &job, const Options &options)
+  {
+    const auto project = juce::JSON::parse(job.project);
+    if (!project.isObject())
+    {
+      job.error = "cannot parse " + job.project.getFullPathName();
+      return false;
+    }
+
+    const auto outputName = project.hasProperty("output") ? project["output"].toString()
+                                                          : job.project.getFileNameWithoutExtension() + ".wav";
+    job.output = job.project.getParentDirectory().getChildFile(outputName);
+
+    if (options.outputDirectory != juce::File())
+      job.output = options.outputDirectory.getChildFile(job.output.getFileName());
+
+    if (job.output.exists() && !(options.overwrite && job.output.deleteFile()))
+    {
+      job.error = job.output.getFullPathName() + " already exists";
+      return false;
+    }
+
+    AudioEngineOptions engineOptions;
+    engineOptions.numAudioThreads = options.threadsPerJob;
+
+    try
+    {
+      job.buildMs = timeMs([&]
+                           {
+                             job.engine.reset(AudioEngine::create(job.project.getFileNameWithoutExtension().toStdString(),
+                                                                  engineOptions));
+                             buildEdit(job, project);
+                           });
+    }
+    catch (const std::exception &e)
+    {
+      job.error = juce::String("cannot create engine: ") + e.what();
+    }
+
+    return job.error.isEmpty();
+  }
+
+  class Stats
+  {
+  public:
+    void add(const Job &job)
+    {
+      auto *entry = new juce::DynamicObject();
+      entry->setProperty("project", job.project.getFullPathName());
+      entry->setProperty("output", job.output.getFullPathName());
+      entry->setProperty("ok", job.ok);
+      entry->setProperty("error", job.error);
+      entry->setProperty("tracks", job.numTracks);
+      entry->setProperty("notes", job.numNotes);
+      entry->setProperty("build_ms", job.buildMs);
+      entry->setProperty("render_ms", job.renderMs);
+      entry->setProperty("audio_seconds", job.editSeconds);
+      entry->setProperty("realtime_multiple", realtimeMultiple(job.editSeconds, job.renderMs));
+      jobs.add(juce::var(entry));
+
+      if (job.ok)
+      {
+        ++succeeded;
+        audioSeconds += job.editSeconds;
+        std::cout << "Rendered " << job.output.getFullPathName().toStdString() << ": " << job.editSeconds
+                  << " s of audio, built in " << job.buildMs << " ms, rendered in " << job.renderMs << " ms ("
+                  << realtimeMultiple(job.editSeconds, job.renderMs) << "x realtime)" << std::endl;
+      }
+      else
+      {
+        ++failed;
+        std::cerr << "Failed " << job.project.getFullPathName().toStdString() << ": " << job.error.toStdString()
+                  << std::endl;
+      }
+    }
+
+    bool allSucceeded() const { return failed == 0; }
+
+    juce::String summarise(const Options &options, double wallMs) const
+    {
+      std::cout << succeeded << " rendered, " << failed << " failed in " << wallMs / 1000.0 << " s: "
+                << audioSeconds << " s of audio at " << realtimeMultiple(audioSeconds, wallMs) << "x realtime, "
+                << succeeded * 60000.0 / juce::jmax(1.0, wallMs) << " jobs per minute" << std::endl;
+
+      auto *root = new juce::DynamicObject();
+      root->setProperty("version", 1);
+      root->setProperty("timestamp", juce::Time::getCurrentTime().toISO8601(true));
+      root->setProperty("platform", juce::SystemStats::getOperatingSystemName());
+      root->setProperty("cpus", juce::SystemStats::getNumCpus());
+      root->setProperty("concurrent_jobs", options.jobs);
+      root->setProperty("threads_per_job", options.threadsPerJob);
+      root->setProperty("succeeded", succeeded);
+      root->setProperty("failed", failed);
+      root->setProperty("wall_seconds", wallMs / 1000.0);
+      root->setProperty("audio_seconds", audioSeconds);
+      root->setProperty("realtime_multiple", realtimeMultiple(audioSeconds, wallMs));
+      root->setProperty("jobs_per_minute", succeeded * 60000.0 / juce::jmax(1.0, wallMs));
+      root->setProperty("jobs", jobs);
+      return juce::JSON::toString(juce::var(root));
+    }
+
+  private:
+    static double realtimeMultiple(double audioSeconds, double ms)
+    {
+      return audioSeconds * 1000.0 / juce::jmax(1.0, ms);
+    }
+
+    juce::Array<juce::var> jobs;
+    int succeeded = 0, failed = 0;
+    double audioSeconds = 0.0;
+  };
+
+  // Project paths from the command line, or from stdin as the lines arrive. stdin is read
+  // on its own thread so the message thread keeps collecting renders in between.
+  class ProjectSource
+  {
+  public:
+    explicit ProjectSource(const juce::StringArray &arguments)
+    {
+      projects.insert(projects.end(), arguments.begin(), arguments.end());
+      closed = !projects.empty();
+
+      if (!closed)
+        reader = std::thread([this] { readStdin(); });
+    }
+
+    ~ProjectSource()
+    {
+      if (reader.joinable())
+        reader.join();
+    }
+
+    /// Doesn't wait: false when no project is ready yet
+    bool next(juce::String &project)
+    {
+      std::lock_guard<std::mutex> sl(lock);
+      if (projects.empty())
+        return false;
+
+      project = projects.front();
+      projects.pop_front();
+      return true;
+    }
+
+    bool isExhausted() const
+    {
+      std::lock_guard<std::mutex> sl(lock);
+      return closed && projects.empty();
+    }
+
+  private:
+    void readStdin()
+    {
+      std::string line;
+
+      while (std::getline(std::cin, line))
+      {
+        const auto project = juce::String(line).trim();
+        if (project.isEmpty())
+          continue;
+
+        std::lock_guard<std::mutex> sl(lock);
+        projects.push_back(project);
+      }
+
+      std::lock_guard<std::mutex> sl(lock);
+      closed = true;
+    }
+
+    mutable std::mutex lock;
+    std::deque<juce::String> projects;
+    bool closed = false;
+    std::thread reader;
+  };
+
+  // Keeps up to options.jobs renders running, building the next edit while they do.
+  // Engines are created and deleted on the message thread, which keeps dispatching while
+  // the workers render.
+  void renderAll(ProjectSource &projects, const Options &options, Stats &stats)
+  {
+    juce::ThreadPool pool(options.jobs);
+    std::vector<std::unique_ptr<Job>> rendering;
+
+    auto collectFinished = [&]
+    {
+      juce::MessageManager::getInstance()->runDispatchLoopUntil(10);
+
+      for (auto it = rendering.begin(); it != rendering.end();)
+      {
+        if (!(*it)->finished.load())
+        {
+          ++it;
+          continue;
+        }
+
+        auto &job = **it;
+        job.release();
+        job.ok = job.output.getSize() > 0;
+        if (!job.ok)
+          job.error = "render produced no output";
+
+        stats.add(job);
+        it = rendering.erase(it);
+      }
+    };
+
+    juce::String project;
+
+    while (!projects.isExhausted())
+    {
+      if (!projects.next(project))
+      {
+        collectFinished();
+        continue;
+      }
+
+      while ((int)rendering.size() >= options.jobs)
+        collectFinished();
+
+      auto job = std::make_unique<Job>();
+      job->project = juce::File::getCurrentWorkingDirectory().getChildFile(project);
+
+      if (!prepareJob(*job, options))
+      {
+        job->release();
+        stats.add(*job);
+        continue;
+      }
+
+      auto *renderJob = job.get();
+      pool.addJob([renderJob]
+                  {
+                    renderJob->renderMs = timeMs([renderJob]
+                                                 { renderJob->engine->exportAudio(renderJob->output.getFullPathName().toStdString(),
+                                                                                  nullptr); });
+                    renderJob->finished = true;
+                  });
+
+      rendering.push_back(std::move(job));
+    }
+
+    while (!rendering.empty())
+      collectFinished();
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+  Options options;
+  juce::String statsPath;
+  juce::StringArray projects;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const juce::String arg(argv[i]);
+    const bool hasValue = i + 1 < argc;
+
+    if (arg == "--jobs" && hasValue)
+      options.jobs = juce::jmax(1, juce::String(argv[++i]).getIntValue());
+    else if (arg == "--threads" && hasValue)
+      options.threadsPerJob = juce::jmax(1, juce::String(argv[++i]).getIntValue());
+    else if (arg == "--output-dir" && hasValue)
+      options.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+    else if (arg == "--stats" && hasValue)
+      statsPath = argv[++i];
+    else if (arg == "--overwrite")
+      options.overwrite = true;
+    else if (arg.startsWith("--"))
+    {
+      std::cerr << "Unknown option " << arg.toStdString() << std::endl;
+      return 2;
+    }
+    else
+      projects.add(arg);
+  }
+
+  if (options.outputDirectory != juce::File() && !options.outputDirectory.createDirectory())
+  {
+    std::cerr << "Cannot create " << options.outputDirectory.getFullPathName().toStdString() << std::endl;
+    return 1;
+  }
+
+  ProjectSource source(projects);
+  Stats stats;
+  const double wallMs = timeMs([&] { renderAll(source, options, stats); });
+
+  const auto json = stats.summarise(options, wallMs);
+
+  if (statsPath.isNotEmpty())
+  {
+    juce::File output = juce::File::getCurrentWorkingDirectory().getChildFile(statsPath);
+    if (!output.replaceWithText(json))
+    {
+      std::cerr << "Cannot write " << output.getFullPathName().toStdString() << std::endl;
+      return 1;
+    }
+  }
+
+  return stats.allSucceeded() ? 0 : 1;
+}
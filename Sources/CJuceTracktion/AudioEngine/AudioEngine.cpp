@@ -1,4 +1,23 @@
 #include "AudioEngine.h"
+#include "BridgeEngineBehaviour.h"
+#include "ChunkedRenderer.h"
+#include "DrumSamplerPlugin.h"
+#include "EditAutosaver.h"
+#include "EditSnapshot.h"
+#include "GraphRebuildTimer.h"
+#include "LoopSwitcher.h"
+#include "MemoryAccountant.h"
+#include "MeterPlugin.h"
+#include "MidiRecorder.h"
+#include "OscServer.h"
+#include "RealtimeSafetyChecker.h"
+#include "RenderCache.h"
+#include "TimeStretchProxies.h"
+#include "TrackFreezer.h"
+#include "TransportProbe.h"
+#include "TransportScheduler.h"
+#include "TruePeakLimiter.h"
+#include <algorithm>
 #include <cstdio>
 
 class ProgressRunner : public juce::ThreadPoolJob
@@ -25,21 +44,61 @@ private:
   void (*progressCallback)(float);
 };
 
+namespace
+{
+  // Meters go in before the edit plays, so reading a level never changes it. Nothing has
+  // been done to a new or freshly loaded edit yet, so there's nothing to undo either.
+  void addMeters(te::Edit &edit)
+  {
+    MeterPlugin::addTo(edit, edit.getMasterPluginList());
+
+    for (auto *track : te::getAudioTracks(edit))
+      MeterPlugin::addTo(edit, track->pluginList);
+
+    edit.getUndoManager().clearUndoHistory();
+  }
+}
+
 AudioEngine *AudioEngine::create(const std::string &name)
 {
-  return new AudioEngine(name);
+  return new AudioEngine(name, AudioEngineOptions());
+}
+
+AudioEngine *AudioEngine::create(const std::string &name, const AudioEngineOptions &options)
+{
+  return new AudioEngine(name, options);
 }
 
-AudioEngine::AudioEngine(const std::string &name)
+AudioEngine::AudioEngine(const std::string &name, const AudioEngineOptions &options)
 {
   try
   {
-    engine = std::make_unique<te::Engine>(name);
+    if (options.threadPoolStrategy >= 0)
+      te::EditPlaybackContext::setThreadPoolStrategy(options.threadPoolStrategy);
+
+    engine = std::make_unique<te::Engine>(name, nullptr, std::make_unique<BridgeEngineBehaviour>(options));
     std::cout << "Engine created." << std::endl;
 
-    AudioEngineHelpers::createTempProject(*engine);
+    engine->getPluginManager().createBuiltInType<DrumSamplerPlugin>();
+    engine->getPluginManager().createBuiltInType<MeterPlugin>();
+    engine->getPluginManager().createBuiltInType<OscLiveInputPlugin>();
+    engine->getPluginManager().createBuiltInType<TransportProbePlugin>();
+    engine->getPluginManager().createBuiltInType<TransportGatePlugin>();
+    transportProbe = std::make_unique<TransportProbe>(*engine);
+    graphRebuildTimer = std::make_unique<GraphRebuildTimer>(*engine);
+
+    if (options.realtimeSafetyChecks)
+      realtimeChecker = std::make_unique<RealtimeSafetyChecker>(*engine);
 
-    std::cout << "Temp project created." << std::endl;
+    // After the checker, which moves tracktion's device callback, so this one still follows it
+    transportScheduler = std::make_unique<TransportScheduler>(*engine);
+
+    // The edit below doesn't belong to a project, so the temp project only costs disk I/O
+    if (!options.inMemoryProject)
+    {
+      AudioEngineHelpers::createTempProject(*engine);
+      std::cout << "Temp project created." << std::endl;
+    }
 
     edit = std::make_unique<te::Edit>(*engine, te::Edit::EditRole::forEditing);
     std::cout << "Edit created." << std::endl;
@@ -47,6 +106,7 @@ AudioEngine::AudioEngine(const std::string &name)
     // Ensure we have at least one audio track for proper audio routing
     edit->ensureNumberOfAudioTracks(1);
     std::cout << "Audio tracks: " << te::getAudioTracks(*edit).size() << std::endl;
+    addMeters(*edit);
     for (auto &midiIn : engine->getDeviceManager().getMidiInDevices())
     {
       midiIn->setEnabled(true);
@@ -66,6 +126,21 @@ AudioEngine::AudioEngine(const std::string &name)
     // Set click track volume to maximum
     edit->setClickTrackVolume(1.0f);
     std::cout << "Click track volume set to: " << edit->getClickTrackVolume() << std::endl;
+
+    transportProbe->attach(*edit);
+    transportScheduler->attach(*edit);
+    graphRebuildTimer->attach(*edit);
+
+    // Proxies are only a cache; without them clips keep stretching in real time
+    if (BridgeEngineBehaviour::canWriteCacheFiles(*engine))
+      stretchProxies = std::make_unique<TimeStretchProxies>(*edit);
+
+    loopSwitcher = std::make_unique<LoopSwitcher>(*edit);
+    midiRecorder = std::make_unique<MidiRecorder>(*edit);
+    memoryAccountant = std::make_unique<MemoryAccountant>(*edit);
+
+    if (realtimeChecker != nullptr)
+      realtimeChecker->includeLaterCallbacks();
   }
   catch (const std::exception &e)
   {
@@ -75,7 +150,21 @@ AudioEngine::AudioEngine(const std::string &name)
   }
 }
 
-AudioEngine::~AudioEngine() = default;
+AudioEngine::~AudioEngine()
+{
+  // Managers can outlive the engine; they're left without an edit
+  static_cast<BridgeEngineBehaviour &>(engine->getEngineBehaviour()).replaceEdit(nullptr);
+  loopSwitcher.reset();
+  midiRecorder.reset();
+  autosaver.reset();
+  renderCache.reset();
+  stretchProxies.reset();
+  memoryAccountant.reset();
+  realtimeChecker.reset();
+  graphRebuildTimer->detach();
+  transportScheduler->detach();
+  transportProbe->detach();
+}
 
 void AudioEngine::startPlayback()
 {
@@ -86,6 +175,46 @@ void AudioEngine::stopPlayback()
 {
   edit->getTransport().stop(false, false);
 }
+
+bool AudioEngine::startAtHostTime(int64_t hostTimeNs, double lookaheadSeconds)
+{
+  return transportScheduler->startAt(hostTimeNs, true, lookaheadSeconds);
+}
+
+bool AudioEngine::startAtSample(int64_t deviceSample, double lookaheadSeconds)
+{
+  return transportScheduler->startAt(deviceSample, false, lookaheadSeconds);
+}
+
+bool AudioEngine::stopAtHostTime(int64_t hostTimeNs, double lookaheadSeconds)
+{
+  return transportScheduler->stopAt(hostTimeNs, true, lookaheadSeconds);
+}
+
+bool AudioEngine::stopAtSample(int64_t deviceSample, double lookaheadSeconds)
+{
+  return transportScheduler->stopAt(deviceSample, false, lookaheadSeconds);
+}
+
+void AudioEngine::cancelScheduledTransport()
+{
+  transportScheduler->cancel();
+}
+
+bool AudioEngine::hasScheduledTransport() const
+{
+  return transportScheduler->isPending();
+}
+
+int64_t AudioEngine::getDeviceSamplePosition() const
+{
+  return transportScheduler->getDeviceSamplePosition();
+}
+
+int64_t AudioEngine::getHostTimeNs() const
+{
+  return TransportScheduler::getHostTimeNs();
+}
 void AudioEngine::setTempo(double bpm)
 {
   edit->tempoSequence.getTempos()[0]->setBpm(bpm);
@@ -101,6 +230,68 @@ bool AudioEngine::isPlaying() const
   return edit->getTransport().isPlaying();
 }
 
+TransportSnapshot AudioEngine::getTransportSnapshot() const
+{
+  return transportProbe->read();
+}
+
+bool AudioEngine::queueLoopRange(double startSeconds, double endSeconds, double quantiseBeats)
+{
+  return loopSwitcher->queue(te::TimeRange(te::TimePosition::fromSeconds(startSeconds),
+                                           te::TimePosition::fromSeconds(endSeconds)),
+                             quantiseBeats);
+}
+
+void AudioEngine::cancelQueuedLoopRange()
+{
+  loopSwitcher->cancel();
+}
+
+bool AudioEngine::hasQueuedLoopRange() const
+{
+  return loopSwitcher->isPending();
+}
+
+bool AudioEngine::startMidiRecording(int clipID, bool incremental)
+{
+  return midiRecorder->start(clipID, incremental);
+}
+
+int AudioEngine::stopMidiRecording()
+{
+  return midiRecorder->stop();
+}
+
+bool AudioEngine::isRecordingMidi() const
+{
+  return midiRecorder->isRecording();
+}
+
+MidiRecordingStats AudioEngine::getMidiRecordingStats() const
+{
+  return midiRecorder->getStats();
+}
+
+void AudioEngine::resetMidiRecordingStats()
+{
+  midiRecorder->resetStats();
+}
+
+void AudioEngine::sendVirtualNoteOn(int channel, int noteNumber, int velocity, double atSeconds)
+{
+  midiRecorder->injectMessage(juce::MidiMessage::noteOn(channel, noteNumber, (juce::uint8)velocity), atSeconds);
+}
+
+void AudioEngine::sendVirtualNoteOff(int channel, int noteNumber, double atSeconds)
+{
+  midiRecorder->injectMessage(juce::MidiMessage::noteOff(channel, noteNumber), atSeconds);
+}
+
+void AudioEngine::sendVirtualController(int channel, int controller, int value, double atSeconds)
+{
+  midiRecorder->injectMessage(juce::MidiMessage::controllerEvent(channel, controller, value), atSeconds);
+}
+
 void AudioEngine::exportAudio(const std::string &filePath, void (*onprogresschange)(float))
 {
   try
@@ -151,6 +342,118 @@ void AudioEngine::exportAudio(const std::string &filePath, void (*onprogresschan
   }
 }
 
+bool AudioEngine::exportNormalisedAudio(const std::string &filePath, double targetLufs, double truePeakCeilingDb,
+                                        void (*onprogresschange)(float))
+{
+  juce::File outputFile(filePath);
+
+  if (outputFile.exists() || !te::Renderer::checkTargetFile(*engine, outputFile))
+  {
+    std::cerr << "Export failed: Invalid target file" << std::endl;
+    return false;
+  }
+
+  if (renderCache == nullptr)
+    renderCache = std::make_unique<RenderCache>(*edit);
+
+  // Pass 1: render (or reuse) the float mix and measure it; nothing is written to the target
+  auto mixFile = renderCache->getOrRender(onprogresschange);
+  auto analysis = renderCache->getAnalysis();
+  auto reader = RenderCache::createReader(mixFile);
+
+  if (reader == nullptr || !analysis.valid)
+  {
+    std::cerr << "Export failed: could not render the mix" << std::endl;
+    return false;
+  }
+
+  const bool isSilent = analysis.integratedLufs <= LoudnessMeter::silenceDb;
+  const float gain = isSilent ? 1.0f : juce::Decibels::decibelsToGain((float)(targetLufs - analysis.integratedLufs));
+
+  // Pass 2: gain, true-peak limiting and encoding in one streaming loop
+  auto *format = engine->getAudioFileFormatManager().getFormatFromFileName(outputFile);
+  if (format == nullptr)
+    format = engine->getAudioFileFormatManager().getDefaultFormat();
+
+  const int numChannels = (int)reader->numChannels;
+  std::unique_ptr<juce::FileOutputStream> stream(outputFile.createOutputStream());
+  std::unique_ptr<juce::AudioFormatWriter> writer(
+      stream != nullptr ? format->createWriterFor(stream.get(), reader->sampleRate, (unsigned int)numChannels, 24, {}, 0)
+                        : nullptr);
+
+  if (writer == nullptr)
+  {
+    std::cerr << "Export failed: could not create writer" << std::endl;
+    outputFile.deleteFile();
+    return false;
+  }
+
+  stream.release();
+
+  TruePeakLimiter limiter;
+  limiter.prepare(reader->sampleRate, numChannels, (float)truePeakCeilingDb);
+
+  // The limiter delays its output, so read that far past the end and drop the lead-in
+  const juce::int64 totalSamples = reader->lengthInSamples + limiter.getLatencySamples();
+  int samplesToSkip = limiter.getLatencySamples();
+
+  constexpr int blockSize = 16384;
+  juce::AudioBuffer<float> block(numChannels, blockSize);
+
+  // Don't leave a truncated file behind that looks like a finished export
+  auto fail = [&](const char *reason)
+  {
+    writer.reset();
+    outputFile.deleteFile();
+    std::cerr << "Export failed: " << reason << std::endl;
+    return false;
+  };
+
+  for (juce::int64 position = 0; position < totalSamples; position += blockSize)
+  {
+    const int numSamples = (int)std::min((juce::int64)blockSize, totalSamples - position);
+    reader->read(&block, 0, numSamples, position, true, true);
+    block.applyGain(0, numSamples, gain);
+    limiter.process(block, numSamples);
+
+    const int skip = std::min(samplesToSkip, numSamples);
+    samplesToSkip -= skip;
+
+    if (numSamples > skip && !writer->writeFromAudioSampleBuffer(block, skip, numSamples - skip))
+      return fail("could not write the output file");
+
+    if (onprogresschange)
+      onprogresschange((float)(position + numSamples) / (float)totalSamples);
+  }
+
+  return true;
+}
+
+int AudioEngine::exportAudioFormats(const ExportBuilder &builder, void (*onprogresschange)(float))
+{
+  if (renderCache == nullptr)
+    renderCache = std::make_unique<RenderCache>(*edit);
+
+  auto reader = RenderCache::createReader(renderCache->getOrRender(onprogresschange));
+  if (reader == nullptr)
+  {
+    std::cerr << "Export failed: could not render the mix" << std::endl;
+    return 0;
+  }
+
+  return MultiFormatExporter::exportTargets(*engine, *reader, builder.getTargets(), onprogresschange);
+}
+
+bool AudioEngine::exportAudioChunked(const std::string &filePath, int numChunks, double preRollSeconds,
+                                     void (*onprogresschange)(float))
+{
+  ChunkedRenderer::Options options;
+  options.numChunks = numChunks;
+  options.preRollSeconds = preRollSeconds;
+
+  return ChunkedRenderer::render(*edit, juce::File(filePath), options, onprogresschange);
+}
+
 const bool AudioEngine::isClickTrackEnabled()
 {
   return edit->clickTrackEnabled;
@@ -185,3 +488,283 @@ te::Edit *AudioEngine::getEdit() const
 {
   return edit.get();
 }
+
+bool AudioEngine::saveSnapshot(const std::string &filePath, bool compress)
+{
+  // Plugins keep some parameters in cached values until flushed into the tree
+  edit->flushState();
+
+  auto state = edit->state.createCopy();
+  TrackFreezer::removeFreezeProxies(state);
+  TimeStretchProxies::removeStretchProxies(state);
+
+  if (!EditSnapshot::writeToFile(state, juce::File(filePath), compress))
+  {
+    std::cerr << "Snapshot save failed: " << filePath << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool AudioEngine::loadSnapshot(const std::string &filePath)
+{
+  if (!replaceEdit(EditSnapshot::readFromFile(juce::File(filePath))))
+  {
+    std::cerr << "Snapshot load failed: " << filePath << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool AudioEngine::replaceEdit(const juce::ValueTree &state)
+{
+  if (!state.hasType(te::IDs::EDIT))
+    return false;
+
+  auto &behaviour = static_cast<BridgeEngineBehaviour &>(engine->getEngineBehaviour());
+  if (behaviour.isEditHeld())
+  {
+    std::cerr << "Cannot replace the edit while a batch is open" << std::endl;
+    return false;
+  }
+
+  edit->getTransport().stop(false, false);
+
+  // Autosaves journal proxies too, and their freezers and stretch proxies are gone by now
+  auto cleanState = state.createCopy();
+  TrackFreezer::removeFreezeProxies(cleanState);
+  TimeStretchProxies::removeStretchProxies(cleanState);
+
+  auto loaded = te::loadEditFromState(*engine, cleanState, te::Edit::EditRole::forEditing);
+  if (loaded == nullptr)
+    return false;
+
+  addMeters(*loaded);
+
+  // The autosaver listens to the old edit's tree, so it follows the edit across
+  const bool wasAutosaving = autosaver != nullptr;
+  loopSwitcher.reset();
+  midiRecorder.reset();
+  autosaver.reset();
+  renderCache.reset();
+  stretchProxies.reset();
+  memoryAccountant.reset();
+  graphRebuildTimer->detach();
+  transportScheduler->detach();
+  transportProbe->detach();
+
+  // Managers move to the new edit while the old one still exists, so they can let go of it
+  behaviour.replaceEdit(loaded.get());
+  edit = std::move(loaded);
+  edit->getTransport().ensureContextAllocated();
+  transportProbe->attach(*edit);
+  transportScheduler->attach(*edit);
+  graphRebuildTimer->attach(*edit);
+
+  if (BridgeEngineBehaviour::canWriteCacheFiles(*engine))
+    stretchProxies = std::make_unique<TimeStretchProxies>(*edit);
+
+  loopSwitcher = std::make_unique<LoopSwitcher>(*edit);
+  midiRecorder = std::make_unique<MidiRecorder>(*edit);
+  memoryAccountant = std::make_unique<MemoryAccountant>(*edit);
+
+  if (realtimeChecker != nullptr)
+    realtimeChecker->includeLaterCallbacks();
+
+  if (wasAutosaving)
+    autosaver = std::make_unique<EditAutosaver>(*edit, autosaveDirectory, autosaveIntervalMs, true);
+
+  return true;
+}
+
+bool AudioEngine::enableAutosave(const std::string &directoryPath, int intervalMs)
+{
+  juce::File directory(directoryPath);
+  if (!directory.createDirectory())
+  {
+    std::cerr << "Autosave failed: cannot create " << directoryPath << std::endl;
+    return false;
+  }
+
+  autosaver.reset();
+  autosaveDirectory = directory;
+  autosaveIntervalMs = intervalMs;
+  autosaver = std::make_unique<EditAutosaver>(*edit, autosaveDirectory, autosaveIntervalMs);
+  return true;
+}
+
+void AudioEngine::disableAutosave()
+{
+  autosaver.reset();
+}
+
+bool AudioEngine::isAutosaving() const
+{
+  return autosaver != nullptr;
+}
+
+bool AudioEngine::recoverAutosave(const std::string &directoryPath)
+{
+  if (!replaceEdit(EditAutosaver::recover(juce::File(directoryPath))))
+  {
+    std::cerr << "Nothing to recover in " << directoryPath << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+void AudioEngine::setNumAudioThreads(int numThreads)
+{
+  auto &behaviour = static_cast<BridgeEngineBehaviour &>(engine->getEngineBehaviour());
+  const int clamped = std::max(0, numThreads);
+  if (behaviour.numAudioThreads.exchange(clamped) == clamped)
+    return;
+
+  // Both hold the context's play head, which the inhibitor doesn't keep alive through this
+  loopSwitcher->cancel();
+  transportScheduler->cancel();
+
+  auto &transport = edit->getTransport();
+  const bool wasPlaying = transport.isPlaying();
+  transport.freePlaybackContext();
+  transport.ensureContextAllocated();
+
+  if (wasPlaying)
+    transport.play(false);
+}
+
+int AudioEngine::getNumAudioThreads() const
+{
+  return engine->getEngineBehaviour().getNumberOfCPUsToUseForAudio();
+}
+
+void AudioEngine::setPreResampleSamples(bool shouldPreResample)
+{
+  static_cast<BridgeEngineBehaviour &>(engine->getEngineBehaviour()).preResampleSamples = shouldPreResample;
+}
+
+bool AudioEngine::isPreResamplingSamples() const
+{
+  return BridgeEngineBehaviour::getPreResampleRate(*engine) > 0.0;
+}
+
+int AudioEngine::getPendingStretchProxies() const
+{
+  return stretchProxies != nullptr ? stretchProxies->getNumPending() : 0;
+}
+
+bool AudioEngine::isInMemoryProject() const
+{
+  return !BridgeEngineBehaviour::canWriteCacheFiles(*engine);
+}
+
+double AudioEngine::getCpuUsage() const
+{
+  return engine->getDeviceManager().getCpuUsage();
+}
+
+std::vector<PluginCpuUsage> AudioEngine::getPluginCpuUsage() const
+{
+  std::vector<PluginCpuUsage> usage;
+
+  for (auto *track : te::getAudioTracks(*edit))
+  {
+    if (TrackFreezer::isFreezeProxy(*track))
+      continue;
+
+    int pluginIndex = 0;
+
+    for (auto *plugin : track->pluginList.getPlugins())
+      usage.push_back({track->itemID.getRawID(), pluginIndex++, plugin->getName().toStdString(), plugin->getCpuUsage()});
+  }
+
+  return usage;
+}
+
+std::vector<TrackCpuUsage> AudioEngine::getTrackCpuUsage() const
+{
+  std::vector<TrackCpuUsage> usage;
+
+  for (auto *track : te::getAudioTracks(*edit))
+  {
+    if (TrackFreezer::isFreezeProxy(*track))
+      continue;
+
+    TrackCpuUsage trackUsage{track->itemID.getRawID(), 0, 0.0};
+
+    for (auto *plugin : track->pluginList.getPlugins())
+    {
+      trackUsage.cpuUsage += plugin->getCpuUsage();
+      ++trackUsage.numPlugins;
+    }
+
+    usage.push_back(trackUsage);
+  }
+
+  std::sort(usage.begin(), usage.end(), [](const TrackCpuUsage &a, const TrackCpuUsage &b)
+            { return a.cpuUsage > b.cpuUsage; });
+  return usage;
+}
+
+GraphRebuildStats AudioEngine::getGraphRebuildStats() const
+{
+  return graphRebuildTimer->getStats();
+}
+
+void AudioEngine::resetGraphRebuildStats()
+{
+  graphRebuildTimer->resetStats();
+}
+
+bool AudioEngine::isCheckingRealtimeSafety() const
+{
+  return realtimeChecker != nullptr && RealtimeSafetyChecker::isAvailable();
+}
+
+RealtimeViolations AudioEngine::getRealtimeViolations() const
+{
+  return RealtimeSafetyChecker::getViolations();
+}
+
+void AudioEngine::resetRealtimeViolations()
+{
+  RealtimeSafetyChecker::resetViolations();
+}
+
+MemoryReport AudioEngine::getMemoryReport() const
+{
+  return memoryAccountant->getReport();
+}
+
+MeterReading AudioEngine::getMasterMeter() const
+{
+  if (auto *meter = edit->getMasterPluginList().findFirstPluginOfType<MeterPlugin>())
+    return meter->getReading();
+
+  return {};
+}
+
+MeterReading AudioEngine::getTrackMeter(int trackID) const
+{
+  auto *track = dynamic_cast<te::AudioTrack *>(te::findTrackForID(*edit, te::EditItemID::fromRawID(trackID)));
+  if (track == nullptr)
+    return {};
+
+  if (auto *meter = track->pluginList.findFirstPluginOfType<MeterPlugin>())
+    return meter->getReading();
+
+  return {};
+}
+
+void AudioEngine::resetLoudness()
+{
+  if (auto *meter = edit->getMasterPluginList().findFirstPluginOfType<MeterPlugin>())
+    meter->resetIntegratedLoudness();
+
+  for (auto *track : te::getAudioTracks(*edit))
+    if (auto *meter = track->pluginList.findFirstPluginOfType<MeterPlugin>())
+      meter->resetIntegratedLoudness();
+}
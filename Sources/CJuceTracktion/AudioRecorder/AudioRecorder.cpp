@@ -0,0 +1,438 @@
+#include "AudioRecorder.h"
+#include "TransportProbe.h"
+#include <algorithm>
+
+struct AudioRecorder::ArmedTrack
+{
+  int trackID;
+  juce::String name;
+  int firstChannel;
+  int numChannels;
+
+  juce::AudioBuffer<float> buffer;
+  juce::AbstractFifo fifo{1};
+  std::unique_ptr<juce::AudioFormatWriter> writer;
+  juce::File file;
+  std::atomic<int64_t> samplesWritten{0};
+};
+
+// Plays a file into processInput block by block at the file's own rate
+class AudioRecorder::FakeInput : public juce::Thread
+{
+public:
+  FakeInput(AudioRecorder &r, juce::AudioBuffer<float> &&content, double rate, bool shouldLoop)
+      : juce::Thread("Fake Audio Input"), recorder(r), data(std::move(content)), sampleRate(rate), loop(shouldLoop),
+        block(data.getNumChannels(), blockSize)
+  {
+  }
+
+  ~FakeInput() override { stopThread(1000); }
+
+  double getSampleRate() const { return sampleRate; }
+  int getNumChannels() const { return data.getNumChannels(); }
+
+  void run() override
+  {
+    const double blockMs = blockSize * 1000.0 / sampleRate;
+    double deadline = juce::Time::getMillisecondCounterHiRes();
+
+    while (!threadShouldExit())
+    {
+      fillBlock();
+      recorder.processInput(block.getArrayOfReadPointers(), block.getNumChannels(), blockSize);
+
+      deadline += blockMs;
+      const double remaining = deadline - juce::Time::getMillisecondCounterHiRes();
+      if (remaining > 1.0)
+        wait((int)remaining);
+    }
+  }
+
+private:
+  static constexpr int blockSize = 512;
+
+  // Copies the next block from the file, wrapping when looping and silent after the end
+  void fillBlock()
+  {
+    block.clear();
+    const int length = data.getNumSamples();
+
+    for (int done = 0; done < blockSize && length > 0;)
+    {
+      if (position >= length)
+      {
+        if (!loop)
+          return;
+
+        position = 0;
+      }
+
+      const int numSamples = std::min(blockSize - done, length - position);
+      for (int ch = 0; ch < block.getNumChannels(); ++ch)
+        block.copyFrom(ch, done, data, ch, position, numSamples);
+
+      done += numSamples;
+      position += numSamples;
+    }
+  }
+
+  AudioRecorder &recorder;
+  const juce::AudioBuffer<float> data;
+  const double sampleRate;
+  const bool loop;
+  juce::AudioBuffer<float> block;
+  int position = 0;
+};
+
+AudioRecorder::AudioRecorder(te::Edit &e)
+    : juce::Thread("Recording Writer"), edit(e), probe(TransportProbe::get(e.engine))
+{
+  edit.engine.getDeviceManager().deviceManager.addAudioCallback(this);
+}
+
+AudioRecorder::~AudioRecorder()
+{
+  stop();
+  edit.engine.getDeviceManager().deviceManager.removeAudioCallback(this);
+  fakeInput.reset();
+}
+
+bool AudioRecorder::arm(int trackID, const juce::String &trackName, int firstInputChannel, int numChannels)
+{
+  if (isRecording() || numChannels < 1 || numChannels > 2)
+    return false;
+
+  if (!hasInputs(firstInputChannel, numChannels))
+  {
+    std::cerr << "Cannot arm track " << trackID << ": input channels " << firstInputChannel << " to "
+              << firstInputChannel + numChannels - 1 << " don't exist (" << getNumInputChannels()
+              << " active)" << std::endl;
+    return false;
+  }
+
+  disarm(trackID);
+
+  auto track = std::make_unique<ArmedTrack>();
+  track->trackID = trackID;
+  track->name = trackName;
+  track->firstChannel = firstInputChannel;
+  track->numChannels = numChannels;
+  tracks.push_back(std::move(track));
+  return true;
+}
+
+bool AudioRecorder::disarm(int trackID)
+{
+  if (isRecording())
+    return false;
+
+  const auto removed = std::remove_if(tracks.begin(), tracks.end(),
+                                      [trackID](const std::unique_ptr<ArmedTrack> &t) { return t->trackID == trackID; });
+  const bool wasArmed = removed != tracks.end();
+  tracks.erase(removed, tracks.end());
+  return wasArmed;
+}
+
+bool AudioRecorder::isArmed(int trackID) const
+{
+  return std::any_of(tracks.begin(), tracks.end(),
+                     [trackID](const std::unique_ptr<ArmedTrack> &t) { return t->trackID == trackID; });
+}
+
+int AudioRecorder::getNumInputChannels() const
+{
+  if (fakeInput != nullptr)
+    return fakeInput->getNumChannels();
+
+  auto *device = edit.engine.getDeviceManager().deviceManager.getCurrentAudioDevice();
+  return device != nullptr ? device->getActiveInputChannels().countNumberOfSetBits() : 0;
+}
+
+bool AudioRecorder::hasInputs(int firstInputChannel, int numChannels) const
+{
+  const int available = getNumInputChannels();
+  if (firstInputChannel < 0 || firstInputChannel >= available)
+    return false;
+
+  return numChannels == 1 || available == 1 || firstInputChannel + 1 < available;
+}
+
+bool AudioRecorder::start(const juce::File &directory)
+{
+  if (isRecording() || tracks.empty())
+    return false;
+
+  auto *device = edit.engine.getDeviceManager().deviceManager.getCurrentAudioDevice();
+  sampleRate = fakeInput != nullptr ? fakeInput->getSampleRate() : edit.engine.getDeviceManager().getSampleRate();
+  if (sampleRate <= 0.0 || (fakeInput == nullptr && device == nullptr))
+  {
+    std::cerr << "Recording failed: no audio input is running" << std::endl;
+    return false;
+  }
+
+  for (const auto &track : tracks)
+  {
+    if (!hasInputs(track->firstChannel, track->numChannels))
+    {
+      std::cerr << "Recording failed: input channels for " << track->name.toStdString() << " don't exist any more"
+                << std::endl;
+      return false;
+    }
+  }
+
+  // A file has no round trip to make up for
+  latencySeconds = fakeInput != nullptr
+                       ? 0.0
+                       : (device->getInputLatencyInSamples() + device->getOutputLatencyInSamples()) / sampleRate;
+
+  if (!directory.createDirectory())
+  {
+    std::cerr << "Recording failed: cannot create " << directory.getFullPathName().toStdString() << std::endl;
+    return false;
+  }
+
+  auto &wavFormat = *edit.engine.getAudioFileFormatManager().getWavFormat();
+  const int fifoSize = (int)(fifoSeconds * sampleRate);
+
+  for (auto &track : tracks)
+  {
+    track->file = directory.getNonexistentChildFile(juce::File::createLegalFileName(track->name) + " Take", ".wav");
+
+    std::unique_ptr<juce::FileOutputStream> stream(track->file.createOutputStream());
+    if (stream != nullptr)
+      track->writer.reset(wavFormat.createWriterFor(stream.get(), sampleRate, (unsigned int)track->numChannels, 24, {}, 0));
+
+    if (track->writer == nullptr)
+    {
+      std::cerr << "Recording failed: cannot write " << track->file.getFullPathName().toStdString() << std::endl;
+      stream.reset();
+      track->file.deleteFile();
+
+      for (auto &opened : tracks)
+      {
+        if (opened->writer != nullptr)
+        {
+          opened->writer.reset();
+          opened->file.deleteFile();
+        }
+      }
+
+      return false;
+    }
+
+    stream.release();
+
+    // All the audio thread will ever touch, allocated up front
+    track->buffer.setSize(track->numChannels, fifoSize);
+    track->fifo.setTotalSize(fifoSize);
+    track->fifo.reset();
+    track->samplesWritten = 0;
+  }
+
+  dropouts = 0;
+  droppedSamples = 0;
+  writeErrors = 0;
+  peakBacklog = 0;
+  startSeconds = edit.getTransport().getPosition().inSeconds() - latencySeconds;
+  positioned = false;
+
+  startThread(juce::Thread::Priority::high);
+  recording = true;
+  return true;
+}
+
+std::vector<AudioRecorder::Take> AudioRecorder::stop()
+{
+  std::vector<Take> takes;
+  if (!isRecording())
+    return takes;
+
+  // capturing is set before recording is checked, so once it reads false here no block
+  // can still be writing into a FIFO
+  recording = false;
+  while (capturing.load())
+    juce::Thread::yield();
+
+  // The writer drains what's left before it exits
+  signalThreadShouldExit();
+  notify();
+  stopThread(-1);
+
+  // Compensation can move the take back past the edit's start, so that part of the file
+  // is skipped rather than the clip placed before zero
+  const double start = startSeconds.load();
+
+  for (auto &track : tracks)
+  {
+    track->writer.reset();
+
+    if (track->samplesWritten > 0)
+      takes.push_back({track->trackID, track->file, std::max(0.0, start), std::max(0.0, -start)});
+    else
+      track->file.deleteFile();
+  }
+
+  return takes;
+}
+
+AudioRecordingStats AudioRecorder::getStats() const
+{
+  AudioRecordingStats stats;
+  int backlog = 0;
+
+  for (const auto &track : tracks)
+  {
+    stats.samplesWritten += track->samplesWritten.load();
+    backlog = std::max(backlog, track->fifo.getNumReady());
+  }
+
+  stats.dropouts = dropouts.load();
+  stats.droppedSamples = droppedSamples.load();
+  stats.writeErrors = writeErrors.load();
+
+  if (sampleRate > 0.0)
+  {
+    stats.backlogSeconds = isRecording() ? backlog / sampleRate : 0.0;
+    stats.peakBacklogSeconds = peakBacklog.load() / sampleRate;
+  }
+
+  return stats;
+}
+
+bool AudioRecorder::setFakeInput(const juce::File &file, bool loop)
+{
+  if (isRecording())
+    return false;
+
+  usingFakeInput = false;
+  fakeInput.reset();
+
+  if (file == juce::File())
+    return true;
+
+  std::unique_ptr<juce::AudioFormatReader> reader(
+      edit.engine.getAudioFileFormatManager().readFormatManager.createReaderFor(file));
+
+  if (reader == nullptr || reader->lengthInSamples <= 0)
+  {
+    std::cerr << "Fake input: cannot read " << file.getFullPathName().toStdString() << std::endl;
+    return false;
+  }
+
+  juce::AudioBuffer<float> content((int)std::min(2u, reader->numChannels), (int)reader->lengthInSamples);
+  reader->read(&content, 0, content.getNumSamples(), 0, true, content.getNumChannels() > 1);
+
+  fakeInput = std::make_unique<FakeInput>(*this, std::move(content), reader->sampleRate, loop);
+  usingFakeInput = true;
+  fakeInput->startThread(juce::Thread::Priority::high);
+  return true;
+}
+
+void AudioRecorder::processInput(const float *const *inputChannelData, int numInputChannels, int numSamples)
+{
+  capturing = true;
+
+  if (!recording.load())
+  {
+    capturing = false;
+    return;
+  }
+
+  // With a device running, tracktion's callback has just played this block and the probe
+  // holds its position
+  if (!positioned.exchange(true) && probe != nullptr)
+  {
+    const auto snapshot = probe->read();
+    if (snapshot.isPlaying)
+      startSeconds = snapshot.seconds - latencySeconds;
+  }
+
+  for (auto &track : tracks)
+  {
+    if (track->fifo.getFreeSpace() < numSamples)
+    {
+      ++dropouts;
+      droppedSamples += numSamples;
+      continue;
+    }
+
+    int start1, size1, start2, size2;
+    track->fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    for (int ch = 0; ch < track->numChannels; ++ch)
+    {
+      // A mono input recorded as stereo fills both channels. arm() and start() checked
+      // the channels; this only guards against the device changing underneath.
+      const int input = std::min(track->firstChannel + ch, numInputChannels - 1);
+      const float *source = input >= 0 ? inputChannelData[input] : nullptr;
+
+      if (source == nullptr)
+      {
+        track->buffer.clear(ch, start1, size1);
+        if (size2 > 0)
+          track->buffer.clear(ch, start2, size2);
+        continue;
+      }
+
+      track->buffer.copyFrom(ch, start1, source, size1);
+      if (size2 > 0)
+        track->buffer.copyFrom(ch, start2, source + size1, size2);
+    }
+
+    track->fifo.finishedWrite(size1 + size2);
+
+    const int backlog = track->fifo.getNumReady();
+    if (backlog > peakBacklog.load())
+      peakBacklog = backlog;
+  }
+
+  // The writer polls rather than being notified, which would take a lock here
+  capturing = false;
+}
+
+void AudioRecorder::audioDeviceIOCallbackWithContext(const float *const *inputChannelData, int numInputChannels,
+                                                     float *const *outputChannelData, int numOutputChannels,
+                                                     int numSamples, const juce::AudioIODeviceCallbackContext &)
+{
+  // Outputs of extra device callbacks are summed into the mix, so leave silence
+  for (int ch = 0; ch < numOutputChannels; ++ch)
+    if (outputChannelData[ch] != nullptr)
+      juce::FloatVectorOperations::clear(outputChannelData[ch], numSamples);
+
+  if (!usingFakeInput.load())
+    processInput(inputChannelData, numInputChannels, numSamples);
+}
+
+void AudioRecorder::run()
+{
+  while (!threadShouldExit())
+    if (!writeAvailable())
+      wait(10);
+
+  writeAvailable();
+}
+
+bool AudioRecorder::writeAvailable()
+{
+  bool wroteAny = false;
+
+  for (auto &track : tracks)
+  {
+    const int ready = track->fifo.getNumReady();
+    if (ready == 0)
+      continue;
+
+    int start1, size1, start2, size2;
+    track->fifo.prepareToRead(ready, start1, size1, start2, size2);
+
+    if (!track->writer->writeFromAudioSampleBuffer(track->buffer, start1, size1)
+        || (size2 > 0 && !track->writer->writeFromAudioSampleBuffer(track->buffer, start2, size2)))
+      ++writeErrors;
+
+    track->fifo.finishedRead(size1 + size2);
+    track->samplesWritten += size1 + size2;
+    wroteAny = true;
+  }
+
+  return wroteAny;
+}
@@ -0,0 +1,209 @@
+#include "ChunkedRenderer.h"
+#include <iostream>
+
+namespace
+{
+  struct Chunk
+  {
+    // Samples of the final output this chunk supplies
+    juce::int64 start = 0, end = 0;
+    // Where its render begins, pre-roll included
+    juce::int64 renderStart = 0;
+
+    std::unique_ptr<te::Edit> edit;
+    te::RenderManager::Job::Ptr job;
+    juce::File file;
+  };
+
+  te::EditRenderJob *getRenderJob(const Chunk &chunk)
+  {
+    return static_cast<te::EditRenderJob *>(chunk.job.get());
+  }
+
+  bool prepareChunk(Chunk &chunk, int index, te::Engine &engine, const juce::ValueTree &state,
+                    const juce::File &directory, double sampleRate, int blockSize)
+  {
+    // Edits are created on the calling thread; only the rendering moves to the workers.
+    // An edit keeps and listens to the tree it's given, so each one gets its own copy.
+    chunk.edit = te::loadEditFromState(engine, state.createCopy(), te::Edit::EditRole::forRendering);
+    if (chunk.edit == nullptr)
+      return false;
+
+    // Named by index: none of the files exist until the jobs run, so they can't be
+    // told apart by checking the disk
+    chunk.file = directory.getChildFile("chunk_" + juce::String(index) + ".wav");
+
+    te::Renderer::Parameters renderParams(*chunk.edit);
+    renderParams.destFile = chunk.file;
+    renderParams.audioFormat = engine.getAudioFileFormatManager().getWavFormat();
+    renderParams.bitDepth = 32;
+    renderParams.sampleRateForAudio = sampleRate;
+    renderParams.blockSizeForAudio = blockSize;
+    renderParams.time = te::TimeRange(te::TimePosition::fromSamples(chunk.renderStart, sampleRate),
+                                      te::TimePosition::fromSamples(chunk.end, sampleRate));
+    renderParams.usePlugins = true;
+    renderParams.useMasterPlugins = true;
+    renderParams.tracksToDo = te::toBitSet(te::getAllTracks(*chunk.edit));
+
+    chunk.job = te::EditRenderJob::getOrCreateRenderJob(engine, renderParams, false, false, false);
+    return chunk.job != nullptr;
+  }
+
+  std::unique_ptr<juce::AudioFormatWriter> createWriter(te::Engine &engine, const juce::File &file,
+                                                        double sampleRate, int numChannels, int bitDepth)
+  {
+    auto *format = engine.getAudioFileFormatManager().getFormatFromFileName(file);
+    if (format == nullptr)
+      format = engine.getAudioFileFormatManager().getDefaultFormat();
+
+    auto bitDepths = format->getPossibleBitDepths();
+    if (!bitDepths.isEmpty() && !bitDepths.contains(bitDepth))
+      bitDepth = bitDepths.getLast();
+
+    std::unique_ptr<juce::FileOutputStream> stream(file.createOutputStream());
+    if (stream == nullptr)
+      return nullptr;
+
+    std::unique_ptr<juce::AudioFormatWriter> writer(
+        format->createWriterFor(stream.get(), sampleRate, (unsigned int)numChannels, bitDepth, {}, 0));
+
+    if (writer != nullptr)
+      stream.release();
+
+    return writer;
+  }
+}
+
+bool ChunkedRenderer::render(te::Edit &edit, const juce::File &destFile, const Options &options,
+                             void (*onprogresschange)(float))
+{
+  if (destFile.exists())
+  {
+    std::cerr << "Export failed: File already exists" << std::endl;
+    return false;
+  }
+
+  auto &engine = edit.engine;
+  auto &deviceManager = engine.getDeviceManager();
+  const double sampleRate = deviceManager.getSampleRate();
+  const int blockSize = deviceManager.getBlockSize();
+
+  const auto totalSamples = (juce::int64)std::llround(edit.getLength().inSeconds() * sampleRate);
+  if (totalSamples <= 0)
+  {
+    std::cerr << "Export failed: Edit is empty" << std::endl;
+    return false;
+  }
+
+  const auto minChunkSamples = (juce::int64)juce::jmax(1.0, options.minChunkSeconds * sampleRate);
+  const auto preRollSamples = (juce::int64)juce::jmax(0.0, options.preRollSeconds * sampleRate);
+  const int requested = options.numChunks > 0 ? options.numChunks : juce::SystemStats::getNumCpus();
+  const int numChunks = (int)juce::jlimit((juce::int64)1, (juce::int64)juce::jmax(1, requested),
+                                          (totalSamples + minChunkSamples - 1) / minChunkSamples);
+
+  // A directory per render, so concurrent exports don't share chunk files
+  auto directory = engine.getTemporaryFileManager().getTempDirectory().getNonexistentChildFile("render-chunks", {}, false);
+  if (!directory.createDirectory())
+  {
+    std::cerr << "Export failed: cannot create " << directory.getFullPathName().toStdString() << std::endl;
+    return false;
+  }
+
+  edit.flushState();
+  const auto state = edit.state.createCopy();
+  std::vector<Chunk> chunks((size_t)numChunks);
+  bool ok = true;
+
+  // Boundaries are whole samples, so adjacent chunks meet exactly
+  for (int i = 0; i < numChunks && ok; ++i)
+  {
+    auto &chunk = chunks[(size_t)i];
+    chunk.start = totalSamples * i / numChunks;
+    chunk.end = totalSamples * (i + 1) / numChunks;
+    chunk.renderStart = juce::jmax((juce::int64)0, chunk.start - preRollSamples);
+    ok = prepareChunk(chunk, i, engine, state, directory, sampleRate, blockSize);
+  }
+
+  if (ok)
+  {
+    juce::ThreadPool pool(numChunks);
+
+    for (auto &chunk : chunks)
+    {
+      auto *renderJob = getRenderJob(chunk);
+      pool.addJob([renderJob]
+                  {
+                    while (renderJob->progress < 1)
+                      renderJob->runJob();
+                  });
+    }
+
+    // Rendering is the bulk of the work; the join gets the last tenth of the progress
+    while (pool.getNumJobs() > 0)
+    {
+      if (onprogresschange)
+      {
+        float progress = 0.0f;
+        for (auto &chunk : chunks)
+          progress += getRenderJob(chunk)->getCurrentTaskProgress();
+
+        onprogresschange(0.9f * progress / (float)numChunks);
+      }
+
+      juce::Thread::sleep(50);
+    }
+  }
+
+  std::vector<std::unique_ptr<juce::AudioFormatReader>> readers;
+
+  for (auto &chunk : chunks)
+  {
+    chunk.job = nullptr;
+    chunk.edit.reset();
+
+    juce::WavAudioFormat wavFormat;
+    auto *stream = chunk.file.createInputStream().release();
+    readers.emplace_back(stream != nullptr ? wavFormat.createReaderFor(stream, true) : nullptr);
+    ok = ok && readers.back() != nullptr;
+  }
+
+  if (ok)
+  {
+    const int numChannels = (int)readers.front()->numChannels;
+    auto writer = createWriter(engine, destFile, sampleRate, numChannels, options.bitDepth);
+    ok = writer != nullptr;
+
+    constexpr int copyBlockSize = 65536;
+    juce::AudioBuffer<float> buffer(numChannels, copyBlockSize);
+
+    for (size_t i = 0; i < chunks.size() && ok; ++i)
+    {
+      const auto &chunk = chunks[i];
+      const auto offset = chunk.start - chunk.renderStart;
+
+      // Reads past the end of a chunk come back as silence, so a render a sample
+      // short still fills its full span
+      for (auto position = chunk.start; position < chunk.end && ok; position += copyBlockSize)
+      {
+        const int numSamples = (int)std::min((juce::int64)copyBlockSize, chunk.end - position);
+        readers[i]->read(&buffer, 0, numSamples, position - chunk.start + offset, true, true);
+        ok = writer->writeFromAudioSampleBuffer(buffer, 0, numSamples);
+      }
+
+      if (onprogresschange)
+        onprogresschange(0.9f + 0.1f * (float)(i + 1) / (float)chunks.size());
+    }
+  }
+
+  readers.clear();
+
+  directory.deleteRecursively();
+
+  if (!ok)
+  {
+    std::cerr << "Export failed: chunked render did not complete" << std::endl;
+    destFile.deleteFile();
+  }
+
+  return ok;
+}
@@ -0,0 +1,440 @@
+#include "DrumSamplerPlugin.h"
+#include "BridgeEngineBehaviour.h"
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+const char *DrumSamplerPlugin::xmlTypeName = "drumSampler";
+
+namespace
+{
+  const juce::Identifier soundID("SOUND");
+  const juce::Identifier fileID("file");
+  const juce::Identifier noteID("note");
+  const juce::Identifier chokeGroupID("chokeGroup");
+  const juce::Identifier gainID("gain");
+  const juce::Identifier maxPolyphonyID("maxPolyphony");
+
+  constexpr double fadeTimeSeconds = 0.002;
+}
+
+DrumSamplerPlugin::DrumSamplerPlugin(te::PluginCreationInfo info) : te::Plugin(info)
+{
+  maxPolyphony = juce::jlimit(1, maxVoices, (int)state.getProperty(maxPolyphonyID, maxVoices));
+  loadSoundsFromState();
+}
+
+DrumSamplerPlugin::~DrumSamplerPlugin()
+{
+  notifyListenersOfDeletion();
+}
+
+void DrumSamplerPlugin::initialise(const te::PluginInitialisationInfo &info)
+{
+  outputSampleRate = info.sampleRate;
+  fadeSamples = std::max(1, juce::roundToInt(fadeTimeSeconds * info.sampleRate));
+  scratch.setSize(2, std::max(info.blockSizeSamples, 512));
+  interp.setSize(2, scratch.getNumSamples());
+  interpIndex.resize((size_t)scratch.getNumSamples());
+  reset();
+}
+
+void DrumSamplerPlugin::deinitialise()
+{
+  scratch.setSize(0, 0);
+  interp.setSize(0, 0);
+
+  // Nothing is rendering now, so every table but the current one can go
+  tableInUse = nullptr;
+  lastTable = nullptr;
+  freeRetiredTables();
+}
+
+void DrumSamplerPlugin::reset()
+{
+  // The voices belong to the audio thread, which clears them before its next block
+  voicesNeedReset = true;
+  numActiveVoices = 0;
+}
+
+juce::String DrumSamplerPlugin::loadSound(Sound &sound)
+{
+  juce::File file(sound.filePath);
+  if (!file.existsAsFile())
+    return "Sample file does not exist: " + file.getFullPathName();
+
+  // Pre-resampled content plays back on the direct, interpolation-free path
+  sound.sample = SampleCache::getInstance().getSample(file, BridgeEngineBehaviour::getPreResampleRate(engine));
+  if (sound.sample == nullptr)
+    return "Unsupported sample format: " + file.getFullPathName();
+
+  return {};
+}
+
+juce::String DrumSamplerPlugin::addSound(const std::string &filePath, int noteNumber, int chokeGroup, float gain)
+{
+  auto sound = std::make_shared<Sound>();
+  sound->filePath = filePath;
+  sound->noteNumber = juce::jlimit(0, 127, noteNumber);
+  sound->chokeGroup = std::max(0, chokeGroup);
+  sound->gain = gain;
+
+  const auto error = loadSound(*sound);
+  if (error.isNotEmpty())
+    return error;
+
+  juce::ValueTree soundState(soundID);
+  soundState.setProperty(fileID, juce::String(filePath), nullptr);
+  soundState.setProperty(noteID, sound->noteNumber, nullptr);
+  soundState.setProperty(chokeGroupID, sound->chokeGroup, nullptr);
+  soundState.setProperty(gainID, gain, nullptr);
+  state.appendChild(soundState, getUndoManager());
+
+  auto sounds = table.load()->sounds;
+  sounds.push_back(std::move(sound));
+  publishTable(std::move(sounds));
+
+  changed();
+  return {};
+}
+
+void DrumSamplerPlugin::clearSounds()
+{
+  for (int i = state.getNumChildren(); --i >= 0;)
+    if (state.getChild(i).hasType(soundID))
+      state.removeChild(i, getUndoManager());
+
+  publishTable({});
+  changed();
+}
+
+int DrumSamplerPlugin::getNumSounds() const
+{
+  return (int)table.load()->sounds.size();
+}
+
+void DrumSamplerPlugin::setMaxPolyphony(int numVoices)
+{
+  maxPolyphony = juce::jlimit(1, maxVoices, numVoices);
+  state.setProperty(maxPolyphonyID, maxPolyphony.load(), getUndoManager());
+}
+
+size_t DrumSamplerPlugin::getSampleMemoryBytes() const
+{
+  std::set<const SampleCache::Sample *> counted;
+  size_t bytes = 0;
+
+  for (auto &sound : table.load()->sounds)
+    if (counted.insert(sound->sample.get()).second)
+      bytes += (size_t)sound->sample->audio.getNumChannels() * (size_t)sound->sample->audio.getNumSamples() * sizeof(float);
+
+  return bytes;
+}
+
+bool DrumSamplerPlugin::SoundTable::contains(const Sound *sound) const
+{
+  return std::any_of(sounds.begin(), sounds.end(),
+                     [sound](const std::shared_ptr<const Sound> &s) { return s.get() == sound; });
+}
+
+void DrumSamplerPlugin::publishTable(std::vector<std::shared_ptr<const Sound>> sounds)
+{
+  auto newTable = std::make_unique<SoundTable>();
+  newTable->sounds = std::move(sounds);
+
+  // Later sounds for the same note win
+  for (auto &sound : newTable->sounds)
+    newTable->noteMap[(size_t)sound->noteNumber] = sound.get();
+
+  table = newTable.get();
+  tables.push_back(std::move(newTable));
+  freeRetiredTables();
+}
+
+void DrumSamplerPlugin::freeRetiredTables()
+{
+  auto *current = table.load();
+  auto *inUse = tableInUse.load();
+
+  // The audio thread announced inUse before checking it was still current, so anything
+  // else is unreachable. Sounds shared with the current table live on through it.
+  tables.erase(std::remove_if(tables.begin(), tables.end(),
+                              [current, inUse](const std::unique_ptr<SoundTable> &t)
+                              { return t.get() != current && t.get() != inUse; }),
+               tables.end());
+}
+
+void DrumSamplerPlugin::loadSoundsFromState()
+{
+  std::vector<std::shared_ptr<const Sound>> loaded;
+
+  for (const auto &soundState : state)
+  {
+    if (!soundState.hasType(soundID))
+      continue;
+
+    auto sound = std::make_shared<Sound>();
+    sound->filePath = soundState[fileID].toString().toStdString();
+    sound->noteNumber = juce::jlimit(0, 127, (int)soundState[noteID]);
+    sound->chokeGroup = std::max(0, (int)soundState[chokeGroupID]);
+    sound->gain = (float)soundState.getProperty(gainID, 1.0f);
+
+    if (loadSound(*sound).isEmpty())
+      loaded.push_back(std::move(sound));
+  }
+
+  // Every sound is new, so the audio thread drops all voices when it picks this up
+  publishTable(std::move(loaded));
+}
+
+void DrumSamplerPlugin::restorePluginStateFromValueTree(const juce::ValueTree &v)
+{
+  for (int i = state.getNumChildren(); --i >= 0;)
+    if (state.getChild(i).hasType(soundID))
+      state.removeChild(i, getUndoManager());
+
+  for (const auto &child : v)
+    if (child.hasType(soundID))
+      state.appendChild(child.createCopy(), getUndoManager());
+
+  setMaxPolyphony((int)v.getProperty(maxPolyphonyID, maxVoices));
+  loadSoundsFromState();
+}
+
+void DrumSamplerPlugin::fadeOut(Voice &voice)
+{
+  if (!voice.isFading())
+    voice.fadeStep = std::max(voice.gain, 1.0e-6f) / (float)fadeSamples;
+}
+
+const DrumSamplerPlugin::SoundTable *DrumSamplerPlugin::acquireTable()
+{
+  // Announce the table before using it, then make sure it wasn't replaced meanwhile,
+  // so the message thread never frees one that's being read
+  auto *current = table.load();
+  for (;;)
+  {
+    tableInUse = current;
+    auto *latest = table.load();
+    if (latest == current)
+      break;
+
+    current = latest;
+  }
+
+  if (voicesNeedReset.exchange(false))
+    for (auto &voice : voices)
+      voice.sound = nullptr;
+
+  // Sounds missing from the new table are freed along with the old one
+  if (current != lastTable)
+  {
+    for (auto &voice : voices)
+      if (voice.sound != nullptr && !current->contains(voice.sound))
+        voice.sound = nullptr;
+
+    lastTable = current;
+  }
+
+  return current;
+}
+
+void DrumSamplerPlugin::startVoice(const SoundTable &soundTable, int noteNumber, float velocity)
+{
+  auto *sound = soundTable.noteMap[(size_t)noteNumber];
+  if (sound == nullptr)
+    return;
+
+  int sounding = 0;
+  Voice *oldest = nullptr;
+
+  for (auto &voice : voices)
+  {
+    if (voice.sound == nullptr || voice.isFading())
+      continue;
+
+    // Retriggers and choke-group partners fade instead of stacking up
+    if (voice.noteNumber == noteNumber || (sound->chokeGroup > 0 && voice.chokeGroup == sound->chokeGroup))
+    {
+      fadeOut(voice);
+      continue;
+    }
+
+    ++sounding;
+    if (oldest == nullptr || voice.age < oldest->age)
+      oldest = &voice;
+  }
+
+  if (sounding >= maxPolyphony.load() && oldest != nullptr)
+    fadeOut(*oldest);
+
+  // Prefer an idle slot, otherwise hard-steal the oldest voice that is already fading
+  Voice *target = nullptr;
+
+  for (auto &voice : voices)
+  {
+    if (voice.sound == nullptr)
+    {
+      target = &voice;
+      break;
+    }
+
+    if (voice.isFading() && (target == nullptr || voice.age < target->age))
+      target = &voice;
+  }
+
+  if (target == nullptr)
+    target = oldest != nullptr ? oldest : &voices[0];
+
+  target->sound = sound;
+  target->position = 0.0;
+  target->increment = sound->sample->sampleRate / outputSampleRate;
+  target->gain = velocity * sound->gain;
+  target->fadeStep = 0.0f;
+  target->noteNumber = noteNumber;
+  target->chokeGroup = sound->chokeGroup;
+  target->age = nextVoiceAge++;
+}
+
+void DrumSamplerPlugin::renderVoice(Voice &voice, juce::AudioBuffer<float> &dest, int startSample, int numSamples)
+{
+  const auto &source = voice.sound->sample->audio;
+  const int sourceChannels = source.getNumChannels();
+  const int destChannels = std::min(2, dest.getNumChannels());
+  const bool resampling = voice.increment != 1.0;
+
+  // The interpolator reads one sample ahead, so it stops one short of the end
+  const int sourceLength = resampling ? source.getNumSamples() - 1 : source.getNumSamples();
+  int done = 0;
+
+  while (done < numSamples && voice.sound != nullptr)
+  {
+    int chunk = numSamples - done;
+
+    if (voice.isFading())
+      chunk = std::min(chunk, std::max(1, (int)std::ceil(voice.gain / voice.fadeStep)));
+
+    if (resampling)
+      chunk = std::min({chunk, scratch.getNumSamples(),
+                        (int)std::ceil((sourceLength - voice.position) / voice.increment)});
+    else
+      chunk = std::min(chunk, sourceLength - (int)voice.position);
+
+    if (chunk <= 0)
+    {
+      voice.sound = nullptr;
+      break;
+    }
+
+    const float endGain = voice.isFading() ? std::max(0.0f, voice.gain - voice.fadeStep * (float)chunk) : voice.gain;
+
+    if (resampling)
+    {
+      // Positions are worked out once for all channels, then each channel gathers its two
+      // neighbours and blends them as whole vectors
+      int *index = interpIndex.data();
+      float *frac = interp.getWritePointer(0);
+      float *next = interp.getWritePointer(1);
+      double position = voice.position;
+
+      for (int i = 0; i < chunk; ++i)
+      {
+        index[i] = (int)position;
+        frac[i] = (float)(position - index[i]);
+        position += voice.increment;
+      }
+
+      for (int ch = 0; ch < sourceChannels; ++ch)
+      {
+        const float *in = source.getReadPointer(ch);
+        float *out = scratch.getWritePointer(ch);
+
+        for (int i = 0; i < chunk; ++i)
+        {
+          out[i] = in[index[i]];
+          next[i] = in[index[i] + 1];
+        }
+
+        juce::FloatVectorOperations::subtract(next, out, chunk);
+        juce::FloatVectorOperations::addWithMultiply(out, next, frac, chunk);
+      }
+
+      for (int ch = 0; ch < destChannels; ++ch)
+        dest.addFromWithRamp(ch, startSample + done, scratch.getReadPointer(std::min(ch, sourceChannels - 1)),
+                             chunk, voice.gain, endGain);
+
+      voice.position += chunk * voice.increment;
+    }
+    else
+    {
+      const int position = (int)voice.position;
+
+      for (int ch = 0; ch < destChannels; ++ch)
+        dest.addFromWithRamp(ch, startSample + done, source.getReadPointer(std::min(ch, sourceChannels - 1), position),
+                             chunk, voice.gain, endGain);
+
+      voice.position += chunk;
+    }
+
+    voice.gain = endGain;
+    done += chunk;
+
+    if (voice.isFading() && voice.gain <= 0.0f)
+      voice.sound = nullptr;
+  }
+}
+
+void DrumSamplerPlugin::renderVoices(juce::AudioBuffer<float> &dest, int startSample, int numSamples)
+{
+  if (numSamples <= 0)
+    return;
+
+  for (auto &voice : voices)
+    if (voice.sound != nullptr)
+      renderVoice(voice, dest, startSample, numSamples);
+}
+
+void DrumSamplerPlugin::applyToBuffer(const te::PluginRenderContext &fc)
+{
+  if (fc.destBuffer == nullptr)
+    return;
+
+  auto &dest = *fc.destBuffer;
+  dest.clear(fc.bufferStartSample, fc.bufferNumSamples);
+
+  const auto &soundTable = *acquireTable();
+  int rendered = 0;
+
+  if (fc.bufferForMidiMessages != nullptr)
+  {
+    for (auto &m : *fc.bufferForMidiMessages)
+    {
+      const int eventSample = juce::jlimit(0, fc.bufferNumSamples,
+                                           juce::roundToInt((m.getTimeStamp() + fc.midiBufferOffset) * outputSampleRate));
+
+      renderVoices(dest, fc.bufferStartSample + rendered, eventSample - rendered);
+      rendered = std::max(rendered, eventSample);
+
+      if (m.isNoteOn())
+      {
+        startVoice(soundTable, m.getNoteNumber(), m.getFloatVelocity());
+      }
+      else if (m.isAllNotesOff() || m.isAllSoundOff())
+      {
+        for (auto &voice : voices)
+          if (voice.sound != nullptr)
+            fadeOut(voice);
+      }
+      // Note-offs are ignored: one-shots always play to the end or until choked
+    }
+  }
+
+  renderVoices(dest, fc.bufferStartSample + rendered, fc.bufferNumSamples - rendered);
+
+  int active = 0;
+  for (auto &voice : voices)
+    if (voice.sound != nullptr)
+      ++active;
+
+  numActiveVoices = active;
+}
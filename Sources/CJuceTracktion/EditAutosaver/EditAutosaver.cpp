@@ -0,0 +1,420 @@
+#include "EditAutosaver.h"
+#include "EditSnapshot.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+  constexpr int journalMagic = 0x4a4b5453; // "STKJ" as written by writeInt
+
+  const juce::Identifier autosaveID("AUTOSAVE");
+  const juce::Identifier generationID("generation");
+
+  juce::File getSnapshotFile(const juce::File &directory) { return directory.getChildFile("autosave.stks"); }
+  juce::File getJournalFile(const juce::File &directory) { return directory.getChildFile("autosave.journal"); }
+
+  constexpr size_t maxCachedPaths = 8;
+
+  enum class Op
+  {
+    setProperty = 1,
+    removeProperty,
+    addChild,
+    removeChild,
+    moveChild
+  };
+
+  // Index of a child that was just added; appends are the common case and need no search
+  int indexOfAddedChild(const juce::ValueTree &parent, const juce::ValueTree &child)
+  {
+    const int last = parent.getNumChildren() - 1;
+    return parent.getChild(last) == child ? last : parent.indexOf(child);
+  }
+}
+
+struct EditAutosaver::Delta
+{
+  Op op;
+  std::vector<int> path;
+  juce::Identifier property;
+  juce::var value;
+  juce::ValueTree child;
+  int index = -1;
+  int newIndex = -1;
+
+  void write(juce::OutputStream &out) const
+  {
+    out.writeInt((int)op);
+    out.writeCompressedInt((int)path.size());
+
+    for (auto i : path)
+      out.writeCompressedInt(i);
+
+    switch (op)
+    {
+    case Op::setProperty:
+      out.writeString(property.toString());
+      value.writeToStream(out);
+      break;
+    case Op::removeProperty:
+      out.writeString(property.toString());
+      break;
+    case Op::addChild:
+      out.writeCompressedInt(index);
+      child.writeToStream(out);
+      break;
+    case Op::removeChild:
+      out.writeCompressedInt(index);
+      break;
+    case Op::moveChild:
+      out.writeCompressedInt(index);
+      out.writeCompressedInt(newIndex);
+      break;
+    }
+  }
+
+  static std::unique_ptr<Delta> read(juce::InputStream &in)
+  {
+    auto delta = std::make_unique<Delta>();
+    delta->op = (Op)in.readInt();
+
+    const int depth = in.readCompressedInt();
+    for (int i = 0; i < depth; ++i)
+      delta->path.push_back(in.readCompressedInt());
+
+    switch (delta->op)
+    {
+    case Op::setProperty:
+      delta->property = juce::Identifier(in.readString());
+      delta->value = juce::var::readFromStream(in);
+      break;
+    case Op::removeProperty:
+      delta->property = juce::Identifier(in.readString());
+      break;
+    case Op::addChild:
+      delta->index = in.readCompressedInt();
+      delta->child = juce::ValueTree::readFromStream(in);
+      break;
+    case Op::removeChild:
+      delta->index = in.readCompressedInt();
+      break;
+    case Op::moveChild:
+      delta->index = in.readCompressedInt();
+      delta->newIndex = in.readCompressedInt();
+      break;
+    default:
+      return nullptr;
+    }
+
+    return delta;
+  }
+
+  bool apply(juce::ValueTree &root) const
+  {
+    auto node = root;
+
+    for (auto i : path)
+    {
+      node = node.getChild(i);
+      if (!node.isValid())
+        return false;
+    }
+
+    switch (op)
+    {
+    case Op::setProperty:
+      node.setProperty(property, value, nullptr);
+      break;
+    case Op::removeProperty:
+      node.removeProperty(property, nullptr);
+      break;
+    case Op::addChild:
+      node.addChild(child, index, nullptr);
+      break;
+    case Op::removeChild:
+      node.removeChild(index, nullptr);
+      break;
+    case Op::moveChild:
+      node.moveChild(index, newIndex, nullptr);
+      break;
+    }
+
+    return true;
+  }
+};
+
+EditAutosaver::EditAutosaver(te::Edit &edit, const juce::File &dir, int interval, bool resumeSession)
+    : juce::Thread("Autosave"), state(edit.state), directory(dir), intervalMs(juce::jmax(10, interval))
+{
+  // Done here rather than on the writer thread, so a recover() right after sees the move
+  if (!resumeSession && hasRecoveryData(directory))
+  {
+    auto previous = getPreviousSessionDirectory(directory);
+    previous.deleteRecursively();
+
+    if (!previous.createDirectory() ||
+        !getSnapshotFile(directory).moveFileTo(getSnapshotFile(previous)) ||
+        (getJournalFile(directory).exists() && !getJournalFile(directory).moveFileTo(getJournalFile(previous))))
+      std::cerr << "Autosave: cannot move the previous session to " << previous.getFullPathName().toStdString()
+                << std::endl;
+  }
+
+  // The one full copy taken on the caller's thread; everything after is incremental
+  edit.flushState();
+  shadow = state.createCopy();
+  state.addListener(this);
+  startThread(juce::Thread::Priority::background);
+}
+
+EditAutosaver::~EditAutosaver()
+{
+  state.removeListener(this);
+  signalThreadShouldExit();
+  notify();
+  stopThread(30000);
+}
+
+void EditAutosaver::flush()
+{
+  notify();
+}
+
+// Index path from the root down to the node, built by walking up the parents until a
+// node whose path is already known
+std::vector<int> EditAutosaver::getPathTo(const juce::ValueTree &target)
+{
+  std::vector<int> reversed;
+  std::vector<int> prefix;
+  auto node = target;
+
+  while (node.isValid() && node != state)
+  {
+    auto cached = std::find_if(pathCache.begin(), pathCache.end(), [&](const auto &entry)
+                               { return entry.first == node; });
+    if (cached != pathCache.end())
+    {
+      prefix = cached->second;
+      break;
+    }
+
+    auto parent = node.getParent();
+    reversed.push_back(parent.indexOf(node));
+    node = parent;
+  }
+
+  prefix.insert(prefix.end(), reversed.rbegin(), reversed.rend());
+
+  if (pathCache.size() >= maxCachedPaths)
+    pathCache.pop_back();
+
+  pathCache.insert(pathCache.begin(), {target, prefix});
+  return prefix;
+}
+
+void EditAutosaver::record(std::unique_ptr<Delta> delta)
+{
+  std::lock_guard<std::mutex> sl(pendingLock);
+  pending.push_back(std::move(delta));
+}
+
+void EditAutosaver::valueTreePropertyChanged(juce::ValueTree &tree, const juce::Identifier &property)
+{
+  auto delta = std::make_unique<Delta>();
+  delta->path = getPathTo(tree);
+  delta->property = property;
+
+  if (tree.hasProperty(property))
+  {
+    delta->op = Op::setProperty;
+    delta->value = tree[property];
+  }
+  else
+  {
+    delta->op = Op::removeProperty;
+  }
+
+  record(std::move(delta));
+}
+
+void EditAutosaver::valueTreeChildAdded(juce::ValueTree &parent, juce::ValueTree &child)
+{
+  auto delta = std::make_unique<Delta>();
+  delta->op = Op::addChild;
+  delta->path = getPathTo(parent);
+  delta->index = indexOfAddedChild(parent, child);
+  // Only the new subtree is copied, the size of what was added rather than of the edit
+  delta->child = child.createCopy();
+
+  // Appending leaves every existing index where it was
+  if (delta->index != parent.getNumChildren() - 1)
+    pathCache.clear();
+
+  record(std::move(delta));
+}
+
+void EditAutosaver::valueTreeChildRemoved(juce::ValueTree &parent, juce::ValueTree &, int index)
+{
+  auto delta = std::make_unique<Delta>();
+  delta->op = Op::removeChild;
+  delta->path = getPathTo(parent);
+  pathCache.clear();
+  delta->index = index;
+  record(std::move(delta));
+}
+
+void EditAutosaver::valueTreeChildOrderChanged(juce::ValueTree &parent, int oldIndex, int newIndex)
+{
+  auto delta = std::make_unique<Delta>();
+  delta->op = Op::moveChild;
+  delta->path = getPathTo(parent);
+  pathCache.clear();
+  delta->index = oldIndex;
+  delta->newIndex = newIndex;
+  record(std::move(delta));
+}
+
+void EditAutosaver::run()
+{
+  if (!directory.createDirectory())
+  {
+    std::cerr << "Autosave disabled: cannot create " << directory.getFullPathName().toStdString() << std::endl;
+    return;
+  }
+
+  // Continue from the previous journal's generation: the snapshot written below always
+  // replaces the old one before a journal with the same generation is started
+  {
+    juce::FileInputStream previous(getJournalFile(directory));
+    if (previous.openedOk() && previous.readInt() == journalMagic)
+      generation = previous.readInt();
+  }
+
+  compact();
+
+  while (!threadShouldExit())
+  {
+    wait(intervalMs);
+    writePending();
+
+    if (journal == nullptr || journal->getPosition() > compactionBytes)
+      compact();
+  }
+
+  writePending();
+}
+
+void EditAutosaver::writePending()
+{
+  std::vector<std::unique_ptr<Delta>> deltas;
+
+  {
+    std::lock_guard<std::mutex> sl(pendingLock);
+    std::swap(deltas, pending);
+  }
+
+  if (deltas.empty())
+    return;
+
+  juce::MemoryOutputStream record;
+
+  for (auto &delta : deltas)
+  {
+    if (!delta->apply(shadow))
+      std::cerr << "Autosave: delta did not match the saved tree" << std::endl;
+
+    // Without a journal the shadow still advances and the next compaction catches up
+    if (journal == nullptr)
+      continue;
+
+    record.reset();
+    delta->write(record);
+
+    // Size-prefixed so a record torn by a crash is detected and dropped on recovery
+    journal->writeInt((int)record.getDataSize());
+    journal->write(record.getData(), record.getDataSize());
+  }
+
+  if (journal != nullptr)
+    journal->flush();
+}
+
+void EditAutosaver::compact()
+{
+  journal.reset();
+  ++generation;
+
+  juce::ValueTree wrapper(autosaveID);
+  wrapper.setProperty(generationID, generation, nullptr);
+  wrapper.appendChild(shadow, nullptr);
+  const bool saved = EditSnapshot::writeToFile(wrapper, getSnapshotFile(directory), true);
+  wrapper.removeChild(shadow, nullptr);
+
+  if (!saved)
+  {
+    std::cerr << "Autosave snapshot failed" << std::endl;
+    return;
+  }
+
+  auto journalFile = getJournalFile(directory);
+  journalFile.deleteFile();
+  journal = std::make_unique<juce::FileOutputStream>(journalFile);
+
+  if (!journal->openedOk())
+  {
+    journal.reset();
+    return;
+  }
+
+  journal->writeInt(journalMagic);
+  journal->writeInt(generation);
+  journal->flush();
+}
+
+juce::ValueTree EditAutosaver::recover(const juce::File &directory)
+{
+  auto wrapper = EditSnapshot::readFromFile(getSnapshotFile(directory));
+  if (!wrapper.hasType(autosaveID) || wrapper.getNumChildren() == 0)
+    return {};
+
+  auto recovered = wrapper.getChild(0);
+  wrapper.removeChild(recovered, nullptr);
+
+  juce::FileInputStream fileStream(getJournalFile(directory));
+  if (!fileStream.openedOk())
+    return recovered;
+
+  juce::BufferedInputStream in(fileStream, 1 << 16);
+
+  // A journal from an older generation is already contained in the snapshot
+  if (in.readInt() != journalMagic || in.readInt() != (int)wrapper[generationID])
+    return recovered;
+
+  juce::MemoryBlock data;
+
+  while (in.getNumBytesRemaining() >= 4)
+  {
+    const int size = in.readInt();
+    if (size <= 0 || in.getNumBytesRemaining() < size)
+      break;
+
+    data.setSize((size_t)size);
+    in.read(data.getData(), size);
+
+    juce::MemoryInputStream recordStream(data, false);
+    auto delta = Delta::read(recordStream);
+    if (delta == nullptr || !delta->apply(recovered))
+      break;
+  }
+
+  return recovered;
+}
+
+bool EditAutosaver::hasRecoveryData(const juce::File &directory)
+{
+  return EditSnapshot::isSnapshotFile(getSnapshotFile(directory));
+}
+
+juce::File EditAutosaver::getPreviousSessionDirectory(const juce::File &directory)
+{
+  return directory.getChildFile("previous-session");
+}
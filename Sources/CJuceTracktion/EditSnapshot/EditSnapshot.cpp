@@ -0,0 +1,88 @@
+#include "EditSnapshot.h"
+#include <iostream>
+
+namespace
+{
+  constexpr int magic = 0x534b5453; // "STKS" as written by writeInt
+  constexpr int compressedFlag = 1;
+
+  // Fast compression: snapshots are dominated by repetitive note/property data, where
+  // the lowest level already gets most of the size reduction
+  constexpr int compressionLevel = 1;
+}
+
+bool EditSnapshot::write(const juce::ValueTree &state, juce::OutputStream &out, bool compress)
+{
+  if (!state.isValid())
+    return false;
+
+  out.writeInt(magic);
+  out.writeInt(currentVersion);
+  out.writeInt(compress ? compressedFlag : 0);
+
+  if (compress)
+  {
+    juce::GZIPCompressorOutputStream gzip(out, compressionLevel);
+    state.writeToStream(gzip);
+    gzip.flush();
+  }
+  else
+  {
+    state.writeToStream(out);
+  }
+
+  out.flush();
+  return out.getStatus().wasOk();
+}
+
+juce::ValueTree EditSnapshot::read(juce::InputStream &in)
+{
+  if (in.readInt() != magic)
+    return {};
+
+  const int version = in.readInt();
+  if (version < 1 || version > currentVersion)
+  {
+    std::cerr << "Unsupported snapshot version: " << version << std::endl;
+    return {};
+  }
+
+  const int flags = in.readInt();
+
+  if ((flags & compressedFlag) != 0)
+  {
+    juce::GZIPDecompressorInputStream gzip(in);
+    return juce::ValueTree::readFromStream(gzip);
+  }
+
+  return juce::ValueTree::readFromStream(in);
+}
+
+bool EditSnapshot::writeToFile(const juce::ValueTree &state, const juce::File &file, bool compress)
+{
+  juce::TemporaryFile temp(file);
+
+  {
+    std::unique_ptr<juce::FileOutputStream> stream(temp.getFile().createOutputStream(1 << 16));
+    if (stream == nullptr || !write(state, *stream, compress))
+      return false;
+  }
+
+  return temp.overwriteTargetFileWithTemporary();
+}
+
+juce::ValueTree EditSnapshot::readFromFile(const juce::File &file)
+{
+  juce::FileInputStream fileStream(file);
+  if (!fileStream.openedOk())
+    return {};
+
+  juce::BufferedInputStream buffered(fileStream, 1 << 16);
+  return read(buffered);
+}
+
+bool EditSnapshot::isSnapshotFile(const juce::File &file)
+{
+  juce::FileInputStream fileStream(file);
+  return fileStream.openedOk() && fileStream.readInt() == magic;
+}
@@ -0,0 +1,85 @@
+#include "GraphRebuildTimer.h"
+#include "BridgeEngineBehaviour.h"
+#include <algorithm>
+
+namespace
+{
+  // A request nothing answered, e.g. because the context was freed meanwhile, mustn't be
+  // charged to whatever reallocates the context much later
+  constexpr double staleRequestMs = 5000.0;
+}
+
+GraphRebuildTimer::GraphRebuildTimer(te::Engine &e) : engine(e)
+{
+  if (auto *behaviour = BridgeEngineBehaviour::get(engine))
+    behaviour->graphRebuildTimer = this;
+}
+
+GraphRebuildTimer::~GraphRebuildTimer()
+{
+  detach();
+
+  if (auto *behaviour = BridgeEngineBehaviour::get(engine))
+    behaviour->graphRebuildTimer = nullptr;
+}
+
+GraphRebuildTimer *GraphRebuildTimer::get(te::Engine &engine)
+{
+  auto *behaviour = BridgeEngineBehaviour::get(engine);
+  return behaviour != nullptr ? behaviour->graphRebuildTimer : nullptr;
+}
+
+void GraphRebuildTimer::attach(te::Edit &e)
+{
+  detach();
+  edit = &e;
+  edit->getTransport().addListener(this);
+}
+
+void GraphRebuildTimer::detach()
+{
+  if (edit == nullptr)
+    return;
+
+  edit->getTransport().removeListener(this);
+  edit = nullptr;
+  pendingSince = 0.0;
+}
+
+void GraphRebuildTimer::restartRequested()
+{
+  if (edit == nullptr || !edit->getTransport().isPlayContextActive())
+    return;
+
+  const double now = juce::Time::getMillisecondCounterHiRes();
+  if (pendingSince == 0.0 || now - pendingSince > staleRequestMs)
+    pendingSince = now;
+}
+
+void GraphRebuildTimer::playbackContextChanged()
+{
+  if (pendingSince == 0.0)
+    return;
+
+  const double elapsedMs = juce::Time::getMillisecondCounterHiRes() - std::exchange(pendingSince, 0.0);
+  if (elapsedMs > staleRequestMs)
+    return;
+
+  std::lock_guard<std::mutex> lock(statsLock);
+  ++stats.count;
+  stats.lastMs = elapsedMs;
+  stats.maxMs = std::max(stats.maxMs, elapsedMs);
+  stats.averageMs += (elapsedMs - stats.averageMs) / stats.count;
+}
+
+GraphRebuildStats GraphRebuildTimer::getStats() const
+{
+  std::lock_guard<std::mutex> lock(statsLock);
+  return stats;
+}
+
+void GraphRebuildTimer::resetStats()
+{
+  std::lock_guard<std::mutex> lock(statsLock);
+  stats = {};
+}
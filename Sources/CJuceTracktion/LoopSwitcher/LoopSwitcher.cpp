@@ -0,0 +1,158 @@
+#include "LoopSwitcher.h"
+
+LoopSwitcher::LoopSwitcher(te::Edit &e) : edit(e)
+{
+  // Added after tracktion's own callback, so this runs once each block has been played
+  edit.engine.getDeviceManager().deviceManager.addAudioCallback(this);
+}
+
+LoopSwitcher::~LoopSwitcher()
+{
+  edit.engine.getDeviceManager().deviceManager.removeAudioCallback(this);
+  cancelPendingUpdate();
+}
+
+bool LoopSwitcher::queue(te::TimeRange range, double quantiseBeats)
+{
+  if (range.isEmpty())
+    return false;
+
+  cancel();
+  auto &transport = edit.getTransport();
+
+  if (!transport.isPlaying())
+  {
+    transport.setLoopRange(range);
+    transport.looping = true;
+    return true;
+  }
+
+  transport.ensureContextAllocated();
+  auto *context = transport.getCurrentPlaybackContext();
+  if (context == nullptr)
+    return false;
+
+  const double sampleRate = edit.engine.getDeviceManager().getSampleRate();
+  juce::int64 at = -1;
+
+  if (quantiseBeats > 0.0)
+  {
+    const double beats = edit.tempoSequence.toBeats(transport.getPosition()).inBeats();
+    const double next = std::floor(beats / quantiseBeats + 1.0) * quantiseBeats;
+    const auto time = edit.tempoSequence.toTime(te::BeatPosition::fromBeats(next));
+
+    // A beat past the loop end is never reached, so that falls back to the loop boundary
+    if (!transport.looping || time < transport.getLoopRange().getEnd())
+      at = te::toSamples(time, sampleRate);
+  }
+
+  // The play head belongs to the context, which must stay put until the switch is made
+  inhibitor = std::make_unique<te::TransportControl::ReallocationInhibitor>(transport);
+  pendingRange = range;
+  newStart = te::toSamples(range.getStart(), sampleRate);
+  newEnd = te::toSamples(range.getEnd(), sampleRate);
+  switchPoint = at;
+  playHead = context->getNodePlayHead();
+  state = queued;
+  return true;
+}
+
+void LoopSwitcher::cancel()
+{
+  int expected = queued;
+  if (state.compare_exchange_strong(expected, idle))
+  {
+    inhibitor.reset();
+  }
+  else
+  {
+    // A switch already under way finishes within a block
+    for (int i = 0; i < 100 && state == wrapping; ++i)
+      juce::Thread::sleep(1);
+
+    // Make sure the transport has caught up with a switch the audio thread already made
+    handleUpdateNowIfNeeded();
+  }
+
+  // Device callbacks run under this lock, so none can still be holding the play head
+  const juce::ScopedLock sl(edit.engine.getDeviceManager().deviceManager.getAudioCallbackLock());
+  state = idle;
+  playHead = nullptr;
+}
+
+void LoopSwitcher::audioDeviceIOCallbackWithContext(const float *const *, int, float *const *outputChannelData,
+                                                    int numOutputChannels, int numSamples,
+                                                    const juce::AudioIODeviceCallbackContext &)
+{
+  // Outputs of extra device callbacks are summed into the mix, so leave silence
+  for (int ch = 0; ch < numOutputChannels; ++ch)
+    if (outputChannelData[ch] != nullptr)
+      juce::FloatVectorOperations::clear(outputChannelData[ch], numSamples);
+
+  const int current = state.load();
+  auto *head = playHead.load();
+
+  if (current == idle || head == nullptr || !head->isPlaying())
+    return;
+
+  // Position the next block starts from; blocks are assumed to stay the same size
+  const auto position = head->getPosition();
+  const auto start = newStart.load(), end = newEnd.load();
+
+  auto finish = [this]
+  {
+    state = idle;
+    triggerAsyncUpdate();
+  };
+
+  if (current == wrapping)
+  {
+    // The shortened loop wrapped to the new start during the last block
+    head->setLoopRange(true, {start, end});
+    head->setPosition(position);
+    finish();
+    return;
+  }
+
+  auto at = switchPoint.load();
+  if (at < 0)
+    at = head->isLooping() ? head->getLoopRange().getEnd() : position;
+
+  const auto offset = at - position;
+  if (offset > numSamples)
+    return;
+
+  if (offset <= 0)
+  {
+    head->setLoopRange(true, {start, end});
+    head->setPosition(start);
+    finish();
+  }
+  else if (start <= position && start < at)
+  {
+    // End the old loop on the switch point: its wrap lands on the new start mid-block
+    head->setLoopRange(true, {start, at});
+    head->setPosition(position);
+    state = wrapping;
+  }
+  else
+  {
+    // The play head can't jump forward mid-block, so the new range starts with this block
+    head->setLoopRange(true, {start, end});
+    head->setPosition(start);
+    finish();
+  }
+}
+
+void LoopSwitcher::handleAsyncUpdate()
+{
+  if (state != idle)
+    return;
+
+  inhibitor.reset();
+  playHead = nullptr;
+
+  auto &transport = edit.getTransport();
+  transport.setLoopRange(pendingRange);
+  transport.looping = true;
+}
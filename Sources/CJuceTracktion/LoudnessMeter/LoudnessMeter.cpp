@@ -0,0 +1,234 @@
+#include "LoudnessMeter.h"
+#include <cmath>
+
+namespace
+{
+  constexpr double absoluteGateLufs = -70.0;
+  constexpr double relativeGateLu = -10.0;
+
+  float toDb(double gain)
+  {
+    return gain > 0.0 ? juce::jmax(LoudnessMeter::silenceDb, (float)(20.0 * std::log10(gain))) : LoudnessMeter::silenceDb;
+  }
+
+  double toLufs(double power)
+  {
+    return power > 0.0 ? -0.691 + 10.0 * std::log10(power) : (double)LoudnessMeter::silenceDb;
+  }
+
+  // Four independent accumulators so the compiler can keep them in one vector register
+  double sumOfSquares(const float *data, int numSamples)
+  {
+    float acc[4] = {};
+    int i = 0;
+
+    for (; i + 4 <= numSamples; i += 4)
+      for (int lane = 0; lane < 4; ++lane)
+        acc[lane] += data[i + lane] * data[i + lane];
+
+    double sum = (double)acc[0] + acc[1] + acc[2] + acc[3];
+
+    for (; i < numSamples; ++i)
+      sum += data[i] * data[i];
+
+    return sum;
+  }
+}
+
+LoudnessMeter::LoudnessMeter()
+{
+  for (int ch = 0; ch < maxChannels; ++ch)
+  {
+    peak[ch] = silenceDb;
+    rms[ch] = silenceDb;
+  }
+}
+
+void LoudnessMeter::prepare(double sampleRate)
+{
+  // K-weighting pre-filter and RLB high-pass from BS.1770, derived for any sample rate
+  {
+    const double f0 = 1681.974450955533, gainDb = 3.999843853973347, q = 0.7071752369554196;
+    const double k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+    const double vh = std::pow(10.0, gainDb / 20.0);
+    const double vb = std::pow(vh, 0.4996667741545416);
+    const double a0 = 1.0 + k / q + k * k;
+
+    shelf.setCoefficients((vh + vb * k / q + k * k) / a0,
+                          2.0 * (k * k - vh) / a0,
+                          (vh - vb * k / q + k * k) / a0,
+                          2.0 * (k * k - 1.0) / a0,
+                          (1.0 - k / q + k * k) / a0);
+  }
+
+  {
+    const double f0 = 38.13547087602444, q = 0.5003270373238773;
+    const double k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+    const double a0 = 1.0 + k / q + k * k;
+
+    highPass.setCoefficients(1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0);
+  }
+
+  blockSamples = juce::jmax(1, juce::roundToInt(sampleRate / 10.0));
+  clearHistory();
+}
+
+void LoudnessMeter::clearHistory()
+{
+  blockPosition = 0;
+  blockPeak.fill(0.0f);
+  blockSquares.fill(0.0);
+  blockWeighted.fill(0.0);
+  blockPowers.fill(0.0);
+  nextBlock = 0;
+  totalBlocks = 0;
+  binPower.fill(0.0);
+  binCount.fill(0);
+  gatedPower = 0.0;
+  gatedCount = 0;
+  integrated = silenceDb;
+}
+
+void LoudnessMeter::process(const juce::AudioBuffer<float> &buffer, int startSample, int numSamples)
+{
+  if (resetRequested.exchange(false))
+    clearHistory();
+
+  const int numChannels = juce::jmin(maxChannels, buffer.getNumChannels());
+  if (numChannels == 0)
+    return;
+
+  numChannelsSeen = numChannels;
+  int done = 0;
+
+  while (done < numSamples)
+  {
+    const int chunk = juce::jmin(numSamples - done, blockSamples - blockPosition);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+      const float *data = buffer.getReadPointer(ch, startSample + done);
+
+      auto range = juce::FloatVectorOperations::findMinAndMax(data, chunk);
+      blockPeak[(size_t)ch] = juce::jmax(blockPeak[(size_t)ch], -range.getStart(), range.getEnd());
+      blockSquares[(size_t)ch] += sumOfSquares(data, chunk);
+    }
+
+    // The filters are recursive, so samples go through one at a time with every channel
+    // in its own lane; unused lanes stay silent
+    alignas(Lanes::SIMDRegisterSize) double frame[Lanes::SIMDNumElements] = {};
+    alignas(Lanes::SIMDRegisterSize) double sums[Lanes::SIMDNumElements];
+    const float *channelData[maxChannels] = {};
+    auto weighted = Lanes::expand(0.0);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+      channelData[ch] = buffer.getReadPointer(ch, startSample + done);
+
+    for (int i = 0; i < chunk; ++i)
+    {
+      for (int ch = 0; ch < numChannels; ++ch)
+        frame[ch] = channelData[ch][i];
+
+      const auto y = highPass.process(shelf.process(Lanes::fromRawArray(frame)));
+      weighted += y * y;
+    }
+
+    weighted.copyToRawArray(sums);
+    for (int ch = 0; ch < numChannels; ++ch)
+      blockWeighted[(size_t)ch] += sums[ch];
+
+    blockPosition += chunk;
+    done += chunk;
+
+    if (blockPosition == blockSamples)
+      finishBlock();
+  }
+}
+
+void LoudnessMeter::finishBlock()
+{
+  double power = 0.0;
+  for (int ch = 0; ch < numChannelsSeen; ++ch)
+    power += blockWeighted[(size_t)ch] / blockSamples;
+
+  blockPowers[(size_t)nextBlock] = power;
+  nextBlock = (nextBlock + 1) % shortTermBlocks;
+  ++totalBlocks;
+
+  auto meanOfLast = [this](int count)
+  {
+    count = (int)juce::jmin((juce::int64)count, totalBlocks);
+    double sum = 0.0;
+
+    for (int i = 1; i <= count; ++i)
+      sum += blockPowers[(size_t)((nextBlock - i + shortTermBlocks) % shortTermBlocks)];
+
+    return count > 0 ? sum / count : 0.0;
+  };
+
+  const double momentaryPower = meanOfLast(momentaryBlocks);
+
+  // Gating blocks are 400 ms long with 75% overlap, i.e. one per 100 ms hop
+  if (totalBlocks >= momentaryBlocks)
+  {
+    const double loudness = toLufs(momentaryPower);
+
+    if (loudness >= absoluteGateLufs)
+    {
+      const int bin = juce::jlimit(0, histogramBins - 1, (int)((loudness - absoluteGateLufs) * 10.0));
+      binPower[(size_t)bin] += momentaryPower;
+      ++binCount[(size_t)bin];
+      gatedPower += momentaryPower;
+      ++gatedCount;
+    }
+  }
+
+  for (int ch = 0; ch < maxChannels; ++ch)
+  {
+    const int source = juce::jmin(ch, numChannelsSeen - 1);
+    peak[ch] = toDb(blockPeak[(size_t)source]);
+    rms[ch] = toDb(std::sqrt(blockSquares[(size_t)source] / blockSamples));
+  }
+
+  momentary = (float)juce::jmax((double)silenceDb, toLufs(momentaryPower));
+  shortTerm = (float)juce::jmax((double)silenceDb, toLufs(meanOfLast(shortTermBlocks)));
+  integrated = (float)juce::jmax((double)silenceDb, toLufs(getIntegratedPower()));
+
+  blockPosition = 0;
+  blockPeak.fill(0.0f);
+  blockSquares.fill(0.0);
+  blockWeighted.fill(0.0);
+}
+
+double LoudnessMeter::getIntegratedPower() const
+{
+  if (gatedCount == 0)
+    return 0.0;
+
+  const double threshold = toLufs(gatedPower / (double)gatedCount) + relativeGateLu;
+  const int firstBin = juce::jlimit(0, histogramBins, (int)std::ceil((threshold - absoluteGateLufs) * 10.0));
+
+  double sum = 0.0;
+  juce::uint64 count = 0;
+
+  for (int bin = firstBin; bin < histogramBins; ++bin)
+  {
+    sum += binPower[(size_t)bin];
+    count += binCount[(size_t)bin];
+  }
+
+  return count > 0 ? sum / (double)count : 0.0;
+}
+
+MeterReading LoudnessMeter::getReading() const
+{
+  MeterReading reading;
+  reading.peakLeft = peak[0];
+  reading.peakRight = peak[1];
+  reading.rmsLeft = rms[0];
+  reading.rmsRight = rms[1];
+  reading.momentaryLufs = momentary;
+  reading.shortTermLufs = shortTerm;
+  reading.integratedLufs = integrated;
+  return reading;
+}
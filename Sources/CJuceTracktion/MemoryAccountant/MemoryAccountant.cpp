@@ -0,0 +1,160 @@
+#include "MemoryAccountant.h"
+#include "DrumSamplerPlugin.h"
+#include "SampleCache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#if JUCE_MAC || JUCE_IOS
+#include <mach/mach.h>
+#elif JUCE_LINUX
+#include <unistd.h>
+#endif
+
+namespace
+{
+  // A ValueTree node: its shared object (type, property set, child array) and the
+  // parent's pointer to it
+  constexpr size_t nodeOverheadBytes = 96 + sizeof(void *);
+  // String payloads carry a reference-counted header in front of the UTF-8 text
+  constexpr size_t stringHeaderBytes = 16;
+
+  int64_t estimateTreeBytes(const juce::ValueTree &tree)
+  {
+    auto bytes = (int64_t)nodeOverheadBytes;
+
+    for (int i = 0; i < tree.getNumProperties(); ++i)
+    {
+      const auto &value = tree.getProperty(tree.getPropertyName(i));
+      bytes += (int64_t)sizeof(juce::NamedValueSet::NamedValue);
+
+      if (value.isString())
+        bytes += (int64_t)(value.toString().getNumBytesAsUTF8() + 1 + stringHeaderBytes);
+      else if (auto *block = value.getBinaryData())
+        bytes += (int64_t)block->getSize();
+    }
+
+    for (const auto &child : tree)
+      bytes += estimateTreeBytes(child);
+
+    return bytes;
+  }
+
+  // te::SamplerPlugin reads each sound's range into a float buffer when it's added
+  int64_t getSamplerSoundBytes(te::SamplerPlugin &sampler)
+  {
+    int64_t bytes = 0;
+
+    for (int i = 0; i < sampler.getNumSounds(); ++i)
+    {
+      const auto info = sampler.getSoundFile(i).getInfo();
+      const auto numSamples = (int64_t)std::ceil(sampler.getSoundLength(i) * info.sampleRate);
+      bytes += numSamples * info.numChannels * (int64_t)sizeof(float);
+    }
+
+    return bytes;
+  }
+
+  int64_t getPluginInstanceBytes(te::Plugin &plugin, int blockSize)
+  {
+    // Drum voices live inline in the plugin, plus a stereo scratch buffer
+    if (dynamic_cast<DrumSamplerPlugin *>(&plugin) != nullptr)
+      return (int64_t)sizeof(DrumSamplerPlugin) + 2 * std::max(blockSize, 512) * (int64_t)sizeof(float);
+
+    if (dynamic_cast<te::SamplerPlugin *>(&plugin) != nullptr)
+      return (int64_t)sizeof(te::SamplerPlugin);
+
+    if (dynamic_cast<te::ExternalPlugin *>(&plugin) != nullptr)
+      return (int64_t)sizeof(te::ExternalPlugin);
+
+    return (int64_t)sizeof(te::Plugin);
+  }
+}
+
+MemoryAccountant::MemoryAccountant(te::Edit &e) : edit(e)
+{
+  edit.state.addListener(this);
+}
+
+MemoryAccountant::~MemoryAccountant()
+{
+  edit.state.removeListener(this);
+}
+
+MemoryReport MemoryAccountant::getReport()
+{
+  MemoryReport report;
+  auto &deviceManager = edit.engine.getDeviceManager();
+  const int blockSize = deviceManager.getBlockSize();
+
+  for (auto *plugin : te::getAllPlugins(edit, true))
+  {
+    if (auto *sampler = dynamic_cast<te::SamplerPlugin *>(plugin))
+      report.samplerSampleBytes += getSamplerSoundBytes(*sampler);
+
+    report.pluginInstanceBytes += getPluginInstanceBytes(*plugin, blockSize);
+    ++report.numPlugins;
+  }
+
+  report.sampleCacheBytes = (int64_t)SampleCache::getInstance().getMemoryBytes();
+  report.audioFileCacheBytes = (int64_t)edit.engine.getAudioFileManager().cache.getBytesInUse();
+  report.undoHistoryBytes = (int64_t)edit.getUndoManager().getNumberOfUnitsTakenUpByStoredCommands();
+
+  if (stateChanged)
+  {
+    editStateBytes = estimateTreeBytes(edit.state);
+    stateChanged = false;
+  }
+
+  report.editStateBytes = editStateBytes;
+
+  // tracktion_graph gives every node a stereo block-sized output buffer: one per clip and plugin,
+  // and a few per track for its summing, volume and send stages
+  if (edit.getTransport().isPlayContextActive())
+  {
+    int64_t numNodes = 2;
+
+    for (auto *track : te::getAudioTracks(edit))
+      numNodes += 3 + track->getClips().size() + track->pluginList.size();
+
+    numNodes += edit.getMasterPluginList().size();
+
+    report.playbackBufferBytes = numNodes * 2 * blockSize * (int64_t)sizeof(float);
+  }
+
+  report.residentBytes = getResidentBytes();
+
+  const auto attributed = report.samplerSampleBytes + report.sampleCacheBytes + report.audioFileCacheBytes
+                          + report.undoHistoryBytes + report.editStateBytes + report.playbackBufferBytes
+                          + report.pluginInstanceBytes;
+  report.otherBytes = std::max((int64_t)0, report.residentBytes - attributed);
+  return report;
+}
+
+int64_t MemoryAccountant::getResidentBytes()
+{
+#if JUCE_MAC || JUCE_IOS
+  mach_task_basic_info info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS)
+    return (int64_t)info.resident_size;
+
+  return 0;
+#elif JUCE_LINUX
+  // statm: total and resident sizes in pages
+  long totalPages = 0, residentPages = 0;
+
+  if (auto *statm = std::fopen("/proc/self/statm", "r"))
+  {
+    if (std::fscanf(statm, "%ld %ld", &totalPages, &residentPages) != 2)
+      residentPages = 0;
+
+    std::fclose(statm);
+  }
+
+  return (int64_t)residentPages * (int64_t)sysconf(_SC_PAGESIZE);
+#else
+  return 0;
+#endif
+}
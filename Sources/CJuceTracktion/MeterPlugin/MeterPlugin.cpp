@@ -0,0 +1,35 @@
+#include "MeterPlugin.h"
+
+const char *MeterPlugin::xmlTypeName = "bridgeMeter";
+
+MeterPlugin::MeterPlugin(te::PluginCreationInfo info) : te::Plugin(info) {}
+
+MeterPlugin::~MeterPlugin()
+{
+  notifyListenersOfDeletion();
+}
+
+void MeterPlugin::initialise(const te::PluginInitialisationInfo &info)
+{
+  // Graph rebuilds re-initialise every plugin; keep the loudness history unless the rate changed
+  if (info.sampleRate != preparedSampleRate)
+  {
+    meter.prepare(info.sampleRate);
+    preparedSampleRate = info.sampleRate;
+  }
+}
+
+void MeterPlugin::applyToBuffer(const te::PluginRenderContext &fc)
+{
+  if (fc.destBuffer != nullptr)
+    meter.process(*fc.destBuffer, fc.bufferStartSample, fc.bufferNumSamples);
+}
+
+void MeterPlugin::addTo(te::Edit &edit, te::PluginList &plugins)
+{
+  if (plugins.findFirstPluginOfType<MeterPlugin>() != nullptr)
+    return;
+
+  if (auto plugin = edit.getPluginCache().createNewPlugin(xmlTypeName, {}))
+    plugins.insertPlugin(plugin, plugins.size(), nullptr);
+}
@@ -1,24 +1,28 @@
 #include "MidiClipManager.h"
+#include "BridgeEngineBehaviour.h"
+#include "GraphRebuildTimer.h"
+#include "PresetRegistry.h"
 #include <cassert>
 #include <iostream>
 #include <sys/wait.h>
 
-static juce::String organPatch =
-    "<PLUGIN type=\"4osc\" windowLocked=\"1\" id=\"1069\" enabled=\"1\" filterType=\"1\" "
-    "presetDirty=\"0\" presetName=\"4OSC: Organ\" filterFreq=\"127.00000000000000000000\" "
-    "ampAttack=\"0.60000002384185791016\" ampDecay=\"10.00000000000000000000\" "
-    "ampSustain=\"100.00000000000000000000\" ampRelease=\"0.40000000596046447754\" "
-    "waveShape1=\"4\" tune2=\"-24.00000000000000000000\" waveShape2=\"4\"> <MACROPARAMETERS "
-    "id=\"1069\"/> <MODIFIERASSIGNMENTS/> <MODMATRIX/> </PLUGIN>";
-
-static juce::String leadPatch =
-    "<PLUGIN type=\"4osc\" windowLocked=\"1\" id=\"1069\" enabled=\"1\" "
-    "filterType=\"1\" waveShape1=\"3\" filterFreq=\"100\"><MACROPARAMETERS "
-    "id=\"1069\"/><MODIFIERASSIGNMENTS/><MODMATRIX/></PLUGIN>";
+MidiClipManager::MidiClipManager(te::Edit *edit) : edit(edit)
+{
+  if (edit)
+    BridgeEngineBehaviour::addEditFollower(edit->engine, this);
+}
 
-MidiClipManager::MidiClipManager(te::Edit *edit) : edit(edit) {}
+MidiClipManager::~MidiClipManager()
+{
+  if (edit)
+    BridgeEngineBehaviour::removeEditFollower(edit->engine, this);
+}
 
-MidiClipManager::~MidiClipManager() = default;
+void MidiClipManager::editReplaced(te::Edit *newEdit)
+{
+  pendingLoopClipID = -1;
+  edit = newEdit;
+}
 
 MidiClipManager *MidiClipManager::create(te::Edit *edit)
 {
@@ -40,6 +44,8 @@ int MidiClipManager::createMidiClip(int trackID,
   if (!audioTrack)
     return -1;
 
+  batch.markStructuralChange();
+
   auto &ts = edit->getTransport().edit.tempoSequence;
   const te::TimeRange editTimeRange = te::TimeRange(te::TimePosition(0s), te::TimePosition(2s));
 
@@ -51,11 +57,11 @@ int MidiClipManager::createMidiClip(int trackID,
   if (!clip)
     return -1;
 
-   if (auto midiClip = clip)
-   {
-     AudioEngineHelpers::loopAroundClip(*midiClip);
-   }
-  // end temp
+  // Looping touches the transport, so it waits for the commit that rebuilds the graph
+  if (batch.isActive())
+    pendingLoopClipID = clip->itemID.getRawID();
+  else
+    AudioEngineHelpers::loopAroundClip(*clip);
 
   std::cout << "new clip created - " << clip->itemID.getRawID();
   return clip->itemID.getRawID();
@@ -74,6 +80,8 @@ bool MidiClipManager::deleteMidiClip(int trackID, int clipID)
   auto *audioTrack = dynamic_cast<te::AudioTrack *>(targetTrack);
   if (!audioTrack)
     return false;
+
+  batch.markStructuralChange();
   clip->removeFromParent();
   return true;
 }
@@ -88,7 +96,7 @@ bool MidiClipManager::addNote(int clipID, const MidiNote &note)
   auto &midiList = clip->getSequence();
   auto startBeat = te::BeatPosition::fromBeats(note.startBeat);
   auto lengthBeats = te::BeatDuration::fromBeats(note.lengthInBeats);
-  auto um = &edit.get()->getUndoManager();
+  auto um = &edit->getUndoManager();
 
   midiList.addNote(note.noteNumber, startBeat, lengthBeats, note.velocity, 0, um);
   return true;
@@ -102,7 +110,7 @@ bool MidiClipManager::removeNote(int clipID, int noteNumber, double startTime)
     return false;
 
   auto &midiList = clip->getSequence();
-  auto um = &edit.get()->getUndoManager();
+  auto um = &edit->getUndoManager();
 
   auto startBeat = te::BeatPosition::fromBeats(startTime);
 
@@ -136,22 +144,46 @@ std::vector<MidiNote> MidiClipManager::getNotes(int clipID)
   return notesList;
 }
 
-void create4OSCPlugin(te::AudioTrack *track, te::Edit *edit)
+te::MidiClip *MidiClipManager::getMidiClipByID(int clipID)
 {
-  //==============================================================================
-  if (auto synth = dynamic_cast<te::FourOscPlugin *>(
-          edit->getPluginCache().createNewPlugin(te::FourOscPlugin::xmlTypeName, {}).get()))
-  {
-    if (auto e = parseXML(organPatch))
-    {
-      auto vt = juce::ValueTree::fromXml(*e);
+  if (!edit || clipID < 0)
+    return nullptr;
 
-      if (vt.isValid())
-        synth->restorePluginStateFromValueTree(vt);
-    }
+  return dynamic_cast<te::MidiClip *>(edit->clipCache.findItem(te::EditItemID::fromRawID(clipID)));
+}
 
-    track->pluginList.insertPlugin(*synth, 0, nullptr);
-  }
+void MidiClipManager::beginBatch()
+{
+  if (!edit)
+    return;
+
+  batch.begin(*edit);
+}
+
+void MidiClipManager::commitBatch()
+{
+  if (!edit || !batch.commit(*edit))
+    return;
+
+  if (batch.restartedPlayback())
+    if (auto *timer = GraphRebuildTimer::get(edit->engine))
+      timer->restartRequested();
+
+  if (auto clip = getMidiClipByID(pendingLoopClipID))
+    AudioEngineHelpers::loopAroundClip(*clip);
+
+  pendingLoopClipID = -1;
+}
+
+bool MidiClipManager::isBatching() const
+{
+  return batch.isActive();
+}
+
+void create4OSCPlugin(te::AudioTrack *track, te::Edit *edit)
+{
+  if (auto synth = PresetRegistry::createPlugin(*edit, "Organ"))
+    track->pluginList.insertPlugin(synth, 0, nullptr);
 }
 
 void retainMidiClipManager(MidiClipManager *manager)
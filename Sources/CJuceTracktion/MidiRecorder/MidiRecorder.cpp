@@ -0,0 +1,313 @@
+#include "MidiRecorder.h"
+#include "TransportProbe.h"
+#include "TransportScheduler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  const auto minimumNoteLength = te::BeatDuration::fromBeats(1.0 / 64.0);
+}
+
+MidiRecorder::MidiRecorder(te::Edit &e)
+    : edit(e), probe(TransportProbe::get(e.engine)), slots(queueSize)
+{
+  for (uint32_t i = 0; i < queueSize; ++i)
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+
+  for (auto &device : edit.engine.getDeviceManager().getMidiInDevices())
+    device->addConsumer(this);
+}
+
+MidiRecorder::~MidiRecorder()
+{
+  // Takes the device's instance lock, so no MIDI thread is still inside the callback after
+  for (auto &device : edit.engine.getDeviceManager().getMidiInDevices())
+    device->removeConsumer(this);
+
+  stopTimer();
+}
+
+bool MidiRecorder::start(int id, bool shouldMergeIncrementally)
+{
+  if (isRecording())
+    stop();
+
+  if (dynamic_cast<te::MidiClip *>(edit.clipCache.findItem(te::EditItemID::fromRawID(id))) == nullptr)
+  {
+    std::cerr << "MIDI recording: no MIDI clip with ID " << id << std::endl;
+    return false;
+  }
+
+  // Anything a MIDI thread pushed while the last take was stopping
+  Event stale;
+  while (pop(stale))
+  {
+  }
+
+  clipID = id;
+  incremental = shouldMergeIncrementally;
+  pending.clear();
+  heldNotes = {};
+  lastHostTimeNs = 0;
+  notesThisTake = 0;
+
+  // A player reacts to what they hear, which leaves the device that much after the probe
+  auto *device = edit.engine.getDeviceManager().deviceManager.getCurrentAudioDevice();
+  outputLatencySeconds = device != nullptr && device->getCurrentSampleRate() > 0.0
+                             ? device->getOutputLatencyInSamples() / device->getCurrentSampleRate()
+                             : 0.0;
+
+  edit.getUndoManager().beginNewTransaction();
+  recording.store(true, std::memory_order_release);
+  startTimer(50);
+  return true;
+}
+
+int MidiRecorder::stop()
+{
+  if (!isRecording())
+    return 0;
+
+  recording = false;
+  stopTimer();
+
+  drain();
+  merge(true);
+
+  edit.getUndoManager().beginNewTransaction();
+  clipID = -1;
+  return notesThisTake;
+}
+
+MidiRecordingStats MidiRecorder::getStats() const
+{
+  MidiRecordingStats stats;
+  stats.eventsReceived = eventsReceived.load();
+  stats.eventsDropped = eventsDropped.load();
+  stats.notesRecorded = notesRecorded;
+  stats.controllersRecorded = controllersRecorded;
+  return stats;
+}
+
+void MidiRecorder::resetStats()
+{
+  eventsReceived = 0;
+  eventsDropped = 0;
+  notesRecorded = 0;
+  controllersRecorded = 0;
+}
+
+void MidiRecorder::injectMessage(const juce::MidiMessage &message, double editSeconds)
+{
+  push(message, editSeconds);
+}
+
+void MidiRecorder::handleIncomingMidiMessage(const juce::MidiMessage &message, te::MPESourceID)
+{
+  push(message, -1.0);
+}
+
+void MidiRecorder::push(const juce::MidiMessage &message, double editSeconds)
+{
+  if (!recording.load(std::memory_order_acquire))
+    return;
+
+  if (!message.isNoteOnOrOff() && !message.isController() && !message.isPitchWheel())
+    return;
+
+  Event event;
+  event.explicitTime = editSeconds >= 0.0;
+
+  if (event.explicitTime)
+  {
+    event.seconds = editSeconds;
+    event.hostTimeNs = (int64_t)(editSeconds * 1.0e9);
+  }
+  else
+  {
+    if (probe == nullptr)
+      return;
+
+    const auto snapshot = probe->read();
+    if (!snapshot.isPlaying)
+      return;
+
+    event.hostTimeNs = TransportScheduler::getHostTimeNs();
+    event.seconds = getLiveEditSeconds(snapshot, event.hostTimeNs, outputLatencySeconds.load(std::memory_order_relaxed));
+  }
+
+  const auto *data = message.getRawData();
+  event.data[0] = data[0];
+  event.data[1] = message.getRawDataSize() > 1 ? data[1] : 0;
+  event.data[2] = message.getRawDataSize() > 2 ? data[2] : 0;
+
+  ++eventsReceived;
+
+  auto position = writeIndex.load(std::memory_order_relaxed);
+
+  for (;;)
+  {
+    auto &slot = slots[position % queueSize];
+    const auto sequence = slot.sequence.load(std::memory_order_acquire);
+    const auto difference = (int32_t)(sequence - position);
+
+    if (difference == 0)
+    {
+      if (writeIndex.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+      {
+        slot.event = event;
+        slot.sequence.store(position + 1, std::memory_order_release);
+        return;
+      }
+    }
+    else if (difference < 0)
+    {
+      ++eventsDropped;
+      return;
+    }
+    else
+    {
+      position = writeIndex.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+double MidiRecorder::getLiveEditSeconds(const TransportSnapshot &snapshot, int64_t hostTimeNs, double latencySeconds)
+{
+  // The snapshot is from the start of the last block, so add the time since
+  double seconds = snapshot.seconds + (double)(hostTimeNs - snapshot.hostTimeNs) / 1.0e9 - latencySeconds;
+
+  // Latency can take a note from just after the loop start back to the end of the loop
+  const double loopLength = snapshot.loopEndSeconds - snapshot.loopStartSeconds;
+  if (snapshot.isLooping && loopLength > 0.0
+      && (seconds >= snapshot.loopEndSeconds || seconds < snapshot.loopStartSeconds))
+  {
+    seconds = std::fmod(seconds - snapshot.loopStartSeconds, loopLength);
+    if (seconds < 0.0)
+      seconds += loopLength;
+
+    seconds += snapshot.loopStartSeconds;
+  }
+
+  return seconds;
+}
+
+bool MidiRecorder::pop(Event &event)
+{
+  auto &slot = slots[readIndex % queueSize];
+  if ((int32_t)(slot.sequence.load(std::memory_order_acquire) - (readIndex + 1)) < 0)
+    return false;
+
+  event = slot.event;
+  slot.sequence.store(readIndex + queueSize, std::memory_order_release);
+  ++readIndex;
+  return true;
+}
+
+void MidiRecorder::drain()
+{
+  Event event;
+  while (pop(event))
+    pending.push_back(event);
+}
+
+void MidiRecorder::timerCallback()
+{
+  drain();
+
+  if (incremental && !pending.empty())
+    merge(false);
+}
+
+void MidiRecorder::merge(bool endHeldNotes)
+{
+  auto *clip = dynamic_cast<te::MidiClip *>(edit.clipCache.findItem(te::EditItemID::fromRawID(clipID)));
+  if (clip == nullptr)
+  {
+    pending.clear();
+    return;
+  }
+
+  auto &sequence = clip->getSequence();
+  auto *um = &edit.getUndoManager();
+  double latestSeconds = clip->getPosition().getEnd().inSeconds();
+
+  auto toBeat = [clip](double seconds)
+  { return clip->getContentBeatAtTime(te::TimePosition::fromSeconds(seconds)); };
+
+  auto addNote = [&](int index, HeldNote &note, int64_t endHostTimeNs)
+  {
+    note.active = false;
+
+    const auto start = toBeat(note.seconds);
+    if (start < te::BeatPosition())
+      return;
+
+    const double endSeconds = note.seconds + (double)(endHostTimeNs - note.hostTimeNs) / 1.0e9;
+    auto length = toBeat(endSeconds) - start;
+    if (length < minimumNoteLength)
+      length = minimumNoteLength;
+
+    sequence.addNote(index % 128, start, length, note.velocity, 0, um);
+    latestSeconds = std::max(latestSeconds, endSeconds);
+    ++notesThisTake;
+    ++notesRecorded;
+  };
+
+  auto addController = [&](double seconds, int type, int value)
+  {
+    const auto beat = toBeat(seconds);
+    if (beat < te::BeatPosition())
+      return;
+
+    sequence.addControllerEvent(beat, type, value, um);
+    ++controllersRecorded;
+  };
+
+  for (const auto &event : pending)
+  {
+    const int status = event.data[0] & 0xf0;
+    const int index = (event.data[0] & 0x0f) * 128 + (event.data[1] & 0x7f);
+    auto &held = heldNotes[(size_t)index];
+    lastHostTimeNs = std::max(lastHostTimeNs, event.hostTimeNs);
+
+    if (status == 0x90 && event.data[2] > 0)
+    {
+      // A retrigger ends the note already held
+      if (held.active)
+        addNote(index, held, event.hostTimeNs);
+
+      held = {true, event.explicitTime, event.seconds, event.hostTimeNs, event.data[2]};
+    }
+    else if (status == 0x80 || status == 0x90)
+    {
+      if (held.active)
+        addNote(index, held, event.hostTimeNs);
+    }
+    else if (status == 0xb0)
+    {
+      // tracktion keeps controller values 14-bit
+      addController(event.seconds, event.data[1], event.data[2] << 7);
+    }
+    else if (status == 0xe0)
+    {
+      addController(event.seconds, te::MidiControllerEvent::pitchWheelType, event.data[1] | (event.data[2] << 7));
+    }
+  }
+
+  pending.clear();
+
+  if (endHeldNotes)
+  {
+    // Live notes end now; notes placed explicitly end with the last event placed
+    const auto now = TransportScheduler::getHostTimeNs();
+
+    for (size_t i = 0; i < heldNotes.size(); ++i)
+      if (heldNotes[i].active)
+        addNote((int)i, heldNotes[i], heldNotes[i].explicitTime ? lastHostTimeNs : now);
+  }
+
+  if (latestSeconds > clip->getPosition().getEnd().inSeconds())
+    clip->setEnd(te::TimePosition::fromSeconds(latestSeconds), true);
+}
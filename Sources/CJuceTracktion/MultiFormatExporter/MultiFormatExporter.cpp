@@ -0,0 +1,254 @@
+#include "MultiFormatExporter.h"
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+
+void ExportBuilder::addTarget(const std::string& filePath, int bitDepth, bool dither, double sampleRate) {
+    targets.emplace_back(filePath, bitDepth, dither, sampleRate);
+}
+
+void ExportBuilder::addTarget(const std::string& filePath, int bitDepth, bool dither, double sampleRate, int quality) {
+    targets.emplace_back(filePath, bitDepth, dither, sampleRate, quality);
+}
+
+namespace
+{
+  using Block = std::shared_ptr<const juce::AudioBuffer<float>>;
+
+  // Feeds shared source blocks to the encoder, blocking until the reader supplies them
+  class BlockQueueSource : public juce::AudioSource
+  {
+  public:
+    static constexpr size_t capacity = 8;
+
+    void push(Block block)
+    {
+      std::unique_lock<std::mutex> sl(lock);
+      spaceAvailable.wait(sl, [this] { return blocks.size() < capacity || abandoned; });
+
+      if (abandoned)
+        return;
+
+      blocks.push_back(std::move(block));
+      dataAvailable.notify_one();
+    }
+
+    void finish()
+    {
+      std::lock_guard<std::mutex> sl(lock);
+      finished = true;
+      dataAvailable.notify_one();
+    }
+
+    // Called by the encoder when it gives up, so the reader never waits on it again
+    void abandon()
+    {
+      std::lock_guard<std::mutex> sl(lock);
+      abandoned = true;
+      blocks.clear();
+      spaceAvailable.notify_all();
+    }
+
+    void prepareToPlay(int, double) override {}
+    void releaseResources() override {}
+
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo &info) override
+    {
+      int done = 0;
+
+      while (done < info.numSamples)
+      {
+        if (current == nullptr || position >= current->getNumSamples())
+        {
+          std::unique_lock<std::mutex> sl(lock);
+          dataAvailable.wait(sl, [this] { return !blocks.empty() || finished; });
+
+          if (blocks.empty())
+          {
+            info.buffer->clear(info.startSample + done, info.numSamples - done);
+            return;
+          }
+
+          current = std::move(blocks.front());
+          blocks.pop_front();
+          position = 0;
+          spaceAvailable.notify_one();
+        }
+
+        const int count = juce::jmin(info.numSamples - done, current->getNumSamples() - position);
+
+        for (int ch = 0; ch < info.buffer->getNumChannels(); ++ch)
+          info.buffer->copyFrom(ch, info.startSample + done, *current,
+                                juce::jmin(ch, current->getNumChannels() - 1), position, count);
+
+        position += count;
+        done += count;
+      }
+    }
+
+  private:
+    std::mutex lock;
+    std::condition_variable dataAvailable, spaceAvailable;
+    std::deque<Block> blocks;
+    bool finished = false, abandoned = false;
+    Block current;
+    int position = 0;
+  };
+
+  class Encoder : public juce::Thread
+  {
+  public:
+    Encoder(te::Engine &engine, const ExportTarget &t, double rate, int channels, juce::int64 length)
+        : juce::Thread("Encoder"), target(t), sourceRate(rate), numChannels(channels), sourceLength(length),
+          bitDepth(t.bitDepth)
+    {
+      juce::File file(target.filePath);
+      auto *format = engine.getAudioFileFormatManager().getFormatFromFileName(file);
+      const double outputRate = target.sampleRate > 0.0 ? target.sampleRate : sourceRate;
+
+      if (format == nullptr || file.exists())
+      {
+        std::cerr << "Export skipped, unknown format or existing file: " << target.filePath << std::endl;
+        return;
+      }
+
+      // Formats with fixed sample formats (e.g. Ogg Vorbis) take their own bit depth
+      auto bitDepths = format->getPossibleBitDepths();
+      if (!bitDepths.isEmpty() && !bitDepths.contains(bitDepth))
+        bitDepth = bitDepths.getLast();
+
+      auto qualityOptions = format->getQualityOptions();
+      const int quality = target.quality >= 0 ? target.quality : qualityOptions.size() * 2 / 3;
+
+      std::unique_ptr<juce::FileOutputStream> stream(file.createOutputStream());
+      if (stream != nullptr)
+        writer.reset(format->createWriterFor(stream.get(), outputRate, (unsigned int)numChannels, bitDepth, {},
+                                             juce::jlimit(0, juce::jmax(0, qualityOptions.size() - 1), quality)));
+
+      if (writer == nullptr)
+      {
+        std::cerr << "Export skipped, unsupported settings: " << target.filePath << std::endl;
+        stream.reset();
+        file.deleteFile();
+        return;
+      }
+
+      stream.release();
+      outputLength = (juce::int64)std::ceil((double)sourceLength * outputRate / sourceRate);
+
+      if (!juce::approximatelyEqual(outputRate, sourceRate))
+      {
+        resampler = std::make_unique<juce::ResamplingAudioSource>(&queue, false, numChannels);
+        resampler->setResamplingRatio(sourceRate / outputRate);
+        resampler->prepareToPlay(blockSize, outputRate);
+      }
+
+      // TPDF dither of +-1 LSB only makes sense for integer output
+      if (target.dither && bitDepth < 32)
+        ditherAmplitude = 1.0f / (float)(1 << (bitDepth - 1));
+    }
+
+    bool isOpen() const { return writer != nullptr; }
+    BlockQueueSource &getQueue() { return queue; }
+    bool succeeded() const { return ok; }
+
+    void run() override
+    {
+      juce::AudioBuffer<float> buffer(numChannels, blockSize);
+      auto &source = resampler != nullptr ? static_cast<juce::AudioSource &>(*resampler)
+                                          : static_cast<juce::AudioSource &>(queue);
+      ok = true;
+
+      for (juce::int64 written = 0; written < outputLength && ok;)
+      {
+        const int numSamples = (int)std::min((juce::int64)blockSize, outputLength - written);
+        juce::AudioSourceChannelInfo info(&buffer, 0, numSamples);
+        source.getNextAudioBlock(info);
+
+        if (ditherAmplitude > 0.0f)
+          for (int ch = 0; ch < numChannels; ++ch)
+          {
+            auto *data = buffer.getWritePointer(ch);
+
+            for (int i = 0; i < numSamples; ++i)
+              data[i] += ditherAmplitude * (random.nextFloat() - random.nextFloat());
+          }
+
+        ok = writer->writeFromAudioSampleBuffer(buffer, 0, numSamples);
+        written += numSamples;
+      }
+
+      writer.reset();
+
+      if (!ok)
+        juce::File(target.filePath).deleteFile();
+
+      // Drops anything still queued and stops the reader waiting on this encoder
+      queue.abandon();
+    }
+
+  private:
+    static constexpr int blockSize = 8192;
+
+    const ExportTarget target;
+    const double sourceRate;
+    const int numChannels;
+    const juce::int64 sourceLength;
+    juce::int64 outputLength = 0;
+    int bitDepth;
+
+    BlockQueueSource queue;
+    std::unique_ptr<juce::ResamplingAudioSource> resampler;
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    float ditherAmplitude = 0.0f;
+    juce::Random random;
+    bool ok = false;
+  };
+}
+
+int MultiFormatExporter::exportTargets(te::Engine &engine, juce::AudioFormatReader &source,
+                                       const std::vector<ExportTarget> &targets, void (*onprogresschange)(float))
+{
+  const int numChannels = (int)source.numChannels;
+  std::vector<std::unique_ptr<Encoder>> encoders;
+
+  for (const auto &target : targets)
+  {
+    auto encoder = std::make_unique<Encoder>(engine, target, source.sampleRate, numChannels, source.lengthInSamples);
+    if (encoder->isOpen())
+      encoders.push_back(std::move(encoder));
+  }
+
+  for (auto &encoder : encoders)
+    encoder->startThread();
+
+  // Read each block once and hand the same buffer to every encoder
+  constexpr int readBlockSize = 32768;
+
+  for (juce::int64 position = 0; position < source.lengthInSamples; position += readBlockSize)
+  {
+    const int numSamples = (int)std::min((juce::int64)readBlockSize, source.lengthInSamples - position);
+    auto block = std::make_shared<juce::AudioBuffer<float>>(numChannels, numSamples);
+    source.read(block.get(), 0, numSamples, position, true, true);
+
+    for (auto &encoder : encoders)
+      encoder->getQueue().push(block);
+
+    if (onprogresschange)
+      onprogresschange((float)(position + numSamples) / (float)source.lengthInSamples);
+  }
+
+  int succeeded = 0;
+
+  for (auto &encoder : encoders)
+  {
+    encoder->getQueue().finish();
+    encoder->waitForThreadToExit(-1);
+
+    if (encoder->succeeded())
+      ++succeeded;
+  }
+
+  return succeeded;
+}
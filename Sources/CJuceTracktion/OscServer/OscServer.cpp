@@ -0,0 +1,472 @@
+#include "OscServer.h"
+#include "AudioEngine.h"
+#include "BridgeEngineBehaviour.h"
+#include "MidiClipManager.h"
+#include "TrackManager.h"
+#include <algorithm>
+#include <iostream>
+
+const char *OscLiveInputPlugin::xmlTypeName = "bridgeOscLiveInput";
+
+namespace
+{
+  bool isLiveAddress(const juce::String &address)
+  {
+    return address.startsWith("/live/");
+  }
+
+  // Checks the arguments against a signature: n for a number (int or float), s for a string
+  bool hasArguments(const juce::OSCMessage &message, const char *signature)
+  {
+    int i = 0;
+    for (; signature[i] != 0; ++i)
+    {
+      if (i >= message.size())
+        return false;
+
+      const auto &argument = message[i];
+      const bool ok = signature[i] == 's' ? argument.isString() : (argument.isInt32() || argument.isFloat32());
+      if (!ok)
+        return false;
+    }
+
+    return i == message.size();
+  }
+
+  double number(const juce::OSCMessage &message, int index)
+  {
+    const auto &argument = message[index];
+    return argument.isInt32() ? (double)argument.getInt32() : (double)argument.getFloat32();
+  }
+
+  int integer(const juce::OSCMessage &message, int index)
+  {
+    return juce::roundToInt(number(message, index));
+  }
+
+  std::string string(const juce::OSCMessage &message, int index)
+  {
+    return message[index].getString().toStdString();
+  }
+
+  struct Command
+  {
+    const char *address;
+    const char *signature;
+  };
+
+  constexpr Command commands[] = {
+      {"/transport/play", ""},
+      {"/transport/stop", ""},
+      {"/transport/loop", "nnn"},
+      {"/tempo", "n"},
+      {"/track/create", "s"},
+      {"/track/remove", "n"},
+      {"/track/audioclip", "nsnn"},
+      {"/track/midiclip", "nnn"},
+      {"/track/live", "n"},
+      {"/clip/create", "nsnn"},
+      {"/clip/delete", "nn"},
+      {"/clip/note/add", "nnnnn"},
+      {"/clip/note/remove", "nnn"},
+      {"/param/bind", "nnnn"},
+  };
+
+  bool isCommand(const juce::OSCMessage &message)
+  {
+    const auto address = message.getAddressPattern().toString();
+    return std::any_of(std::begin(commands), std::end(commands), [&](const Command &command)
+                       { return address == command.address && hasArguments(message, command.signature); });
+  }
+
+  // Every edit command in the bundle, in order, without the /live messages
+  void collectCommands(const juce::OSCBundle &bundle, std::vector<juce::OSCMessage> &messages)
+  {
+    for (const auto &element : bundle)
+    {
+      if (element.isBundle())
+        collectCommands(element.getBundle(), messages);
+      else if (!isLiveAddress(element.getMessage().getAddressPattern().toString()))
+        messages.push_back(element.getMessage());
+    }
+  }
+}
+
+OscServer::OscServer(AudioEngine &e, TrackManager &t, MidiClipManager &c) : engine(e), tracks(t), clips(c)
+{
+  if (auto *edit = engine.getEdit())
+  {
+    followedEngine = &edit->engine;
+    BridgeEngineBehaviour::addEditFollower(*followedEngine, this);
+  }
+}
+
+OscServer::~OscServer()
+{
+  stop();
+
+  if (followedEngine != nullptr)
+    BridgeEngineBehaviour::removeEditFollower(*followedEngine, this);
+}
+
+void OscServer::editReplaced(te::Edit *newEdit)
+{
+  // The OSC thread may be using a live track or binding; stopping waits for it
+  const int port = getPort();
+  stop();
+
+  if (newEdit == nullptr)
+  {
+    // The engine is going away and has already forgotten its followers
+    followedEngine = nullptr;
+    return;
+  }
+
+  if (port > 0)
+    start(port, replyPort);
+}
+
+bool OscServer::start(int port, int replyPort)
+{
+  stop();
+
+  // Localhost only: the address space can delete anything in the edit
+  auto newSocket = std::make_unique<juce::DatagramSocket>(false);
+  if (!newSocket->bindToPort(port, "127.0.0.1"))
+  {
+    std::cerr << "OSC server: cannot listen on port " << port << std::endl;
+    return false;
+  }
+
+  if (!receiver.connectToSocket(*newSocket))
+  {
+    std::cerr << "OSC server: cannot receive on port " << port << std::endl;
+    return false;
+  }
+
+  socket = std::move(newSocket);
+  this->replyPort = replyPort;
+  replying = replyPort > 0 && sender.connect("127.0.0.1", replyPort);
+  receiver.addListener(this);
+  receiver.addListener(&liveListener);
+  return true;
+}
+
+void OscServer::stop()
+{
+  if (socket == nullptr)
+    return;
+
+  // Shutting the socket down wakes the OSC thread, which exits before disconnect returns
+  socket->shutdown();
+  receiver.disconnect();
+  receiver.removeListener(this);
+  receiver.removeListener(&liveListener);
+  socket.reset();
+
+  sender.disconnect();
+  replying = false;
+
+  // Nothing reads these once the OSC thread has gone
+  for (auto &live : liveTracks)
+  {
+    live.trackID.store(0);
+    live.plugin.store(nullptr);
+  }
+
+  for (auto &parameter : parameters)
+    parameter.store(nullptr);
+
+  heldPlugins.clear();
+  heldParameters.clear();
+}
+
+int OscServer::getPort() const
+{
+  return socket != nullptr ? socket->getBoundPort() : -1;
+}
+
+void OscServer::LiveListener::oscMessageReceived(const juce::OSCMessage &message)
+{
+  if (isLiveAddress(message.getAddressPattern().toString()))
+    server.applyLiveMessage(message);
+}
+
+void OscServer::LiveListener::oscBundleReceived(const juce::OSCBundle &bundle)
+{
+  for (const auto &element : bundle)
+  {
+    if (element.isBundle())
+      oscBundleReceived(element.getBundle());
+    else
+      oscMessageReceived(element.getMessage());
+  }
+}
+
+void OscServer::oscMessageReceived(const juce::OSCMessage &message)
+{
+  if (!isLiveAddress(message.getAddressPattern().toString()))
+    reply(message.getAddressPattern().toString(), applyMessage(message));
+}
+
+void OscServer::oscBundleReceived(const juce::OSCBundle &bundle)
+{
+  std::vector<juce::OSCMessage> messages;
+  collectCommands(bundle, messages);
+
+  auto rejectAll = [&]
+  {
+    for (const auto &message : messages)
+      reply(message.getAddressPattern().toString(), -1);
+  };
+
+  // Nothing in the bundle is applied unless every message is a known command
+  for (const auto &message : messages)
+  {
+    if (!isCommand(message))
+    {
+      std::cerr << "OSC server: bundle rejected, unknown address or arguments for "
+                << message.getAddressPattern().toString().toStdString() << std::endl;
+      rejectAll();
+      return;
+    }
+  }
+
+  auto &undoManager = engine.getEdit()->getUndoManager();
+  const auto bindings = getBindings();
+  std::vector<int> results;
+
+  // A single batch, committed once. MidiClipManager calls aren't batched separately:
+  // their changes land in the same undo transaction, and their graph updates are held
+  // back by the batch's inhibitor until it commits.
+  tracks.beginBatch();
+
+  for (const auto &message : messages)
+  {
+    results.push_back(applyMessage(message));
+    if (results.back() < 0)
+      break;
+  }
+
+  const bool failed = !results.empty() && results.back() < 0;
+
+  if (failed)
+  {
+    // The batch opened a fresh transaction, so this only takes back the bundle's changes
+    if (undoManager.getNumActionsInCurrentTransaction() > 0)
+      undoManager.undo();
+
+    setBindings(bindings);
+  }
+
+  tracks.commitBatch();
+
+  if (failed)
+  {
+    rejectAll();
+    return;
+  }
+
+  for (size_t i = 0; i < messages.size(); ++i)
+    reply(messages[i].getAddressPattern().toString(), results[i]);
+}
+
+int OscServer::applyMessage(const juce::OSCMessage &message)
+{
+  const auto address = message.getAddressPattern().toString();
+
+  if (!isCommand(message))
+  {
+    std::cerr << "OSC server: unknown address or arguments for " << address.toStdString() << std::endl;
+    return -1;
+  }
+
+  auto is = [&](const char *pattern) { return address == pattern; };
+
+  if (is("/transport/play"))
+    engine.startPlayback();
+  else if (is("/transport/stop"))
+    engine.stopPlayback();
+  else if (is("/transport/loop"))
+    return engine.queueLoopRange(number(message, 0), number(message, 1), number(message, 2)) ? 1 : -1;
+  else if (is("/tempo"))
+    engine.setTempo(number(message, 0));
+  else if (is("/track/create"))
+    return tracks.createAudioTrack(string(message, 0));
+  else if (is("/track/remove"))
+    return tracks.removeTrack(integer(message, 0)) ? 1 : -1;
+  else if (is("/track/audioclip"))
+    return tracks.addAudioClip(integer(message, 0), string(message, 1), number(message, 2), number(message, 3)) ? 1 : -1;
+  else if (is("/track/midiclip"))
+    return tracks.addMidiClip(integer(message, 0), number(message, 1), number(message, 2));
+  else if (is("/track/live"))
+    return enableLiveInput(integer(message, 0));
+  else if (is("/clip/create"))
+    return clips.createMidiClip(integer(message, 0), string(message, 1), number(message, 2), number(message, 3));
+  else if (is("/clip/delete"))
+    return clips.deleteMidiClip(integer(message, 0), integer(message, 1)) ? 1 : -1;
+  else if (is("/clip/note/add"))
+  {
+    const MidiNote note((uint8_t)juce::jlimit(0, 127, integer(message, 1)), number(message, 2), number(message, 3),
+                        (uint8_t)juce::jlimit(1, 127, integer(message, 4)));
+    return clips.addNote(integer(message, 0), note) ? 1 : -1;
+  }
+  else if (is("/clip/note/remove"))
+    return clips.removeNote(integer(message, 0), integer(message, 1), number(message, 2)) ? 1 : -1;
+  else if (is("/param/bind"))
+    return bindParameter(integer(message, 0), integer(message, 1), integer(message, 2), integer(message, 3));
+
+  return 1;
+}
+
+OscServer::Bindings OscServer::getBindings() const
+{
+  Bindings bindings;
+
+  for (size_t i = 0; i < liveTracks.size(); ++i)
+    bindings.liveTrackIDs[i] = liveTracks[i].trackID.load();
+
+  for (size_t i = 0; i < parameters.size(); ++i)
+    bindings.parameters[i] = parameters[i].load();
+
+  return bindings;
+}
+
+void OscServer::setBindings(const Bindings &bindings)
+{
+  // Only ever undoes enableLiveInput and bindParameter. Slots go back to unused before
+  // anything else; the plugins and parameters stay held, as the OSC thread may have
+  // picked one up already.
+  for (size_t i = 0; i < liveTracks.size(); ++i)
+    if (bindings.liveTrackIDs[i] == 0)
+      liveTracks[i].trackID.store(0, std::memory_order_release);
+
+  for (size_t i = 0; i < parameters.size(); ++i)
+    parameters[i].store(bindings.parameters[i], std::memory_order_release);
+}
+
+void OscServer::applyLiveMessage(const juce::OSCMessage &message)
+{
+  const auto address = message.getAddressPattern().toString();
+
+  if (address == "/live/note" && hasArguments(message, "nnn"))
+  {
+    const int trackID = integer(message, 0);
+
+    for (auto &live : liveTracks)
+    {
+      if (live.trackID.load(std::memory_order_acquire) == trackID)
+      {
+        live.plugin.load()->queueNote(juce::jlimit(0, 127, integer(message, 1)), juce::jlimit(0, 127, integer(message, 2)));
+        return;
+      }
+    }
+  }
+  else if (address == "/live/param" && hasArguments(message, "nn"))
+  {
+    const int slot = integer(message, 0);
+    if (slot < 0 || slot >= maxParameterSlots)
+      return;
+
+    if (auto *parameter = parameters[(size_t)slot].load(std::memory_order_acquire))
+      parameter->setNormalisedParameter(juce::jlimit(0.0f, 1.0f, (float)number(message, 1)),
+                                        juce::sendNotificationAsync);
+  }
+}
+
+int OscServer::enableLiveInput(int trackID)
+{
+  auto *edit = engine.getEdit();
+  auto *track = dynamic_cast<te::AudioTrack *>(te::findTrackForID(*edit, te::EditItemID::fromRawID(trackID)));
+  if (track == nullptr)
+    return -1;
+
+  for (auto &live : liveTracks)
+    if (live.trackID.load() == trackID)
+      return 1;
+
+  auto unused = std::find_if(liveTracks.begin(), liveTracks.end(), [](const LiveTrack &live)
+                             { return live.trackID.load() == 0; });
+  if (unused == liveTracks.end())
+  {
+    std::cerr << "OSC server: live input is limited to " << maxLiveTracks << " tracks" << std::endl;
+    return -1;
+  }
+
+  te::Plugin::Ptr plugin = track->pluginList.findFirstPluginOfType<OscLiveInputPlugin>();
+  if (plugin == nullptr)
+  {
+    plugin = edit->getPluginCache().createNewPlugin(OscLiveInputPlugin::xmlTypeName, {});
+    if (plugin == nullptr)
+      return -1;
+
+    track->pluginList.insertPlugin(plugin, 0, nullptr);
+  }
+
+  heldPlugins.push_back(plugin);
+  unused->plugin.store(dynamic_cast<OscLiveInputPlugin *>(plugin.get()));
+  unused->trackID.store(trackID, std::memory_order_release);
+  return 1;
+}
+
+int OscServer::bindParameter(int slot, int trackID, int pluginIndex, int parameterIndex)
+{
+  if (slot < 0 || slot >= maxParameterSlots)
+    return -1;
+
+  auto *edit = engine.getEdit();
+  auto *track = te::findTrackForID(*edit, te::EditItemID::fromRawID(trackID));
+  if (track == nullptr || pluginIndex < 0 || pluginIndex >= track->pluginList.size())
+    return -1;
+
+  auto *plugin = track->pluginList[pluginIndex];
+  if (parameterIndex < 0 || parameterIndex >= plugin->getNumAutomatableParameters())
+    return -1;
+
+  te::AutomatableParameter::Ptr parameter = plugin->getAutomatableParameter(parameterIndex);
+  heldParameters.push_back(parameter);
+  parameters[(size_t)slot].store(parameter.get(), std::memory_order_release);
+  return 1;
+}
+
+void OscServer::reply(const juce::String &address, int result)
+{
+  if (replying)
+    sender.send("/reply", address, (juce::int32)result);
+}
+
+OscLiveInputPlugin::OscLiveInputPlugin(te::PluginCreationInfo info)
+    : te::Plugin(info), sourceID(te::createUniqueMPESourceID()) {}
+
+OscLiveInputPlugin::~OscLiveInputPlugin()
+{
+  notifyListenersOfDeletion();
+}
+
+bool OscLiveInputPlugin::queueNote(int noteNumber, int velocity)
+{
+  const auto scope = fifo.write(1);
+  if (scope.blockSize1 + scope.blockSize2 == 0)
+    return false;
+
+  queue[(size_t)(scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)] = {(uint8_t)noteNumber, (uint8_t)velocity};
+  return true;
+}
+
+void OscLiveInputPlugin::applyToBuffer(const te::PluginRenderContext &fc)
+{
+  // Drained even without a MIDI buffer, so notes don't pile up and play late
+  const auto scope = fifo.read(fifo.getNumReady());
+  if (fc.bufferForMidiMessages == nullptr || scope.blockSize1 + scope.blockSize2 == 0)
+    return;
+
+  scope.forEach([&](int index)
+  {
+    const auto &note = queue[(size_t)index];
+    const auto message = note.velocity > 0 ? juce::MidiMessage::noteOn(1, note.number, (juce::uint8)note.velocity)
+                                           : juce::MidiMessage::noteOff(1, note.number);
+    fc.bufferForMidiMessages->addMidiMessage(message, 0.0, sourceID);
+  });
+
+  fc.bufferForMidiMessages->sortByTimestamp();
+}
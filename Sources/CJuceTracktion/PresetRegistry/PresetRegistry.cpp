@@ -0,0 +1,172 @@
+#include "PresetRegistry.h"
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+static const char *organPatch =
+    "<PLUGIN type=\"4osc\" windowLocked=\"1\" id=\"1069\" enabled=\"1\" filterType=\"1\" "
+    "presetDirty=\"0\" presetName=\"4OSC: Organ\" filterFreq=\"127.00000000000000000000\" "
+    "ampAttack=\"0.60000002384185791016\" ampDecay=\"10.00000000000000000000\" "
+    "ampSustain=\"100.00000000000000000000\" ampRelease=\"0.40000000596046447754\" "
+    "waveShape1=\"4\" tune2=\"-24.00000000000000000000\" waveShape2=\"4\"> <MACROPARAMETERS "
+    "id=\"1069\"/> <MODIFIERASSIGNMENTS/> <MODMATRIX/> </PLUGIN>";
+
+static const char *leadPatch =
+    "<PLUGIN type=\"4osc\" windowLocked=\"1\" id=\"1069\" enabled=\"1\" "
+    "filterType=\"1\" waveShape1=\"3\" filterFreq=\"100\"><MACROPARAMETERS "
+    "id=\"1069\"/><MODIFIERASSIGNMENTS/><MODMATRIX/></PLUGIN>";
+
+namespace
+{
+  struct Preset
+  {
+    juce::String xml;
+    juce::File file;
+    std::once_flag parsed;
+    juce::ValueTree state;
+
+    const juce::ValueTree &compile()
+    {
+      std::call_once(parsed, [this]
+                     {
+                       auto text = file != juce::File() ? file.loadFileAsString() : xml;
+
+                       if (auto e = juce::parseXML(text))
+                       {
+                         // Accept a bare PLUGIN element or a preset document wrapping one
+                         auto tree = juce::ValueTree::fromXml(*e);
+                         state = tree.hasType(te::IDs::PLUGIN) ? tree : tree.getChildWithName(te::IDs::PLUGIN);
+                       }
+
+                       if (!state.isValid())
+                         std::cerr << "Could not parse preset "
+                                   << (file != juce::File() ? file.getFullPathName() : juce::String("XML")).toStdString()
+                                   << std::endl;
+
+                       xml = {};
+                     });
+      return state;
+    }
+  };
+
+  struct Registry
+  {
+    Registry() : pool(1)
+    {
+      add("Organ", organPatch, {});
+      add("Lead", leadPatch, {});
+    }
+
+    void add(const std::string &name, const juce::String &xml, const juce::File &file)
+    {
+      auto preset = std::make_shared<Preset>();
+      preset->xml = xml;
+      preset->file = file;
+
+      std::lock_guard<std::mutex> sl(lock);
+      presets[name] = std::move(preset);
+    }
+
+    std::shared_ptr<Preset> find(const std::string &name)
+    {
+      std::lock_guard<std::mutex> sl(lock);
+      auto found = presets.find(name);
+      return found != presets.end() ? found->second : nullptr;
+    }
+
+    std::mutex lock;
+    std::map<std::string, std::shared_ptr<Preset>> presets;
+    juce::ThreadPool pool;
+  };
+
+  Registry &getRegistry()
+  {
+    static Registry registry;
+    return registry;
+  }
+}
+
+void PresetRegistry::registerPresetXml(const std::string &name, const std::string &xml)
+{
+  getRegistry().add(name, juce::String(xml), {});
+}
+
+bool PresetRegistry::registerPresetFile(const std::string &name, const std::string &filePath)
+{
+  juce::File file(filePath);
+  if (!file.existsAsFile())
+  {
+    std::cerr << "Preset file does not exist: " << filePath << std::endl;
+    return false;
+  }
+
+  getRegistry().add(name, {}, file);
+  return true;
+}
+
+bool PresetRegistry::hasPreset(const std::string &name)
+{
+  return getRegistry().find(name) != nullptr;
+}
+
+std::vector<std::string> PresetRegistry::getPresetNames()
+{
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> sl(registry.lock);
+
+  std::vector<std::string> names;
+  for (auto &entry : registry.presets)
+    names.push_back(entry.first);
+
+  return names;
+}
+
+void PresetRegistry::prewarm()
+{
+  auto &registry = getRegistry();
+  std::vector<std::shared_ptr<Preset>> presets;
+
+  {
+    std::lock_guard<std::mutex> sl(registry.lock);
+    for (auto &entry : registry.presets)
+      presets.push_back(entry.second);
+  }
+
+  registry.pool.addJob([presets]
+                       {
+                         for (auto &preset : presets)
+                           preset->compile();
+                       });
+}
+
+juce::ValueTree PresetRegistry::getPreset(const std::string &name)
+{
+  if (auto preset = getRegistry().find(name))
+    return preset->compile();
+
+  return {};
+}
+
+te::Plugin::Ptr PresetRegistry::createPlugin(te::Edit &edit, const std::string &name)
+{
+  auto state = getPreset(name);
+  if (!state.isValid())
+    return {};
+
+  auto plugin = edit.getPluginCache().createNewPlugin(state[te::IDs::type].toString(), {});
+  if (plugin != nullptr)
+    plugin->restorePluginStateFromValueTree(state);
+
+  return plugin;
+}
+
+bool PresetRegistry::applyPreset(te::Plugin &plugin, const std::string &name)
+{
+  auto state = getPreset(name);
+  if (!state.isValid() || state[te::IDs::type].toString() != plugin.getPluginType())
+    return false;
+
+  plugin.restorePluginStateFromValueTree(state);
+  return true;
+}
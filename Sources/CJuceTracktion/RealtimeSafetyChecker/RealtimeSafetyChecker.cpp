@@ -0,0 +1,454 @@
+#include "RealtimeSafetyChecker.h"
+#include <atomic>
+#include <iostream>
+
+#if SWIFTTRACKTIONKIT_REALTIME_CHECKS && (JUCE_LINUX || JUCE_MAC || JUCE_IOS)
+#define REALTIME_HOOKS 1
+#include <cerrno>
+#include <execinfo.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#if JUCE_MAC || JUCE_IOS
+#include <os/lock.h>
+#endif
+#else
+#define REALTIME_HOOKS 0
+#endif
+
+namespace
+{
+  enum Kind
+  {
+    allocation,
+    deallocation,
+    lock,
+    blockingCall,
+    numKinds
+  };
+
+  const char *const kindNames[numKinds] = {"allocation", "deallocation", "lock", "blocking call"};
+
+  constexpr int maxFrames = 32;
+  constexpr int queueSize = 64;
+
+  // Filled on the audio thread, printed and emptied by the message thread
+  struct Report
+  {
+    enum State
+    {
+      empty,
+      writing,
+      full
+    };
+
+    std::atomic<int> state{empty};
+    Kind kind;
+    const char *function;
+    int numFrames;
+    void *frames[maxFrames];
+  };
+
+  std::atomic<int64_t> counts[numKinds];
+  std::atomic<int64_t> unreported{0};
+  Report reports[queueSize];
+  std::atomic<uint32_t> writeIndex{0};
+
+#if REALTIME_HOOKS
+  // Per-thread state lives in a pthread key rather than a thread_local: on Darwin the
+  // first access to a thread_local goes through dyld's TLV bootstrap, which mallocs and
+  // would re-enter the hook. pthread_getspecific never allocates.
+  enum ThreadState : uintptr_t
+  {
+    outsideWindow,
+    insideWindow,
+    reporting
+  };
+
+  pthread_key_t threadStateKey;
+  std::atomic<bool> threadStateKeyCreated{false};
+
+  ThreadState getThreadState()
+  {
+    if (!threadStateKeyCreated.load(std::memory_order_acquire))
+      return outsideWindow;
+
+    return (ThreadState)(uintptr_t)pthread_getspecific(threadStateKey);
+  }
+
+  void setThreadState(ThreadState state)
+  {
+    pthread_setspecific(threadStateKey, (const void *)(uintptr_t)state);
+  }
+
+  void createThreadStateKey()
+  {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, []
+                 {
+                   if (pthread_key_create(&threadStateKey, nullptr) == 0)
+                     threadStateKeyCreated.store(true, std::memory_order_release);
+                 });
+  }
+
+  void reportViolation(Kind kind, const char *function)
+  {
+    if (getThreadState() != insideWindow)
+      return;
+
+    // backtrace() may lock or allocate itself
+    setThreadState(reporting);
+    counts[kind].fetch_add(1, std::memory_order_relaxed);
+
+    auto &report = reports[writeIndex.fetch_add(1, std::memory_order_relaxed) % queueSize];
+    int expected = Report::empty;
+
+    if (report.state.compare_exchange_strong(expected, Report::writing, std::memory_order_acquire))
+    {
+      report.kind = kind;
+      report.function = function;
+      report.numFrames = backtrace(report.frames, maxFrames);
+      report.state.store(Report::full, std::memory_order_release);
+    }
+    else
+    {
+      unreported.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    setThreadState(insideWindow);
+  }
+#endif
+
+  // te::DeviceManager registers itself with the juce::AudioDeviceManager through a
+  // private juce::AudioIODeviceCallback base, which only a C-style cast can reach
+  juce::AudioIODeviceCallback *getTracktionCallback(te::Engine &engine)
+  {
+    return (juce::AudioIODeviceCallback *)&engine.getDeviceManager();
+  }
+}
+
+#if REALTIME_HOOKS && JUCE_LINUX
+// Definitions in the program take precedence over glibc's, which stay reachable through
+// their internal aliases, so nothing has to be resolved with dlsym (which allocates)
+extern "C"
+{
+  void *__libc_malloc(size_t);
+  void *__libc_calloc(size_t, size_t);
+  void *__libc_realloc(void *, size_t);
+  void *__libc_memalign(size_t, size_t);
+  void __libc_free(void *);
+  int __pthread_mutex_lock(pthread_mutex_t *);
+  int __nanosleep(const struct timespec *, struct timespec *);
+  ssize_t __read(int, void *, size_t);
+  ssize_t __write(int, const void *, size_t);
+}
+
+#define REALTIME_HOOK extern "C" __attribute__((visibility("default")))
+
+REALTIME_HOOK void *malloc(size_t size) noexcept
+{
+  reportViolation(allocation, "malloc");
+  return __libc_malloc(size);
+}
+
+REALTIME_HOOK void *calloc(size_t count, size_t size) noexcept
+{
+  reportViolation(allocation, "calloc");
+  return __libc_calloc(count, size);
+}
+
+REALTIME_HOOK void *realloc(void *ptr, size_t size) noexcept
+{
+  reportViolation(allocation, "realloc");
+  return __libc_realloc(ptr, size);
+}
+
+REALTIME_HOOK int posix_memalign(void **ptr, size_t alignment, size_t size) noexcept
+{
+  reportViolation(allocation, "posix_memalign");
+  if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment % sizeof(void *) != 0)
+    return EINVAL;
+
+  *ptr = __libc_memalign(alignment, size);
+  return *ptr != nullptr ? 0 : ENOMEM;
+}
+
+REALTIME_HOOK void *aligned_alloc(size_t alignment, size_t size) noexcept
+{
+  reportViolation(allocation, "aligned_alloc");
+  return __libc_memalign(alignment, size);
+}
+
+REALTIME_HOOK void free(void *ptr) noexcept
+{
+  if (ptr != nullptr)
+    reportViolation(deallocation, "free");
+
+  __libc_free(ptr);
+}
+
+REALTIME_HOOK int pthread_mutex_lock(pthread_mutex_t *mutex) noexcept
+{
+  reportViolation(lock, "pthread_mutex_lock");
+  return __pthread_mutex_lock(mutex);
+}
+
+REALTIME_HOOK int nanosleep(const struct timespec *duration, struct timespec *remaining)
+{
+  reportViolation(blockingCall, "nanosleep");
+  return __nanosleep(duration, remaining);
+}
+
+REALTIME_HOOK int usleep(useconds_t microseconds)
+{
+  reportViolation(blockingCall, "usleep");
+  const struct timespec duration = {(time_t)(microseconds / 1000000), (long)(microseconds % 1000000) * 1000};
+  return __nanosleep(&duration, nullptr);
+}
+
+REALTIME_HOOK ssize_t read(int fd, void *buffer, size_t size)
+{
+  reportViolation(blockingCall, "read");
+  return __read(fd, buffer, size);
+}
+
+REALTIME_HOOK ssize_t write(int fd, const void *buffer, size_t size)
+{
+  reportViolation(blockingCall, "write");
+  return __write(fd, buffer, size);
+}
+
+#elif REALTIME_HOOKS
+// dyld rebinds every image's calls to these functions, except the calls made from here
+namespace
+{
+  void *hookedMalloc(size_t size)
+  {
+    reportViolation(allocation, "malloc");
+    return malloc(size);
+  }
+
+  void *hookedCalloc(size_t count, size_t size)
+  {
+    reportViolation(allocation, "calloc");
+    return calloc(count, size);
+  }
+
+  void *hookedRealloc(void *ptr, size_t size)
+  {
+    reportViolation(allocation, "realloc");
+    return realloc(ptr, size);
+  }
+
+  int hookedPosixMemalign(void **ptr, size_t alignment, size_t size)
+  {
+    reportViolation(allocation, "posix_memalign");
+    return posix_memalign(ptr, alignment, size);
+  }
+
+  void hookedFree(void *ptr)
+  {
+    if (ptr != nullptr)
+      reportViolation(deallocation, "free");
+
+    free(ptr);
+  }
+
+  int hookedMutexLock(pthread_mutex_t *mutex)
+  {
+    reportViolation(lock, "pthread_mutex_lock");
+    return pthread_mutex_lock(mutex);
+  }
+
+  void hookedUnfairLock(os_unfair_lock_t unfairLock)
+  {
+    reportViolation(lock, "os_unfair_lock_lock");
+    os_unfair_lock_lock(unfairLock);
+  }
+
+  int hookedNanosleep(const struct timespec *duration, struct timespec *remaining)
+  {
+    reportViolation(blockingCall, "nanosleep");
+    return nanosleep(duration, remaining);
+  }
+
+  int hookedUsleep(useconds_t microseconds)
+  {
+    reportViolation(blockingCall, "usleep");
+    return usleep(microseconds);
+  }
+
+  ssize_t hookedRead(int fd, void *buffer, size_t size)
+  {
+    reportViolation(blockingCall, "read");
+    return read(fd, buffer, size);
+  }
+
+  ssize_t hookedWrite(int fd, const void *buffer, size_t size)
+  {
+    reportViolation(blockingCall, "write");
+    return write(fd, buffer, size);
+  }
+}
+
+#define REALTIME_INTERPOSE(replacement, original)                                        \
+  __attribute__((used)) static const struct                                              \
+  {                                                                                      \
+    const void *replacementFunction;                                                     \
+    const void *originalFunction;                                                        \
+  } interpose_##original __attribute__((section("__DATA,__interpose"))) = {             \
+      (const void *)(unsigned long)&replacement, (const void *)(unsigned long)&original};
+
+REALTIME_INTERPOSE(hookedMalloc, malloc)
+REALTIME_INTERPOSE(hookedCalloc, calloc)
+REALTIME_INTERPOSE(hookedRealloc, realloc)
+REALTIME_INTERPOSE(hookedPosixMemalign, posix_memalign)
+REALTIME_INTERPOSE(hookedFree, free)
+REALTIME_INTERPOSE(hookedMutexLock, pthread_mutex_lock)
+REALTIME_INTERPOSE(hookedUnfairLock, os_unfair_lock_lock)
+REALTIME_INTERPOSE(hookedNanosleep, nanosleep)
+REALTIME_INTERPOSE(hookedUsleep, usleep)
+REALTIME_INTERPOSE(hookedRead, read)
+REALTIME_INTERPOSE(hookedWrite, write)
+#endif
+
+// Device callback that opens or closes the checked window on the audio thread
+struct RealtimeSafetyChecker::WindowMarker : public juce::AudioIODeviceCallback
+{
+  explicit WindowMarker(bool opens) : opensWindow(opens) {}
+
+  void audioDeviceIOCallbackWithContext(const float *const *, int, float *const *outputChannelData,
+                                        int numOutputChannels, int numSamples,
+                                        const juce::AudioIODeviceCallbackContext &) override
+  {
+    // Outputs of extra device callbacks are summed into the mix, so leave silence
+    for (int ch = 0; ch < numOutputChannels; ++ch)
+      if (outputChannelData[ch] != nullptr)
+        juce::FloatVectorOperations::clear(outputChannelData[ch], numSamples);
+
+#if REALTIME_HOOKS
+    setThreadState(opensWindow && enabled.load(std::memory_order_relaxed) ? insideWindow : outsideWindow);
+#endif
+  }
+
+  void audioDeviceAboutToStart(juce::AudioIODevice *) override {}
+  void audioDeviceStopped() override {}
+
+  const bool opensWindow;
+  std::atomic<bool> enabled{true};
+};
+
+RealtimeSafetyChecker::RealtimeSafetyChecker(te::Engine &e)
+    : engine(e),
+      windowStart(std::make_unique<WindowMarker>(true)),
+      windowEnd(std::make_unique<WindowMarker>(false))
+{
+  if (!isAvailable())
+  {
+    std::cerr << "Realtime safety checks need a build with SWIFTTRACKTIONKIT_REALTIME_CHECKS=1" << std::endl;
+    return;
+  }
+
+#if REALTIME_HOOKS
+  createThreadStateKey();
+  if (!threadStateKeyCreated.load())
+  {
+    std::cerr << "Realtime safety checks disabled: no thread-specific key available" << std::endl;
+    return;
+  }
+
+  // backtrace() loads its unwinder on first use, which must not happen inside a hook
+  void *frames[maxFrames];
+  backtrace(frames, maxFrames);
+#endif
+
+  // tracktion's callback was added when the engine was created, so take it out and put
+  // it back between the markers. On an open device juce calls its audioDeviceStopped and
+  // audioDeviceAboutToStart, which makes tracktion re-prepare for the device. AudioEngine
+  // creates the checker before its edit, so no playback context is affected; engines that
+  // are already playing get one re-prepared block.
+  auto &deviceManager = engine.getDeviceManager().deviceManager;
+  auto *tracktionCallback = getTracktionCallback(engine);
+
+  deviceManager.removeAudioCallback(tracktionCallback);
+  deviceManager.addAudioCallback(windowStart.get());
+  deviceManager.addAudioCallback(tracktionCallback);
+  deviceManager.addAudioCallback(windowEnd.get());
+
+  startTimer(500);
+}
+
+RealtimeSafetyChecker::~RealtimeSafetyChecker()
+{
+  stopTimer();
+
+  // Start marker first: a block that then runs with only the end marker leaves the
+  // window closed
+  auto &deviceManager = engine.getDeviceManager().deviceManager;
+  deviceManager.removeAudioCallback(windowStart.get());
+  deviceManager.removeAudioCallback(windowEnd.get());
+
+  timerCallback();
+}
+
+bool RealtimeSafetyChecker::isAvailable()
+{
+  return REALTIME_HOOKS != 0;
+}
+
+RealtimeViolations RealtimeSafetyChecker::getViolations()
+{
+  RealtimeViolations violations;
+  violations.allocations = counts[allocation].load();
+  violations.deallocations = counts[deallocation].load();
+  violations.locks = counts[lock].load();
+  violations.blockingCalls = counts[blockingCall].load();
+  violations.unreported = unreported.load();
+  return violations;
+}
+
+void RealtimeSafetyChecker::resetViolations()
+{
+  for (auto &count : counts)
+    count = 0;
+
+  unreported = 0;
+}
+
+void RealtimeSafetyChecker::includeLaterCallbacks()
+{
+  if (!isAvailable())
+    return;
+
+  // Without its end marker a block would leave the window open, so keep it shut meanwhile
+  auto &deviceManager = engine.getDeviceManager().deviceManager;
+  windowStart->enabled = false;
+  deviceManager.removeAudioCallback(windowEnd.get());
+  deviceManager.addAudioCallback(windowEnd.get());
+  windowStart->enabled = true;
+}
+
+void RealtimeSafetyChecker::timerCallback()
+{
+#if REALTIME_HOOKS
+  for (auto &report : reports)
+  {
+    if (report.state.load(std::memory_order_acquire) != Report::full)
+      continue;
+
+    std::cerr << "Realtime violation: " << report.function << " (" << kindNames[report.kind]
+              << ") on the audio thread" << std::endl;
+
+    // Frame 0 is reportViolation and frame 1 the hook
+    if (auto **symbols = backtrace_symbols(report.frames, report.numFrames))
+    {
+      for (int i = 2; i < report.numFrames; ++i)
+        std::cerr << "  " << symbols[i] << std::endl;
+
+      free(symbols);
+    }
+
+    report.state.store(Report::empty, std::memory_order_release);
+  }
+#endif
+}
@@ -0,0 +1,167 @@
+#include "RenderCache.h"
+#include "LoudnessMeter.h"
+#include "TruePeakLimiter.h"
+#include <iostream>
+
+namespace
+{
+  // FNV-1a over the serialised state; collisions only cost a stale cache, not a crash
+  juce::uint64 hashBytes(const void *data, size_t size, juce::uint64 hash)
+  {
+    auto *bytes = static_cast<const juce::uint8 *>(data);
+
+    for (size_t i = 0; i < size; ++i)
+      hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+
+    return hash;
+  }
+}
+
+RenderCache::RenderCache(te::Edit &e) : edit(e) {}
+
+RenderCache::~RenderCache()
+{
+  clear();
+}
+
+void RenderCache::clear()
+{
+  cachedFile.deleteFile();
+  cachedFile = {};
+  cachedKey = {};
+  analysis = {};
+}
+
+juce::String RenderCache::computeKey() const
+{
+  // Transport state changes with every play/stop but doesn't affect the mix
+  juce::MemoryOutputStream data;
+
+  for (int i = 0; i < edit.state.getNumProperties(); ++i)
+  {
+    data << edit.state.getPropertyName(i).toString();
+    edit.state[edit.state.getPropertyName(i)].writeToStream(data);
+  }
+
+  for (const auto &child : edit.state)
+    if (!child.hasType(te::IDs::TRANSPORT))
+      child.writeToStream(data);
+
+  data << juce::String(edit.engine.getDeviceManager().getSampleRate());
+
+  const auto hash = hashBytes(data.getData(), data.getDataSize(), 0xcbf29ce484222325ull);
+  return juce::String::toHexString((juce::int64)hash);
+}
+
+juce::File RenderCache::getOrRender(void (*onprogresschange)(float))
+{
+  edit.flushState();
+  const auto key = computeKey();
+
+  if (key == cachedKey && cachedFile.existsAsFile())
+    return cachedFile;
+
+  clear();
+
+  auto cacheDir = edit.engine.getTemporaryFileManager().getTempDirectory().getChildFile("render-cache");
+  if (!cacheDir.createDirectory())
+  {
+    std::cerr << "Render cache: cannot create " << cacheDir.getFullPathName().toStdString() << std::endl;
+    return {};
+  }
+
+  auto file = cacheDir.getNonexistentChildFile("mix_" + key, ".wav", false);
+  auto &deviceManager = edit.engine.getDeviceManager();
+
+  te::Renderer::Parameters renderParams(edit);
+  renderParams.destFile = file;
+  renderParams.audioFormat = edit.engine.getAudioFileFormatManager().getWavFormat();
+  renderParams.bitDepth = 32;
+  renderParams.sampleRateForAudio = deviceManager.getSampleRate();
+  renderParams.blockSizeForAudio = deviceManager.getBlockSize();
+  renderParams.time = te::TimeRange(te::TimePosition(), te::TimePosition() + edit.getLength());
+  renderParams.usePlugins = true;
+  renderParams.useMasterPlugins = true;
+  renderParams.tracksToDo = te::toBitSet(te::getAllTracks(edit));
+
+  auto job = te::EditRenderJob::getOrCreateRenderJob(edit.engine, renderParams, false, false, false);
+  if (job == nullptr)
+  {
+    std::cerr << "Render cache: could not create render job" << std::endl;
+    return {};
+  }
+
+  auto *renderJob = static_cast<te::EditRenderJob *>(job.get());
+
+  while (renderJob->progress < 1)
+  {
+    if (onprogresschange)
+      onprogresschange(renderJob->getCurrentTaskProgress());
+
+    renderJob->runJob();
+  }
+
+  if (!file.existsAsFile())
+    return {};
+
+  cachedKey = key;
+  cachedFile = file;
+  return cachedFile;
+}
+
+RenderCache::Analysis RenderCache::getAnalysis()
+{
+  if (analysis.valid || !cachedFile.existsAsFile())
+    return analysis;
+
+  auto reader = createReader(cachedFile);
+  if (reader == nullptr)
+    return analysis;
+
+  const int numChannels = (int)juce::jlimit(1u, (unsigned int)LoudnessMeter::maxChannels, reader->numChannels);
+  LoudnessMeter meter;
+  meter.prepare(reader->sampleRate);
+  std::vector<TruePeakDetector> detectors((size_t)numChannels);
+  float truePeak = 0.0f;
+
+  // Stream through the file: memory use doesn't depend on the programme length
+  constexpr int blockSize = 65536;
+  juce::AudioBuffer<float> block(numChannels, blockSize);
+
+  for (juce::int64 position = 0; position < reader->lengthInSamples; position += blockSize)
+  {
+    const int numSamples = (int)std::min((juce::int64)blockSize, reader->lengthInSamples - position);
+    reader->read(&block, 0, numSamples, position, true, numChannels > 1);
+    meter.process(block, 0, numSamples);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+      const float *data = block.getReadPointer(ch);
+      auto &detector = detectors[(size_t)ch];
+
+      for (int i = 0; i < numSamples; ++i)
+        truePeak = std::max(truePeak, detector.processSample(data[i]));
+    }
+  }
+
+  // Flush the detectors so peaks in the last few samples are seen
+  for (auto &detector : detectors)
+    for (int i = 0; i < TruePeakDetector::latency; ++i)
+      truePeak = std::max(truePeak, detector.processSample(0.0f));
+
+  analysis.valid = true;
+  analysis.integratedLufs = meter.getReading().integratedLufs;
+  analysis.truePeakDb = juce::Decibels::gainToDecibels(truePeak, -100.0f);
+  return analysis;
+}
+
+std::unique_ptr<juce::AudioFormatReader> RenderCache::createReader(const juce::File &file)
+{
+  juce::WavAudioFormat wavFormat;
+  auto *stream = file.createInputStream().release();
+  if (stream == nullptr)
+    return nullptr;
+
+  std::unique_ptr<juce::AudioFormatReader> reader(wavFormat.createReaderFor(stream, true));
+  return reader;
+}
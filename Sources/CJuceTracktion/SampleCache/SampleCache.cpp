@@ -0,0 +1,246 @@
+#include "SampleCache.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  juce::String makeKey(const juce::File &file, double targetSampleRate)
+  {
+    return file.getFullPathName() + "@" + juce::String(targetSampleRate)
+           + "#" + juce::String(file.getLastModificationTime().toMilliseconds());
+  }
+
+  std::unique_ptr<juce::AudioFormatReader> createReader(const juce::File &file)
+  {
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+    return std::unique_ptr<juce::AudioFormatReader>(formatManager.createReaderFor(file));
+  }
+
+  // 8th-order Butterworth run forwards and backwards, so it adds no phase shift. The
+  // sinc interpolator doesn't band-limit, so this stands in for its anti-aliasing.
+  void lowPass(juce::AudioBuffer<float> &buffer, double sampleRate, double cutoff)
+  {
+    static constexpr double sectionQ[] = {0.5098, 0.6013, 0.9000, 2.5629};
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+    {
+      auto *data = buffer.getWritePointer(ch);
+
+      for (int pass = 0; pass < 2; ++pass)
+      {
+        for (auto q : sectionQ)
+        {
+          juce::IIRFilter filter;
+          filter.setCoefficients(juce::IIRCoefficients::makeLowPass(sampleRate, cutoff, q));
+          filter.processSamples(data, buffer.getNumSamples());
+        }
+
+        std::reverse(data, data + buffer.getNumSamples());
+      }
+    }
+  }
+
+  std::shared_future<SampleCache::SamplePtr> makeReady(SampleCache::SamplePtr sample)
+  {
+    std::promise<SampleCache::SamplePtr> promise;
+    promise.set_value(std::move(sample));
+    return promise.get_future().share();
+  }
+}
+
+SampleCache &SampleCache::getInstance()
+{
+  static SampleCache cache;
+  return cache;
+}
+
+SampleCache::SampleCache() : pool(juce::jmax(1, juce::SystemStats::getNumCpus())) {}
+
+SampleCache::SamplePtr SampleCache::load(const juce::File &file, double targetSampleRate)
+{
+  auto reader = createReader(file);
+  if (reader == nullptr || reader->lengthInSamples <= 0)
+    return nullptr;
+
+  const int numChannels = (int)juce::jlimit(1u, 2u, reader->numChannels);
+  const int numSamples = (int)reader->lengthInSamples;
+  auto sample = std::make_shared<Sample>();
+
+  if (targetSampleRate <= 0.0 || juce::approximatelyEqual(reader->sampleRate, targetSampleRate))
+  {
+    sample->audio.setSize(numChannels, numSamples);
+    reader->read(&sample->audio, 0, numSamples, 0, true, numChannels > 1);
+    sample->sampleRate = reader->sampleRate;
+    return sample;
+  }
+
+  // The sinc interpolator delays its output, so render extra samples up front and drop
+  // them, and give it a silent tail to read past the end of the file.
+  const double ratio = reader->sampleRate / targetSampleRate;
+  const int latency = (int)std::ceil(juce::WindowedSincInterpolator::getBaseLatency());
+  const int skip = juce::roundToInt(latency / ratio);
+  const int outputSamples = (int)std::ceil(numSamples / ratio);
+  const int inputSamples = (int)std::ceil((skip + outputSamples) * ratio) + latency + 16;
+
+  juce::AudioBuffer<float> input(numChannels, inputSamples);
+  input.clear();
+  reader->read(&input, 0, numSamples, 0, true, numChannels > 1);
+
+  // Going down in rate, nothing above the new Nyquist may be left to fold back
+  if (ratio > 1.0)
+    lowPass(input, reader->sampleRate, 0.45 * targetSampleRate);
+
+  juce::HeapBlock<float> resampled((size_t)(skip + outputSamples));
+  sample->audio.setSize(numChannels, outputSamples);
+  sample->sampleRate = targetSampleRate;
+
+  for (int ch = 0; ch < numChannels; ++ch)
+  {
+    juce::WindowedSincInterpolator interpolator;
+    interpolator.process(ratio, input.getReadPointer(ch), resampled.get(), skip + outputSamples);
+    sample->audio.copyFrom(ch, 0, resampled.get() + skip, outputSamples);
+  }
+
+  return sample;
+}
+
+std::shared_future<SampleCache::SamplePtr> SampleCache::findOrSchedule(const juce::File &file,
+                                                                      double targetSampleRate,
+                                                                      bool runInline)
+{
+  const auto key = makeKey(file, targetSampleRate);
+  auto promise = std::make_shared<std::promise<SamplePtr>>();
+  std::shared_future<SamplePtr> future;
+
+  {
+    std::lock_guard<std::mutex> sl(lock);
+
+    auto found = entries.find(key);
+    if (found != entries.end())
+    {
+      if (found->second.loading.valid())
+        return found->second.loading;
+
+      if (auto sample = found->second.sample.lock())
+        return makeReady(std::move(sample));
+    }
+
+    // Drop entries whose content has been freed, so keys don't pile up
+    for (auto it = entries.begin(); it != entries.end();)
+      it = !it->second.loading.valid() && it->second.sample.expired() ? entries.erase(it) : std::next(it);
+
+    future = promise->get_future().share();
+    entries[key] = {future, {}};
+  }
+
+  auto task = [this, promise, file, targetSampleRate, key]
+  {
+    auto sample = load(file, targetSampleRate);
+
+    {
+      std::lock_guard<std::mutex> sl(lock);
+      auto found = entries.find(key);
+
+      // Failed loads aren't cached so a fixed-up file can be retried
+      if (found != entries.end() && sample == nullptr)
+        entries.erase(found);
+      else if (found != entries.end())
+        found->second = {{}, sample};
+    }
+
+    promise->set_value(std::move(sample));
+  };
+
+  if (runInline)
+    task();
+  else
+    pool.addJob(task);
+
+  return future;
+}
+
+SampleCache::SamplePtr SampleCache::getSample(const juce::File &file, double targetSampleRate)
+{
+  if (!file.existsAsFile())
+    return nullptr;
+
+  return findOrSchedule(file, targetSampleRate, true).get();
+}
+
+std::vector<SampleCache::SamplePtr> SampleCache::prefetch(const std::vector<juce::File> &files, double targetSampleRate)
+{
+  std::vector<std::shared_future<SamplePtr>> pending;
+
+  for (const auto &file : files)
+    if (file.existsAsFile())
+      pending.push_back(findOrSchedule(file, targetSampleRate, false));
+
+  std::vector<SamplePtr> samples;
+
+  for (auto &future : pending)
+    if (auto sample = future.get())
+      samples.push_back(std::move(sample));
+
+  return samples;
+}
+
+juce::File SampleCache::getResampledFile(const juce::File &file, double targetSampleRate, const juce::File &cacheDirectory)
+{
+  if (targetSampleRate <= 0.0)
+    return file;
+
+  {
+    auto reader = createReader(file);
+    if (reader == nullptr || juce::approximatelyEqual(reader->sampleRate, targetSampleRate))
+      return file;
+  }
+
+  auto destination = cacheDirectory.getChildFile(juce::String::toHexString(file.getFullPathName().hashCode64())
+                                                 + "_" + juce::String(juce::roundToInt(targetSampleRate)) + ".wav");
+
+  if (destination.existsAsFile() && destination.getLastModificationTime() >= file.getLastModificationTime())
+    return destination;
+
+  auto sample = getSample(file, targetSampleRate);
+  if (sample == nullptr || !cacheDirectory.createDirectory())
+    return file;
+
+  // Written without the cache's lock. Each writer has its own temporary sibling, so a
+  // concurrent reader never sees a partial file and a second writer just replaces it.
+  juce::TemporaryFile temp(destination);
+  std::unique_ptr<juce::FileOutputStream> stream(temp.getFile().createOutputStream());
+  if (stream == nullptr)
+    return file;
+
+  juce::WavAudioFormat wavFormat;
+  std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(stream.get(), targetSampleRate,
+                                                                            (unsigned int)sample->audio.getNumChannels(),
+                                                                            32, {}, 0));
+  if (writer == nullptr)
+    return file;
+
+  stream.release();
+  writer->writeFromAudioSampleBuffer(sample->audio, 0, sample->audio.getNumSamples());
+  writer.reset();
+
+  return temp.overwriteTargetFileWithTemporary() ? destination : file;
+}
+
+size_t SampleCache::getMemoryBytes() const
+{
+  std::lock_guard<std::mutex> sl(lock);
+  size_t bytes = 0;
+
+  for (auto &entry : entries)
+    if (auto sample = entry.second.sample.lock())
+      bytes += (size_t)sample->audio.getNumChannels() * (size_t)sample->audio.getNumSamples() * sizeof(float);
+
+  return bytes;
+}
+
+void SampleCache::clear()
+{
+  std::lock_guard<std::mutex> sl(lock);
+  entries.clear();
+}
@@ -0,0 +1,286 @@
+#include "TimeStretchProxies.h"
+#include <iostream>
+
+namespace
+{
+  const juce::Identifier proxySourceID("stretchProxySource");
+
+  // The tempo-synced clip's beat count is tied to its source, so carry it across a swap
+  void setSource(te::WaveAudioClip &clip, const juce::File &file)
+  {
+    const double numBeats = clip.getLoopInfo().getNumBeats();
+    clip.getSourceFileReference().setToDirectFileReference(file, false);
+    clip.getLoopInfo().setNumBeats(numBeats);
+  }
+
+  void restoreOriginal(te::WaveAudioClip &clip)
+  {
+    if (!clip.state.hasProperty(proxySourceID))
+      return;
+
+    setSource(clip, juce::File(clip.state[proxySourceID].toString()));
+    clip.state.removeProperty(proxySourceID, nullptr);
+  }
+
+  juce::File getProxyFile(const juce::File &directory, const juce::File &source, double speedRatio)
+  {
+    const auto key = source.getFullPathName() + juce::String(source.getLastModificationTime().toMilliseconds())
+                     + juce::String(speedRatio, 6);
+    return directory.getChildFile("stretch_" + juce::String::toHexString(key.hashCode64()) + ".wav");
+  }
+}
+
+class TimeStretchProxies::RenderJob : public juce::ThreadPoolJob
+{
+public:
+  RenderJob(const juce::File &s, const juce::File &p, double ratio, std::function<void(bool)> onDone)
+      : ThreadPoolJob("Stretch proxy"), source(s), proxy(p), speedRatio(ratio), onFinished(std::move(onDone)) {}
+
+  JobStatus runJob() override
+  {
+    const bool ok = render();
+    juce::MessageManager::callAsync([ok, callback = onFinished] { callback(ok); });
+    return jobHasFinished;
+  }
+
+private:
+  static constexpr int blockSize = 4096;
+
+  bool render()
+  {
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(source));
+    if (reader == nullptr)
+      return false;
+
+    const int numChannels = (int)reader->numChannels;
+
+    // Offline mode lets the stretcher use its higher quality settings
+    te::TimeStretcher stretcher;
+    if (!stretcher.initialise(reader->sampleRate, blockSize, numChannels, te::TimeStretcher::soundtouchBetter,
+                              {}, false))
+      return false;
+
+    stretcher.setSpeedAndPitch((float)speedRatio, 0.0f);
+
+    juce::TemporaryFile temp(proxy);
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::FileOutputStream> stream(temp.getFile().createOutputStream());
+    if (stream == nullptr)
+      return false;
+
+    std::unique_ptr<juce::AudioFormatWriter> writer(
+        wavFormat.createWriterFor(stream.get(), reader->sampleRate, (unsigned int)numChannels, 32, {}, 0));
+    if (writer == nullptr)
+      return false;
+
+    stream.release();
+
+    // Exactly the stretched length, so beat positions in the clip stay where they were
+    const auto outputLength = (juce::int64)std::llround((double)reader->lengthInSamples / speedRatio);
+    juce::AudioBuffer<float> input(numChannels, juce::jmax(1, stretcher.getMaxFramesNeeded()));
+    juce::AudioBuffer<float> output(numChannels, blockSize);
+    juce::int64 readPosition = 0, written = 0;
+
+    auto write = [&](int numSamples)
+    {
+      const int count = (int)std::min((juce::int64)numSamples, outputLength - written);
+      if (count > 0 && !writer->writeFromAudioSampleBuffer(output, 0, count))
+        return false;
+
+      written += juce::jmax(0, count);
+      return true;
+    };
+
+    while (written < outputLength)
+    {
+      if (shouldExit())
+        return false;
+
+      if (readPosition < reader->lengthInSamples)
+      {
+        const int needed = juce::jmin(stretcher.getFramesNeeded(), input.getNumSamples());
+        reader->read(&input, 0, needed, readPosition, true, true);
+        readPosition += needed;
+
+        const int produced = stretcher.processData(input.getArrayOfReadPointers(), needed,
+                                                   output.getArrayOfWritePointers());
+        if (!write(produced) || (needed <= 0 && produced <= 0))
+          break;
+      }
+      else
+      {
+        const int flushed = stretcher.flush(output.getArrayOfWritePointers());
+        if (!write(flushed) || flushed <= 0)
+          break;
+      }
+    }
+
+    // Pad whatever the stretcher held back with silence
+    output.clear();
+    while (written < outputLength)
+      if (!write(blockSize))
+        return false;
+
+    writer.reset();
+    return temp.overwriteTargetFileWithTemporary();
+  }
+
+  const juce::File source, proxy;
+  const double speedRatio;
+  std::function<void(bool)> onFinished;
+};
+
+TimeStretchProxies::TimeStretchProxies(te::Edit &e)
+    : edit(e), renderPool(juce::jmax(1, juce::SystemStats::getNumCpus() / 2))
+{
+  edit.state.addListener(this);
+
+  // Loaded edits may still point at proxies from an earlier session
+  triggerAsyncUpdate();
+}
+
+TimeStretchProxies::~TimeStretchProxies()
+{
+  *alive = false;
+  edit.state.removeListener(this);
+  cancelPendingUpdate();
+  renderPool.removeAllJobs(true, 10000);
+}
+
+void TimeStretchProxies::valueTreePropertyChanged(juce::ValueTree &tree, const juce::Identifier &property)
+{
+  if ((tree.hasType(te::IDs::TEMPO) && property == te::IDs::bpm) || property == te::IDs::autoTempo)
+    triggerAsyncUpdate();
+}
+
+void TimeStretchProxies::valueTreeChildAdded(juce::ValueTree &, juce::ValueTree &child)
+{
+  if (child.hasType(te::IDs::AUDIOCLIP) || child.hasType(te::IDs::TEMPO))
+    triggerAsyncUpdate();
+}
+
+// Coalesces a burst of tempo changes (e.g. a dragged slider) into one pass
+void TimeStretchProxies::handleAsyncUpdate()
+{
+  ++generation;
+  renderPool.removeAllJobs(true, 10000);
+  numPending = 0;
+
+  // Proxies only cover a single tempo; clips in a tempo map keep stretching live
+  const bool constantTempo = edit.tempoSequence.getNumTempos() == 1;
+  const double editBpm = edit.tempoSequence.getTempos()[0]->getBpm();
+
+  auto directory = edit.engine.getTemporaryFileManager().getTempDirectory().getChildFile("stretch-proxies");
+  if (!directory.createDirectory())
+  {
+    std::cerr << "Stretch proxies disabled: cannot create " << directory.getFullPathName().toStdString()
+              << std::endl;
+    return;
+  }
+
+  for (auto *track : te::getAudioTracks(edit))
+  {
+    for (auto *clip : track->getClips())
+    {
+      auto *waveClip = dynamic_cast<te::WaveAudioClip *>(clip);
+      if (waveClip == nullptr)
+        continue;
+
+      const bool proxied = waveClip->state.hasProperty(proxySourceID);
+      const auto current = waveClip->getSourceFileReference().getFile();
+      const auto source = proxied ? juce::File(waveClip->state[proxySourceID].toString()) : current;
+      double speedRatio = 0.0;
+      juce::File proxy;
+
+      if (waveClip->getAutoTempo() && constantTempo)
+      {
+        // tracktion's own proxies leave the clip silent while they render
+        waveClip->setUsesProxy(false);
+
+        // The beat count is the original's, so the bpm comes from the original's length
+        const double sourceBpm = waveClip->getLoopInfo().getBpm(te::AudioFile(edit.engine, source).getInfo());
+        if (sourceBpm > 0.0 && !juce::approximatelyEqual(sourceBpm, editBpm))
+        {
+          speedRatio = editBpm / sourceBpm;
+          proxy = getProxyFile(directory, source, speedRatio);
+        }
+      }
+
+      // Already playing the proxy for this ratio, e.g. after a clip was added elsewhere
+      if (proxied && proxy != juce::File() && current == proxy && proxy.existsAsFile())
+        continue;
+
+      // Back to the original, so the clip stretches live from it until its new proxy lands
+      restoreOriginal(*waveClip);
+
+      if (proxy == juce::File())
+        continue;
+
+      if (proxy.existsAsFile())
+      {
+        applyProxy(*waveClip, proxy);
+        continue;
+      }
+
+      std::weak_ptr<bool> weakAlive = alive;
+      const auto clipID = waveClip->itemID;
+      const auto jobGeneration = generation;
+
+      ++numPending;
+      renderPool.addJob(new RenderJob(source, proxy, speedRatio,
+                                      [this, weakAlive, jobGeneration, clipID, proxy](bool ok)
+                                      {
+                                        if (weakAlive.lock())
+                                          renderFinished(jobGeneration, clipID, ok ? proxy : juce::File());
+                                      }),
+                        true);
+    }
+  }
+}
+
+void TimeStretchProxies::renderFinished(juce::int64 jobGeneration, te::EditItemID clipID, const juce::File &proxy)
+{
+  // A later tempo change superseded this render; the file stays cached for that tempo
+  if (jobGeneration != generation)
+    return;
+
+  --numPending;
+
+  if (proxy == juce::File())
+  {
+    std::cerr << "Stretch proxy failed, clip keeps stretching live" << std::endl;
+    return;
+  }
+
+  if (auto *waveClip = dynamic_cast<te::WaveAudioClip *>(te::findClipForID(edit, clipID)))
+    if (waveClip->getAutoTempo())
+      applyProxy(*waveClip, proxy);
+}
+
+void TimeStretchProxies::removeStretchProxies(juce::ValueTree &editState)
+{
+  for (auto child : editState)
+  {
+    if (child.hasType(te::IDs::AUDIOCLIP) && child.hasProperty(proxySourceID))
+    {
+      child.setProperty(te::IDs::source, child[proxySourceID], nullptr);
+      child.removeProperty(proxySourceID, nullptr);
+    }
+    else
+    {
+      removeStretchProxies(child);
+    }
+  }
+}
+
+void TimeStretchProxies::applyProxy(te::WaveAudioClip &clip, const juce::File &proxy)
+{
+  if (!clip.state.hasProperty(proxySourceID))
+    clip.state.setProperty(proxySourceID, clip.getSourceFileReference().getFile().getFullPathName(), nullptr);
+
+  // The proxy's tempo now matches the edit's, so the clip plays it at its natural speed
+  setSource(clip, proxy);
+}
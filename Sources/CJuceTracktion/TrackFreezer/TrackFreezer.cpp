@@ -0,0 +1,328 @@
+#include "TrackFreezer.h"
+#include "MeterPlugin.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+  const juce::Identifier freezeProxyID("bridgeFreezeProxy");
+  const juce::Identifier frozenSourceID("bridgeFrozen");
+
+  // Meters only read the signal, so inserting or moving one leaves the render valid
+  bool isMeter(const juce::ValueTree &tree)
+  {
+    return tree.hasType(te::IDs::PLUGIN) && tree[te::IDs::type].toString() == MeterPlugin::xmlTypeName;
+  }
+
+  bool isInsideMeter(juce::ValueTree tree)
+  {
+    for (; tree.isValid(); tree = tree.getParent())
+      if (isMeter(tree))
+        return true;
+
+    return false;
+  }
+
+  // Properties that change how a track looks rather than what it plays
+  bool isCosmeticProperty(const juce::Identifier &property)
+  {
+    static const juce::Identifier cosmetic[] = {"name", "colour", "height", "expanded", "selected", "process",
+                                                freezeProxyID, frozenSourceID};
+    return std::find(std::begin(cosmetic), std::end(cosmetic), property) != std::end(cosmetic);
+  }
+}
+
+struct TrackFreezer::FrozenTrack : private juce::ValueTree::Listener,
+                                   private juce::AsyncUpdater
+{
+  FrozenTrack(TrackFreezer &o, te::AudioTrack &t)
+      : owner(o), trackID(t.itemID.getRawID()), state(t.state)
+  {
+    state.addListener(this);
+  }
+
+  ~FrozenTrack() override
+  {
+    state.removeListener(this);
+  }
+
+  TrackFreezer &owner;
+  const int trackID;
+  juce::ValueTree state;
+  juce::File file;
+  te::Track::Ptr proxyTrack;
+  bool rendering = true;
+  bool staleRender = false;
+  bool ignoreChanges = false;
+
+private:
+  // Any change to the track, its clips or its plugins invalidates the render
+  void trackEdited()
+  {
+    if (ignoreChanges)
+      return;
+
+    if (rendering)
+      staleRender = true;
+    else
+      triggerAsyncUpdate();
+  }
+
+  void handleAsyncUpdate() override { owner.unfreezeAfterEdit(trackID); }
+
+  void valueTreePropertyChanged(juce::ValueTree &tree, const juce::Identifier &property) override
+  {
+    if (!isCosmeticProperty(property) && !isInsideMeter(tree))
+      trackEdited();
+  }
+
+  void valueTreeChildAdded(juce::ValueTree &parent, juce::ValueTree &child) override
+  {
+    if (!isMeter(child) && !isInsideMeter(parent))
+      trackEdited();
+  }
+
+  void valueTreeChildRemoved(juce::ValueTree &parent, juce::ValueTree &child, int) override
+  {
+    if (!isMeter(child) && !isInsideMeter(parent))
+      trackEdited();
+  }
+
+  // Plugin order matters, except for where a meter sits
+  void valueTreeChildOrderChanged(juce::ValueTree &parent, int, int) override
+  {
+    if (!isInsideMeter(parent))
+      trackEdited();
+  }
+};
+
+class TrackFreezer::RenderRunner : public juce::ThreadPoolJob
+{
+public:
+  RenderRunner(juce::ReferenceCountedObjectPtr<te::RenderManager::Job> j, std::function<void()> onDone)
+      : ThreadPoolJob("Freeze"), job(std::move(j)), onFinished(std::move(onDone)) {}
+
+  JobStatus runJob() override
+  {
+    auto *renderJob = static_cast<te::EditRenderJob *>(job.get());
+
+    while (renderJob->progress < 1 && !shouldExit())
+      renderJob->runJob();
+
+    juce::MessageManager::callAsync(onFinished);
+    return jobHasFinished;
+  }
+
+private:
+  juce::ReferenceCountedObjectPtr<te::RenderManager::Job> job;
+  std::function<void()> onFinished;
+};
+
+TrackFreezer::TrackFreezer(te::Edit &e) : edit(e) {}
+
+TrackFreezer::~TrackFreezer()
+{
+  *alive = false;
+  renderPool.removeAllJobs(true, 10000);
+
+  // The proxies play files that are about to go, so the sources take over again
+  for (auto &entry : tracks)
+  {
+    restore(*entry.second, dynamic_cast<te::AudioTrack *>(
+                               te::findTrackForID(edit, te::EditItemID::fromRawID(entry.first))));
+    entry.second->file.deleteFile();
+  }
+}
+
+bool TrackFreezer::freeze(te::AudioTrack &track)
+{
+  const int trackID = track.itemID.getRawID();
+
+  if (tracks.count(trackID) > 0)
+    return true;
+
+  auto cacheDir = edit.engine.getTemporaryFileManager().getTempDirectory().getChildFile("freeze");
+  if (!cacheDir.createDirectory())
+  {
+    std::cerr << "Freeze failed: cannot create cache directory" << std::endl;
+    return false;
+  }
+
+  auto entry = std::make_unique<FrozenTrack>(*this, track);
+  entry->file = cacheDir.getNonexistentChildFile("track_" + juce::String(trackID), ".wav", false);
+
+  auto &deviceManager = edit.engine.getDeviceManager();
+
+  te::Renderer::Parameters renderParams(edit);
+  renderParams.destFile = entry->file;
+  renderParams.audioFormat = edit.engine.getAudioFileFormatManager().getWavFormat();
+  renderParams.bitDepth = 32;
+  renderParams.sampleRateForAudio = deviceManager.getSampleRate();
+  renderParams.blockSizeForAudio = deviceManager.getBlockSize();
+  renderParams.time = te::TimeRange(te::TimePosition(), te::TimePosition() + edit.getLength());
+  renderParams.usePlugins = true;
+  renderParams.useMasterPlugins = false;
+  renderParams.tracksToDo = te::toBitSet(juce::Array<te::Track *>{&track});
+
+  auto job = te::EditRenderJob::getOrCreateRenderJob(edit.engine, renderParams, false, false, false);
+  if (job == nullptr)
+  {
+    std::cerr << "Freeze failed: could not create render job" << std::endl;
+    return false;
+  }
+
+  auto file = entry->file;
+  tracks[trackID] = std::move(entry);
+
+  std::weak_ptr<bool> weakAlive = alive;
+  renderPool.addJob(new RenderRunner(job, [this, weakAlive, trackID, file]
+                                     {
+                                       if (weakAlive.lock())
+                                         renderFinished(trackID, file);
+                                     }),
+                    true);
+  return true;
+}
+
+void TrackFreezer::renderFinished(int trackID, const juce::File &file)
+{
+  auto found = tracks.find(trackID);
+  if (found == tracks.end() || found->second->file != file)
+  {
+    file.deleteFile();
+    return;
+  }
+
+  auto &entry = *found->second;
+  auto *track = dynamic_cast<te::AudioTrack *>(te::findTrackForID(edit, te::EditItemID::fromRawID(trackID)));
+  te::AudioFile audioFile(edit.engine, file);
+
+  if (track == nullptr || entry.staleRender || !audioFile.isValid())
+  {
+    file.deleteFile();
+    tracks.erase(found);
+    return;
+  }
+
+  // Swap in a proxy track that only plays the rendered file
+  entry.ignoreChanges = true;
+
+  if (auto proxy = edit.insertNewAudioTrack(te::TrackInsertPoint(nullptr, track), nullptr))
+  {
+    proxy->state.setProperty(freezeProxyID, true, nullptr);
+    proxy->setName(track->getName() + " [frozen]");
+    proxy->insertWaveClip(file.getFileNameWithoutExtension(),
+                          file,
+                          {{{}, te::TimeDuration::fromSeconds(audioFile.getLength())}, {}},
+                          false);
+    entry.proxyTrack = proxy.get();
+    track->state.setProperty(frozenSourceID, true, nullptr);
+    track->setProcessing(false);
+  }
+
+  entry.ignoreChanges = false;
+  entry.rendering = false;
+
+  if (entry.proxyTrack == nullptr)
+  {
+    std::cerr << "Freeze failed: could not create proxy track" << std::endl;
+    file.deleteFile();
+    tracks.erase(found);
+  }
+}
+
+bool TrackFreezer::unfreeze(te::AudioTrack &track)
+{
+  auto found = tracks.find(track.itemID.getRawID());
+  if (found == tracks.end())
+    return false;
+
+  auto &entry = *found->second;
+  restore(entry, &track);
+
+  // A render still in flight finds no entry and deletes its own file
+  if (!entry.rendering)
+    entry.file.deleteFile();
+
+  tracks.erase(found);
+  return true;
+}
+
+void TrackFreezer::unfreezeAfterEdit(int trackID)
+{
+  if (auto *track = dynamic_cast<te::AudioTrack *>(te::findTrackForID(edit, te::EditItemID::fromRawID(trackID))))
+  {
+    unfreeze(*track);
+    return;
+  }
+
+  // The source was deleted, so its proxy goes too
+  auto found = tracks.find(trackID);
+  if (found == tracks.end())
+    return;
+
+  restore(*found->second, nullptr);
+
+  if (!found->second->rendering)
+    found->second->file.deleteFile();
+
+  tracks.erase(found);
+}
+
+void TrackFreezer::restore(FrozenTrack &entry, te::AudioTrack *track)
+{
+  entry.ignoreChanges = true;
+
+  if (entry.proxyTrack != nullptr)
+  {
+    edit.deleteTrack(entry.proxyTrack.get());
+    entry.proxyTrack = nullptr;
+  }
+
+  if (track != nullptr && track->state.hasProperty(frozenSourceID))
+  {
+    track->state.removeProperty(frozenSourceID, nullptr);
+    track->setProcessing(true);
+  }
+
+  entry.ignoreChanges = false;
+}
+
+bool TrackFreezer::isFrozen(const te::AudioTrack &track) const
+{
+  auto found = tracks.find(track.itemID.getRawID());
+  return found != tracks.end() && !found->second->rendering;
+}
+
+bool TrackFreezer::isFreezing(const te::AudioTrack &track) const
+{
+  auto found = tracks.find(track.itemID.getRawID());
+  return found != tracks.end() && found->second->rendering;
+}
+
+bool TrackFreezer::isFreezeProxy(const te::Track &track)
+{
+  return track.state.getProperty(freezeProxyID, false);
+}
+
+void TrackFreezer::removeFreezeProxies(juce::ValueTree &editState)
+{
+  for (int i = editState.getNumChildren(); --i >= 0;)
+  {
+    auto child = editState.getChild(i);
+
+    if (child.getProperty(freezeProxyID, false))
+    {
+      editState.removeChild(i, nullptr);
+    }
+    else if (child.hasProperty(frozenSourceID))
+    {
+      child.removeProperty(frozenSourceID, nullptr);
+      child.setProperty(te::IDs::process, true, nullptr);
+    }
+    else if (child.hasType(te::IDs::FOLDERTRACK))
+    {
+      removeFreezeProxies(child);
+    }
+  }
+}
@@ -1,7 +1,41 @@
 #include "TrackManager.h"
+#include "BridgeEngineBehaviour.h"
+#include "DrumSamplerPlugin.h"
+#include "GraphRebuildTimer.h"
+#include "MeterPlugin.h"
+#include "PresetRegistry.h"
+#include "SampleCache.h"
 #include <iostream>
 #include <juce_core/juce_core.h>
 
+namespace
+{
+  // The file tracktion should stream from: a cached copy at the device rate when
+  // pre-resampling is on, otherwise the original. In-memory projects never write the
+  // copy, so their streamed clips keep resampling during playback.
+  juce::File getPlaybackFile(te::Engine &engine, const juce::File &file)
+  {
+    const double rate = BridgeEngineBehaviour::getPreResampleRate(engine);
+    if (rate <= 0.0 || !BridgeEngineBehaviour::canWriteCacheFiles(engine))
+      return file;
+
+    auto cacheDir = engine.getTemporaryFileManager().getTempDirectory().getChildFile("resampled");
+    return SampleCache::getInstance().getResampledFile(file, rate, cacheDir);
+  }
+
+  // Decodes (and resamples) every file in the builder in parallel before the plugin
+  // loads them one by one from the cache, which only keeps them while they're held
+  std::vector<SampleCache::SamplePtr> prefetchSamples(te::Engine &engine, const SamplerPluginBuilder &builder)
+  {
+    std::vector<juce::File> files;
+
+    for (const auto &sample : builder.getSamples())
+      files.emplace_back(sample.filePath);
+
+    return SampleCache::getInstance().prefetch(files, BridgeEngineBehaviour::getPreResampleRate(engine));
+  }
+}
+
 // SamplerPluginBuilder implementation
 SamplerPluginBuilder::SamplerPluginBuilder() = default;
 SamplerPluginBuilder::~SamplerPluginBuilder() = default;
@@ -10,6 +44,14 @@ void SamplerPluginBuilder::addSample(const std::string& filePath, int noteNumber
     samples.emplace_back(filePath, noteNumber);
 }
 
+void SamplerPluginBuilder::addSample(const std::string& filePath, int noteNumber, int chokeGroup) {
+    samples.emplace_back(filePath, noteNumber, chokeGroup);
+}
+
+void SamplerPluginBuilder::setMaxPolyphony(int voices) {
+    maxPolyphony = voices;
+}
+
 const std::vector<SamplerSample>& SamplerPluginBuilder::getSamples() const {
     return samples;
 }
@@ -24,16 +66,44 @@ TrackManager *TrackManager::create(te::Edit *edit)
   return new TrackManager(edit);
 }
 
-TrackManager::TrackManager(te::Edit *edit) : edit(edit) {}
+TrackManager::TrackManager(te::Edit *edit) : edit(edit)
+{
+  if (edit)
+    BridgeEngineBehaviour::addEditFollower(edit->engine, this);
+}
+
+TrackManager::~TrackManager()
+{
+  if (edit)
+    BridgeEngineBehaviour::removeEditFollower(edit->engine, this);
+}
+
+void TrackManager::editReplaced(te::Edit *newEdit)
+{
+  // Both refer to the old edit's tracks
+  freezer.reset();
+  recorder.reset();
+  batch.lastInsertedTrack = nullptr;
+  edit = newEdit;
+}
 
-TrackManager::~TrackManager() = default;
+bool TrackManager::isHoldingEdit() const
+{
+  return batch.isActive() || isRecording();
+}
 
 int TrackManager::createAudioTrack(const std::string &name)
 {
   if (!edit)
     return -1;
 
-  auto newTrack = edit->insertNewAudioTrack(te::TrackInsertPoint(nullptr, te::getAllTracks(*edit).getLast()), nullptr);
+  batch.markStructuralChange();
+
+  te::Track *preceding = batch.isActive() && batch.lastInsertedTrack != nullptr
+                             ? batch.lastInsertedTrack.get()
+                             : te::getAllTracks(*edit).getLast();
+
+  auto newTrack = edit->insertNewAudioTrack(te::TrackInsertPoint(nullptr, preceding), nullptr);
   if (!newTrack)
   {
     std::cerr << "Failed to create audio track" << std::endl;
@@ -41,6 +111,11 @@ int TrackManager::createAudioTrack(const std::string &name)
   }
 
   newTrack->setName(name);
+  // Part of the track from the start, so reading its level never changes the edit
+  MeterPlugin::addTo(*edit, newTrack->pluginList);
+
+  if (batch.isActive())
+    batch.lastInsertedTrack = newTrack.get();
 
   return newTrack.get()->itemID.getRawID();
 }
@@ -52,6 +127,14 @@ bool TrackManager::removeTrack(int trackID)
   if (!targetTrack)
     return false;
 
+  batch.markStructuralChange();
+
+  if (batch.lastInsertedTrack.get() == targetTrack)
+    batch.lastInsertedTrack = nullptr;
+
+  if (auto *audioTrack = dynamic_cast<te::AudioTrack *>(targetTrack); audioTrack && freezer)
+    freezer->unfreeze(*audioTrack);
+
   edit->deleteTrack(targetTrack);
 
   return true;
@@ -61,6 +144,15 @@ bool TrackManager::addAudioClip(int trackID,
                                 const std::string &filePath,
                                 double startBar,
                                 double lengthInBars)
+{
+  return addAudioClip(trackID, filePath, startBar, lengthInBars, 0.0);
+}
+
+bool TrackManager::addAudioClip(int trackID,
+                                const std::string &filePath,
+                                double startBar,
+                                double lengthInBars,
+                                double sourceBpm)
 {
   // Validate trackID
   te::Track *targetTrack = te::findTrackForID(*edit, te::EditItemID::fromRawID(trackID));
@@ -86,17 +178,41 @@ bool TrackManager::addAudioClip(int trackID,
     return false;
   }
 
+  batch.markStructuralChange();
+
+  if (auto newClip = insertAudioClip(*audioTrack, file, {}))
+  {
+    if (sourceBpm > 0.0)
+    {
+      newClip->getLoopInfo().setBpm(sourceBpm, newClip->getAudioFile().getInfo());
+      newClip->setAutoTempo(true);
+
+      // tracktion's own proxies are files too, and leave the clip silent while they render.
+      // TimeStretchProxies makes its own where cache files are allowed.
+      newClip->setUsesProxy(false);
+    }
+
+    return true;
+  }
+  return false;
+}
+
+te::WaveAudioClip::Ptr TrackManager::insertAudioClip(te::AudioTrack &track, const juce::File &sourceFile,
+                                                     te::TimePosition start, te::TimeDuration offset)
+{
+  const auto file = getPlaybackFile(edit->engine, sourceFile);
+
   // Assign the audio file to the clip
   te::AudioFile audioFile(edit->engine, file);
 
-  if (audioFile.isValid())
-    if (auto newClip = audioTrack->insertWaveClip(
-            file.getFileNameWithoutExtension(),
-            file,
-            {{{}, te::TimeDuration::fromSeconds(audioFile.getLength())}, {}},
-            false))
-      return newClip != nullptr;
-  return false;
+  if (!audioFile.isValid())
+    return {};
+
+  const auto length = te::TimeDuration::fromSeconds(audioFile.getLength()) - offset;
+  if (length <= te::TimeDuration())
+    return {};
+
+  return track.insertWaveClip(file.getFileNameWithoutExtension(), file, {{start, length}, offset}, false);
 }
 
 int TrackManager::addMidiClip(int trackID, double startBar, double lengthInBars)
@@ -108,7 +224,7 @@ int TrackManager::addMidiClip(int trackID, double startBar, double lengthInBars)
   }
 
   // Check if the track exists
-  auto targetTrack = edit->getTrackList().at(trackID);
+  auto targetTrack = te::findTrackForID(*edit, te::EditItemID::fromRawID(trackID));
   if (!targetTrack)
   {
     std::cout << "No track found for id - " << trackID;
@@ -123,6 +239,8 @@ int TrackManager::addMidiClip(int trackID, double startBar, double lengthInBars)
 
   std::cout << "dynamic_cast to audio track done";
 
+  batch.markStructuralChange();
+
   // Convert bars to time using the TempoSequence
   auto &tempoSequence = edit->tempoSequence;
   te::TimePosition startPosition = te::toTime(te::BeatPosition::fromBeats(startBar), tempoSequence);
@@ -153,19 +271,81 @@ void TrackManager::createSamplerPluginWithBuilder(int trackID, const SamplerPlug
   if (!audioTrack)
     return;
 
+  batch.markStructuralChange();
+
   if (auto sampler = dynamic_cast<te::SamplerPlugin *>(edit->getPluginCache().createNewPlugin(te::SamplerPlugin::xmlTypeName, {}).get()))
   {
     audioTrack->pluginList.insertPlugin(sampler, 0, nullptr);
 
+    const bool preResample = BridgeEngineBehaviour::getPreResampleRate(edit->engine) > 0.0
+                             && BridgeEngineBehaviour::canWriteCacheFiles(edit->engine);
+    std::vector<SampleCache::SamplePtr> prefetched;
+    if (preResample)
+      prefetched = prefetchSamples(edit->engine, builder);
+
     for (const auto &sample : builder.getSamples())
     {
-      const auto error = sampler->addSound(sample.filePath, sample.filePath, 0.0, 0.0, 1.0f);
+      const auto path = preResample ? getPlaybackFile(edit->engine, juce::File(sample.filePath)).getFullPathName()
+                                    : juce::String(sample.filePath);
+      const auto error = sampler->addSound(path, sample.filePath, 0.0, 0.0, 1.0f);
       sampler->setSoundParams(sampler->getNumSounds() - 1, sample.noteNumber, sample.noteNumber, sample.noteNumber);
       jassert(error.isEmpty());
     }
   }
 }
 
+void TrackManager::createDrumSamplerPluginWithBuilder(int trackID, const SamplerPluginBuilder& builder)
+{
+  auto *audioTrack = findAudioTrack(trackID);
+  if (!audioTrack)
+    return;
+
+  batch.markStructuralChange();
+
+  if (auto sampler = dynamic_cast<DrumSamplerPlugin *>(edit->getPluginCache().createNewPlugin(DrumSamplerPlugin::xmlTypeName, {}).get()))
+  {
+    audioTrack->pluginList.insertPlugin(sampler, 0, nullptr);
+    sampler->setMaxPolyphony(builder.getMaxPolyphony());
+    const auto prefetched = prefetchSamples(edit->engine, builder);
+
+    for (const auto &sample : builder.getSamples())
+    {
+      const auto error = sampler->addSound(sample.filePath, sample.noteNumber, sample.chokeGroup, 1.0f);
+      if (error.isNotEmpty())
+        std::cerr << error.toStdString() << std::endl;
+    }
+  }
+}
+
+bool TrackManager::createPresetPlugin(int trackID, const std::string &presetName)
+{
+  auto *audioTrack = findAudioTrack(trackID);
+  if (!audioTrack)
+    return false;
+
+  auto plugin = PresetRegistry::createPlugin(*edit, presetName);
+  if (plugin == nullptr)
+  {
+    std::cerr << "Unknown preset: " << presetName << std::endl;
+    return false;
+  }
+
+  batch.markStructuralChange();
+
+  audioTrack->pluginList.insertPlugin(plugin, 0, nullptr);
+  return true;
+}
+
+bool TrackManager::applyPreset(int trackID, int pluginIndex, const std::string &presetName)
+{
+  auto *audioTrack = findAudioTrack(trackID);
+  if (!audioTrack)
+    return false;
+
+  auto *plugin = audioTrack->pluginList[pluginIndex];
+  return plugin != nullptr && PresetRegistry::applyPreset(*plugin, presetName);
+}
+
 void TrackManager::createSamplerPlugin(int trackID, std::vector<std::string> defaultSampleFiles)
 {
   if (!edit)
@@ -179,6 +359,8 @@ void TrackManager::createSamplerPlugin(int trackID, std::vector<std::string> def
   if (!audioTrack)
     return;
 
+  batch.markStructuralChange();
+
   if (auto sampler = dynamic_cast<te::SamplerPlugin *>(edit->getPluginCache().createNewPlugin(te::SamplerPlugin::xmlTypeName, {}).get()))
   {
     audioTrack->pluginList.insertPlugin(sampler, 0, nullptr);
@@ -194,6 +376,133 @@ void TrackManager::createSamplerPlugin(int trackID, std::vector<std::string> def
   }
 }
 
+void TrackManager::beginBatch()
+{
+  if (!edit)
+    return;
+
+  batch.begin(*edit);
+}
+
+void TrackManager::commitBatch()
+{
+  if (!edit || !batch.commit(*edit) || !batch.restartedPlayback())
+    return;
+
+  if (auto *timer = GraphRebuildTimer::get(edit->engine))
+    timer->restartRequested();
+}
+
+bool TrackManager::isBatching() const
+{
+  return batch.isActive();
+}
+
+te::AudioTrack *TrackManager::findAudioTrack(int trackID) const
+{
+  if (!edit)
+    return nullptr;
+
+  return dynamic_cast<te::AudioTrack *>(te::findTrackForID(*edit, te::EditItemID::fromRawID(trackID)));
+}
+
+bool TrackManager::freezeTrack(int trackID)
+{
+  auto *audioTrack = findAudioTrack(trackID);
+  if (!audioTrack)
+    return false;
+
+  if (!freezer)
+    freezer = std::make_unique<TrackFreezer>(*edit);
+
+  return freezer->freeze(*audioTrack);
+}
+
+bool TrackManager::unfreezeTrack(int trackID)
+{
+  auto *audioTrack = findAudioTrack(trackID);
+  if (!audioTrack || !freezer)
+    return false;
+
+  return freezer->unfreeze(*audioTrack);
+}
+
+bool TrackManager::isTrackFrozen(int trackID) const
+{
+  auto *audioTrack = findAudioTrack(trackID);
+  return audioTrack && freezer && freezer->isFrozen(*audioTrack);
+}
+
+bool TrackManager::armTrack(int trackID, int firstInputChannel, int numChannels)
+{
+  auto *audioTrack = findAudioTrack(trackID);
+  if (!audioTrack)
+    return false;
+
+  if (!recorder)
+    recorder = std::make_unique<AudioRecorder>(*edit);
+
+  return recorder->arm(trackID, audioTrack->getName(), firstInputChannel, numChannels);
+}
+
+bool TrackManager::disarmTrack(int trackID)
+{
+  return recorder && recorder->disarm(trackID);
+}
+
+bool TrackManager::isTrackArmed(int trackID) const
+{
+  return recorder && recorder->isArmed(trackID);
+}
+
+bool TrackManager::startRecording(const std::string &directoryPath)
+{
+  if (!recorder)
+    return false;
+
+  const auto directory = directoryPath.empty()
+                             ? edit->engine.getTemporaryFileManager().getTempDirectory().getChildFile("recordings")
+                             : juce::File(directoryPath);
+  return recorder->start(directory);
+}
+
+int TrackManager::stopRecording()
+{
+  if (!recorder)
+    return 0;
+
+  const auto takes = recorder->stop();
+  int numClips = 0;
+
+  batch.markStructuralChange();
+
+  for (const auto &take : takes)
+    if (auto *audioTrack = findAudioTrack(take.trackID))
+      if (insertAudioClip(*audioTrack, take.file, te::TimePosition::fromSeconds(take.startSeconds),
+                          te::TimeDuration::fromSeconds(take.offsetSeconds)))
+        ++numClips;
+
+  return numClips;
+}
+
+bool TrackManager::isRecording() const
+{
+  return recorder && recorder->isRecording();
+}
+
+AudioRecordingStats TrackManager::getRecordingStats() const
+{
+  return recorder ? recorder->getStats() : AudioRecordingStats();
+}
+
+bool TrackManager::setFakeRecordingInput(const std::string &filePath, bool loop)
+{
+  if (!recorder)
+    recorder = std::make_unique<AudioRecorder>(*edit);
+
+  return recorder->setFakeInput(filePath.empty() ? juce::File() : juce::File(filePath), loop);
+}
+
 void retainTrackManager(TrackManager *manager)
 {
   manager->refCount++;
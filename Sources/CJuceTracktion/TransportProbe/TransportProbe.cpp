@@ -0,0 +1,218 @@
+#include "TransportProbe.h"
+#include "BridgeEngineBehaviour.h"
+#include <algorithm>
+#include <cstring>
+
+const char *TransportProbePlugin::xmlTypeName = "bridgeTransportProbe";
+
+TransportProbe::TransportProbe(te::Engine &e) : engine(e)
+{
+  write(TransportSnapshot());
+
+  if (auto *behaviour = BridgeEngineBehaviour::get(engine))
+    behaviour->transportProbe = this;
+}
+
+TransportProbe::~TransportProbe()
+{
+  detach();
+
+  if (auto *behaviour = BridgeEngineBehaviour::get(engine))
+    behaviour->transportProbe = nullptr;
+}
+
+TransportProbe *TransportProbe::get(te::Engine &engine)
+{
+  auto *behaviour = BridgeEngineBehaviour::get(engine);
+  return behaviour != nullptr ? behaviour->transportProbe.load() : nullptr;
+}
+
+void TransportProbe::attach(te::Edit &e)
+{
+  detach();
+  edit = &e;
+
+  auto &masterPlugins = edit->getMasterPluginList();
+  if (masterPlugins.findFirstPluginOfType<TransportProbePlugin>() == nullptr)
+  {
+    if (auto plugin = edit->getPluginCache().createNewPlugin(TransportProbePlugin::xmlTypeName, {}))
+    {
+      masterPlugins.insertPlugin(plugin, 0, nullptr);
+
+      // Not something the user did, so it mustn't be undoable
+      edit->getUndoManager().clearUndoHistory();
+    }
+  }
+
+  edit->state.addListener(this);
+  handleAsyncUpdate();
+}
+
+void TransportProbe::detach()
+{
+  if (edit == nullptr)
+    return;
+
+  edit->state.removeListener(this);
+  cancelPendingUpdate();
+  edit = nullptr;
+
+  // The old edit's probe plugin keeps running until the edit is deleted, but stops
+  // publishing once there's no timeline
+  timeline = nullptr;
+  for (int i = 0; i < 100 && timelineInUse.load() != nullptr; ++i)
+    juce::Thread::sleep(1);
+
+  freeRetiredTimelines();
+}
+
+TransportSnapshot TransportProbe::read() const
+{
+  std::array<uint64_t, numWords> buffer;
+  uint32_t before, after;
+
+  do
+  {
+    before = sequence.load(std::memory_order_acquire);
+
+    for (size_t i = 0; i < numWords; ++i)
+      buffer[i] = words[i].load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = sequence.load(std::memory_order_relaxed);
+  } while ((before & 1) != 0 || before != after);
+
+  TransportSnapshot snapshot;
+  std::memcpy(&snapshot, buffer.data(), sizeof(snapshot));
+  return snapshot;
+}
+
+void TransportProbe::write(const TransportSnapshot &snapshot)
+{
+  std::array<uint64_t, numWords> buffer{};
+  std::memcpy(buffer.data(), &snapshot, sizeof(snapshot));
+
+  // Odd while writing, so readers retry instead of seeing a torn snapshot
+  const auto current = sequence.load(std::memory_order_relaxed);
+  sequence.store(current + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  for (size_t i = 0; i < numWords; ++i)
+    words[i].store(buffer[i], std::memory_order_relaxed);
+
+  sequence.store(current + 2, std::memory_order_release);
+}
+
+void TransportProbe::publish(te::TimePosition position, bool isPlaying, double sampleRate)
+{
+  // Announce the timeline before using it, then make sure it wasn't replaced meanwhile,
+  // so the message thread never frees one that's being read
+  auto *current = timeline.load();
+  for (;;)
+  {
+    timelineInUse = current;
+    auto *latest = timeline.load();
+    if (latest == current)
+      break;
+
+    current = latest;
+  }
+
+  if (current == nullptr)
+    return;
+
+  TransportSnapshot snapshot;
+  snapshot.isPlaying = isPlaying;
+  snapshot.samplePosition = te::toSamples(position, sampleRate);
+  snapshot.seconds = position.inSeconds();
+  snapshot.sampleRate = sampleRate;
+
+  te::tempo::Sequence::Position tempoPosition(current->sequence);
+  tempoPosition.set(position);
+
+  const auto barsBeats = tempoPosition.getBarsBeats();
+  const auto timeSig = tempoPosition.getTimeSignature();
+  snapshot.beats = tempoPosition.getBeats().inBeats();
+  snapshot.bar = barsBeats.bars;
+  snapshot.beatInBar = barsBeats.beats.inBeats();
+  snapshot.bpm = tempoPosition.getTempo();
+  snapshot.timeSigNumerator = timeSig.numerator;
+  snapshot.timeSigDenominator = timeSig.denominator;
+
+  snapshot.isLooping = current->looping;
+  snapshot.loopStartSeconds = current->loopRange.getStart().inSeconds();
+  snapshot.loopEndSeconds = current->loopRange.getEnd().inSeconds();
+
+  timelineInUse = nullptr;
+
+  snapshot.hostTimeNs = (int64_t)(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks()) * 1.0e9);
+  snapshot.blockCount = ++blockCount;
+  write(snapshot);
+}
+
+// Coalesces tempo and loop edits into one copy of the timeline
+void TransportProbe::handleAsyncUpdate()
+{
+  if (edit == nullptr)
+    return;
+
+  auto &transport = edit->getTransport();
+  timelines.push_back(std::make_unique<Timeline>(
+      Timeline{edit->tempoSequence.getInternalSequence(), transport.looping.get(), transport.getLoopRange()}));
+
+  timeline = timelines.back().get();
+  freeRetiredTimelines();
+}
+
+void TransportProbe::freeRetiredTimelines()
+{
+  auto *current = timeline.load();
+  auto *inUse = timelineInUse.load();
+
+  // The audio thread announced inUse before checking it was still current, so anything
+  // else is unreachable
+  timelines.erase(std::remove_if(timelines.begin(), timelines.end(),
+                                 [current, inUse](const std::unique_ptr<Timeline> &t)
+                                 { return t.get() != current && t.get() != inUse; }),
+                  timelines.end());
+}
+
+void TransportProbe::valueTreePropertyChanged(juce::ValueTree &tree, const juce::Identifier &property)
+{
+  if (tree.hasType(te::IDs::TEMPO) || tree.hasType(te::IDs::TIMESIG)
+      || (tree.hasType(te::IDs::TRANSPORT)
+          && (property == te::IDs::looping || property == te::IDs::loopPoint1 || property == te::IDs::loopPoint2)))
+    triggerAsyncUpdate();
+}
+
+void TransportProbe::valueTreeChildAdded(juce::ValueTree &, juce::ValueTree &child)
+{
+  if (child.hasType(te::IDs::TEMPO) || child.hasType(te::IDs::TIMESIG))
+    triggerAsyncUpdate();
+}
+
+void TransportProbe::valueTreeChildRemoved(juce::ValueTree &, juce::ValueTree &child, int)
+{
+  if (child.hasType(te::IDs::TEMPO) || child.hasType(te::IDs::TIMESIG))
+    triggerAsyncUpdate();
+}
+
+TransportProbePlugin::TransportProbePlugin(te::PluginCreationInfo info)
+    : te::Plugin(info), probe(TransportProbe::get(info.edit.engine)) {}
+
+TransportProbePlugin::~TransportProbePlugin()
+{
+  notifyListenersOfDeletion();
+}
+
+void TransportProbePlugin::initialise(const te::PluginInitialisationInfo &info)
+{
+  sampleRate = info.sampleRate;
+}
+
+void TransportProbePlugin::applyToBuffer(const te::PluginRenderContext &fc)
+{
+  // Renders of this edit (or copies of it) run on other threads at their own positions
+  if (probe != nullptr && !fc.isRendering)
+    probe->publish(fc.editTime.getStart(), fc.isPlaying, sampleRate);
+}
@@ -0,0 +1,356 @@
+#include "TransportScheduler.h"
+#include "BridgeEngineBehaviour.h"
+#include <algorithm>
+#include <cmath>
+
+const char *TransportGatePlugin::xmlTypeName = "bridgeTransportGate";
+
+TransportScheduler::TransportScheduler(te::Engine &e) : engine(e)
+{
+  if (auto *behaviour = BridgeEngineBehaviour::get(engine))
+    behaviour->transportScheduler = this;
+
+  engine.getDeviceManager().deviceManager.addAudioCallback(this);
+}
+
+TransportScheduler::~TransportScheduler()
+{
+  detach();
+  engine.getDeviceManager().deviceManager.removeAudioCallback(this);
+  cancelPendingUpdate();
+
+  if (auto *behaviour = BridgeEngineBehaviour::get(engine))
+    behaviour->transportScheduler = nullptr;
+}
+
+TransportScheduler *TransportScheduler::get(te::Engine &engine)
+{
+  auto *behaviour = BridgeEngineBehaviour::get(engine);
+  return behaviour != nullptr ? behaviour->transportScheduler.load() : nullptr;
+}
+
+void TransportScheduler::attach(te::Edit &e)
+{
+  detach();
+  edit = &e;
+
+  auto &masterPlugins = edit->getMasterPluginList();
+  if (masterPlugins.findFirstPluginOfType<TransportGatePlugin>() == nullptr)
+  {
+    if (auto plugin = edit->getPluginCache().createNewPlugin(TransportGatePlugin::xmlTypeName, {}))
+    {
+      masterPlugins.insertPlugin(plugin, 0, nullptr);
+
+      // Not something the user did, so it mustn't be undoable
+      edit->getUndoManager().clearUndoHistory();
+    }
+  }
+}
+
+void TransportScheduler::detach()
+{
+  if (edit == nullptr)
+    return;
+
+  cancel();
+  cancelPendingUpdate();
+  inhibitor.reset();
+  playHead = nullptr;
+  gate = open;
+  edit = nullptr;
+}
+
+int64_t TransportScheduler::getHostTimeNs()
+{
+  return (int64_t)(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks()) * 1.0e9);
+}
+
+bool TransportScheduler::checkTarget(int64_t target, bool isHostTime, double lookaheadSeconds) const
+{
+  const double rate = sampleRate.load();
+  if (rate <= 0.0)
+  {
+    std::cerr << "Scheduled transport: no audio device is running" << std::endl;
+    return false;
+  }
+
+  // The audio thread needs a whole block to see the command before the one it lands in
+  const double minimumSeconds = std::max(lookaheadSeconds, 2.0 * engine.getDeviceManager().getBlockSize() / rate);
+  const double secondsAway = isHostTime ? (double)(target - getHostTimeNs()) / 1.0e9
+                                        : (double)(target - streamPosition.load()) / rate;
+
+  if (secondsAway < minimumSeconds)
+  {
+    std::cerr << "Scheduled transport: target is " << secondsAway << "s away, needs at least "
+              << minimumSeconds << "s" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+void TransportScheduler::arm(Command &command, int64_t target, bool isHostTime)
+{
+  command.target = target;
+  command.isHostTime = isHostTime;
+  command.state.store(armed, std::memory_order_release);
+}
+
+bool TransportScheduler::startAt(int64_t target, bool isHostTime, double lookaheadSeconds)
+{
+  if (edit == nullptr)
+    return false;
+
+  auto &transport = edit->getTransport();
+  if (transport.isPlaying() || start.state != idle)
+  {
+    std::cerr << "Scheduled transport: already playing or starting" << std::endl;
+    return false;
+  }
+
+  if (!checkTarget(target, isHostTime, lookaheadSeconds))
+    return false;
+
+  transport.ensureContextAllocated();
+  auto *context = transport.getCurrentPlaybackContext();
+  if (context == nullptr)
+    return false;
+
+  // The play head belongs to the context, which must stay put until the command is made
+  if (inhibitor == nullptr)
+    inhibitor = std::make_unique<te::TransportControl::ReallocationInhibitor>(transport);
+
+  auto *head = context->getNodePlayHead();
+  startPosition = te::toSamples(transport.getPosition(), sampleRate.load());
+  playHead = head;
+
+  // Only the transport's own play call makes it report playing, so start it and hold
+  // the play head until the audio thread lets it go; anything let through meanwhile is muted
+  gate = closed;
+  transport.play(false);
+  head->stop();
+
+  arm(start, target, isHostTime);
+  return true;
+}
+
+bool TransportScheduler::stopAt(int64_t target, bool isHostTime, double lookaheadSeconds)
+{
+  if (edit == nullptr)
+    return false;
+
+  auto &transport = edit->getTransport();
+  if (!transport.isPlaying() || stop.state != idle)
+  {
+    std::cerr << "Scheduled transport: not playing, or a stop is already scheduled" << std::endl;
+    return false;
+  }
+
+  if (!checkTarget(target, isHostTime, lookaheadSeconds))
+    return false;
+
+  auto *context = transport.getCurrentPlaybackContext();
+  if (context == nullptr)
+    return false;
+
+  if (inhibitor == nullptr)
+    inhibitor = std::make_unique<te::TransportControl::ReallocationInhibitor>(transport);
+
+  playHead = context->getNodePlayHead();
+  arm(stop, target, isHostTime);
+  return true;
+}
+
+void TransportScheduler::cancel()
+{
+  int expected = armed;
+  const bool cancelledStart = start.state.compare_exchange_strong(expected, idle);
+  expected = armed;
+  stop.state.compare_exchange_strong(expected, idle);
+
+  // Make sure the transport has caught up with commands the audio thread already made
+  handleUpdateNowIfNeeded();
+
+  // startAt put the transport into play with its play head held
+  if (cancelledStart && edit != nullptr)
+  {
+    gate = open;
+    edit->getTransport().stop(false, false);
+  }
+
+  if (!isPending())
+  {
+    inhibitor.reset();
+
+    // Device callbacks run under this lock, so none can still be holding the play head
+    const juce::ScopedLock sl(engine.getDeviceManager().deviceManager.getAudioCallbackLock());
+    playHead = nullptr;
+  }
+}
+
+int64_t TransportScheduler::toDeviceSample(const Command &command, int64_t blockHostTimeNs, int64_t blockStart) const
+{
+  if (!command.isHostTime)
+    return command.target;
+
+  return blockStart + (int64_t)std::llround((double)(command.target - blockHostTimeNs) * sampleRate.load() / 1.0e9);
+}
+
+void TransportScheduler::audioDeviceAboutToStart(juce::AudioIODevice *device)
+{
+  // Device samples count from here, so sample targets from before a restart are meaningless
+  streamPosition = 0;
+  sampleRate = device != nullptr ? device->getCurrentSampleRate() : 0.0;
+}
+
+void TransportScheduler::audioDeviceIOCallbackWithContext(const float *const *, int, float *const *outputChannelData,
+                                                          int numOutputChannels, int numSamples,
+                                                          const juce::AudioIODeviceCallbackContext &context)
+{
+  // Outputs of extra device callbacks are summed into the mix, so leave silence
+  for (int ch = 0; ch < numOutputChannels; ++ch)
+    if (outputChannelData[ch] != nullptr)
+      juce::FloatVectorOperations::clear(outputChannelData[ch], numSamples);
+
+  const auto blockStart = streamPosition.load();
+  const auto nextBlock = blockStart + numSamples;
+  streamPosition = nextBlock;
+  gatedSamples = 0;
+
+  // The partial block after a start has been played
+  if (gate == openAtOffset)
+    gate = open;
+
+  auto finish = [this](Command &command)
+  {
+    int expected = armed;
+    if (!command.state.compare_exchange_strong(expected, fired))
+      return false;
+
+    triggerAsyncUpdate();
+    return true;
+  };
+
+  // Devices that don't stamp their blocks get the time the block finished instead
+  const auto hostTime = context.hostTimeNs != nullptr ? (int64_t)*context.hostTimeNs : getHostTimeNs();
+  auto *head = playHead.load();
+
+  // A stop inside the last block has been muted from its sample on; now stop there
+  if (stopAfterBlock.exchange(false))
+  {
+    gate = open;
+
+    if (finish(stop) && head != nullptr)
+    {
+      head->stop();
+      head->setPosition(stopPosition.load());
+    }
+  }
+
+  if (head == nullptr)
+    return;
+
+  // Blocks are assumed to stay the same size, so a target before nextBlock + numSamples
+  // falls in the next one; late targets are made at its start
+  if (start.state.load(std::memory_order_acquire) == armed)
+  {
+    const auto offset = std::max((int64_t)0, toDeviceSample(start, hostTime, blockStart) - nextBlock);
+
+    if (offset < numSamples && finish(start))
+    {
+      // Start offset samples early, so the start position lands exactly on the target
+      head->play();
+      head->setPosition(startPosition.load() - offset);
+      gateOffset = (int)offset;
+      gate = offset > 0 ? openAtOffset : open;
+    }
+
+    return;
+  }
+
+  if (gate == open && stop.state.load(std::memory_order_acquire) == armed)
+  {
+    const auto offset = std::max((int64_t)0, toDeviceSample(stop, hostTime, blockStart) - nextBlock);
+    if (offset >= numSamples)
+      return;
+
+    auto position = head->getPosition() + offset;
+    if (head->isLooping())
+    {
+      const auto loop = head->getLoopRange();
+      if (position >= loop.getEnd())
+        position = loop.getStart() + (position - loop.getEnd());
+    }
+
+    stopPosition = position;
+
+    if (offset == 0)
+    {
+      if (finish(stop))
+      {
+        head->stop();
+        head->setPosition(position);
+      }
+    }
+    else
+    {
+      gateOffset = (int)offset;
+      gate = closeAtOffset;
+      stopAfterBlock = true;
+    }
+  }
+}
+
+void TransportScheduler::applyGate(juce::AudioBuffer<float> &buffer, int startSample, int numSamples)
+{
+  const int done = gatedSamples.fetch_add(numSamples);
+  const int current = gate.load();
+
+  if (current == open)
+    return;
+
+  int from = 0, to = numSamples;
+  if (current == openAtOffset)
+    to = juce::jlimit(0, numSamples, gateOffset.load() - done);
+  else if (current == closeAtOffset)
+    from = juce::jlimit(0, numSamples, gateOffset.load() - done);
+
+  if (to > from)
+    buffer.clear(startSample + from, to - from);
+}
+
+void TransportScheduler::handleAsyncUpdate()
+{
+  if (edit == nullptr)
+    return;
+
+  int expected = fired;
+  if (stop.state.compare_exchange_strong(expected, idle))
+  {
+    auto &transport = edit->getTransport();
+    transport.stop(false, false);
+    transport.setPosition(te::TimePosition::fromSamples(stopPosition.load(), sampleRate.load()));
+  }
+
+  // The play head is already running, and the transport has been playing since startAt
+  expected = fired;
+  start.state.compare_exchange_strong(expected, idle);
+
+  if (!isPending())
+    inhibitor.reset();
+}
+
+TransportGatePlugin::TransportGatePlugin(te::PluginCreationInfo info)
+    : te::Plugin(info), scheduler(TransportScheduler::get(info.edit.engine)) {}
+
+TransportGatePlugin::~TransportGatePlugin()
+{
+  notifyListenersOfDeletion();
+}
+
+void TransportGatePlugin::applyToBuffer(const te::PluginRenderContext &fc)
+{
+  // Renders aren't transport-driven, and their copies of the edit have their own gate
+  if (scheduler != nullptr && fc.destBuffer != nullptr && !fc.isRendering)
+    scheduler->applyGate(*fc.destBuffer, fc.bufferStartSample, fc.bufferNumSamples);
+}
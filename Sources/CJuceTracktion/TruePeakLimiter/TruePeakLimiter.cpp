@@ -0,0 +1,119 @@
+#include "TruePeakLimiter.h"
+#include <cmath>
+
+TruePeakDetector::TruePeakDetector()
+{
+  // Hann-windowed sinc low-pass at the original Nyquist, split into polyphase branches
+  const int numTaps = (int)coefficients.size();
+  const double centre = (numTaps - 1) / 2.0;
+
+  for (int i = 0; i < numTaps; ++i)
+  {
+    const double t = (i - centre) / oversampling;
+    const double sinc = t == 0.0 ? 1.0 : std::sin(juce::MathConstants<double>::pi * t) / (juce::MathConstants<double>::pi * t);
+    const double window = 0.5 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * (i + 0.5) / numTaps);
+    coefficients[(size_t)i] = (float)(sinc * window);
+  }
+}
+
+void TruePeakDetector::reset()
+{
+  history.fill(0.0f);
+  position = 0;
+}
+
+float TruePeakDetector::processSample(float x)
+{
+  history[(size_t)position] = x;
+  float peak = 0.0f;
+
+  for (int phase = 0; phase < oversampling; ++phase)
+  {
+    float sum = 0.0f;
+
+    for (int tap = 0; tap < tapsPerPhase; ++tap)
+      sum += coefficients[(size_t)(phase + tap * oversampling)]
+             * history[(size_t)((position - tap + tapsPerPhase) % tapsPerPhase)];
+
+    peak = std::max(peak, std::abs(sum));
+  }
+
+  position = (position + 1) % tapsPerPhase;
+  return peak;
+}
+
+void TruePeakLimiter::prepare(double sampleRate, int numChannels, float ceilingDb, double lookaheadMs, double releaseMs)
+{
+  ceiling = juce::Decibels::decibelsToGain(ceilingDb);
+  window = std::max(1, juce::roundToInt(lookaheadMs * sampleRate / 1000.0));
+  latency = window - 1 + TruePeakDetector::latency;
+  releaseCoefficient = 1.0 - std::exp(-1.0 / (releaseMs * sampleRate / 1000.0));
+
+  detectors.assign((size_t)numChannels, {});
+  delayLines.assign((size_t)numChannels, std::vector<float>((size_t)std::max(1, latency), 0.0f));
+  delayPosition = 0;
+
+  minIndex.assign((size_t)window + 1, 0);
+  minValue.assign((size_t)window + 1, 1.0f);
+  minHead = minSize = 0;
+  sampleIndex = 0;
+
+  boxRing.assign((size_t)window, 1.0f);
+  boxSum = window;
+  boxPosition = 0;
+  gain = 1.0f;
+}
+
+void TruePeakLimiter::process(juce::AudioBuffer<float> &buffer, int numSamples)
+{
+  const int numChannels = std::min(buffer.getNumChannels(), (int)detectors.size());
+  const int capacity = (int)minValue.size();
+
+  for (int i = 0; i < numSamples; ++i)
+  {
+    float peak = 0.0f;
+    for (int ch = 0; ch < numChannels; ++ch)
+      peak = std::max(peak, detectors[(size_t)ch].processSample(buffer.getSample(ch, i)));
+
+    const float required = peak > ceiling ? ceiling / peak : 1.0f;
+
+    // Push onto the monotonic queue and drop entries older than the window
+    while (minSize > 0 && minValue[(size_t)((minHead + minSize - 1) % capacity)] >= required)
+      --minSize;
+
+    const int tail = (minHead + minSize) % capacity;
+    minIndex[(size_t)tail] = sampleIndex;
+    minValue[(size_t)tail] = required;
+    ++minSize;
+
+    if (minIndex[(size_t)minHead] <= sampleIndex - window)
+    {
+      minHead = (minHead + 1) % capacity;
+      --minSize;
+    }
+
+    const float windowMin = minValue[(size_t)minHead];
+    boxSum += windowMin - boxRing[(size_t)boxPosition];
+    boxRing[(size_t)boxPosition] = windowMin;
+    boxPosition = (boxPosition + 1) % window;
+
+    const float target = (float)(boxSum / window);
+    gain = target < gain ? target : gain + (float)releaseCoefficient * (target - gain);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+      auto &delay = delayLines[(size_t)ch];
+      const float delayed = latency > 0 ? delay[(size_t)delayPosition] : buffer.getSample(ch, i);
+
+      if (latency > 0)
+        delay[(size_t)delayPosition] = buffer.getSample(ch, i);
+
+      buffer.setSample(ch, i, juce::jlimit(-ceiling, ceiling, delayed * gain));
+    }
+
+    if (latency > 0)
+      delayPosition = (delayPosition + 1) % latency;
+
+    ++sampleIndex;
+  }
+}
@@ -2,37 +2,234 @@
 
 #include "CJuceTracktionExport.h"
 #include "EngineHelpers.h"
+#include "LoudnessMeter.h"
+#include "MemoryAccountant.h"
+#include "MidiRecorder.h"
+#include "MultiFormatExporter.h"
+#include "RealtimeSafetyChecker.h"
 #include "SwiftBridgingCompat.h"
+#include "TransportProbe.h"
 #include <atomic>
 #include <cassert>
 #include <memory>
 #include <string>
 #include <tracktion_engine/tracktion_engine.h>
+#include <vector>
+
+class EditAutosaver;
+class GraphRebuildTimer;
+class LoopSwitcher;
+class RenderCache;
+class TimeStretchProxies;
+class TransportScheduler;
+
+/// Per-instance engine configuration, fixed when the engine is created
+struct CJUCETRACKTION_API AudioEngineOptions
+{
+  /// CPUs tracktion_graph may use for live playback and exportAudio (0 = engine default)
+  int numAudioThreads = 0;
+  /// tracktion::graph::ThreadPoolStrategy as an int (-1 = engine default).
+  /// The strategy is a process-wide setting in tracktion, so the last engine created wins.
+  int threadPoolStrategy = -1;
+  /// Converts sample content to the device rate once at load time (see SampleCache)
+  bool preResampleSamples = false;
+  /// Writes no temp project file at startup and no cache files: no resampled samples and
+  /// no time-stretch proxies. Operations that produce audio files still use the engine's
+  /// temp directory: freezing, exports through the render cache, chunked exports and
+  /// recordings started without a directory. On by default for headless processes.
+  bool inMemoryProject = AudioEngineHelpers::isHeadlessProcess();
+  /// Reports allocations, locks and blocking calls made during the audio callback.
+  /// Only has an effect in builds with SWIFTTRACKTIONKIT_REALTIME_CHECKS=1.
+  bool realtimeSafetyChecks = false;
+} SWIFT_SELF_CONTAINED;
+
+/// CPU load of a single plugin as a fraction of the audio block time
+struct CJUCETRACKTION_API PluginCpuUsage
+{
+  int trackID;
+  int pluginIndex;
+  std::string pluginName;
+  double cpuUsage;
+} SWIFT_SELF_CONTAINED;
+
+/// CPU load of a track's plugin chain as a fraction of the audio block time
+struct CJUCETRACKTION_API TrackCpuUsage
+{
+  int trackID;
+  int numPlugins;
+  double cpuUsage;
+} SWIFT_SELF_CONTAINED;
+
+/// Playback graph rebuilds after structural TrackManager/MidiClipManager batches (see
+/// GraphRebuildTimer)
+struct CJUCETRACKTION_API GraphRebuildStats
+{
+  int count = 0;
+  double lastMs = 0.0;
+  double maxMs = 0.0;
+  double averageMs = 0.0;
+} SWIFT_SELF_CONTAINED;
 
 class CJUCETRACKTION_API AudioEngine
 {
 public:
   static AudioEngine *create(const std::string &name);
+  static AudioEngine *create(const std::string &name, const AudioEngineOptions &options)
+      SWIFT_NAME(create(_:options:));
   AudioEngine(const AudioEngine &) = delete;
   ~AudioEngine();
 
   void startPlayback() SWIFT_NAME(start());
   void stopPlayback() SWIFT_NAME(stop());
+  /// Starts playback from the current position exactly on a future host time (ns on the
+  /// getHostTimeNs clock) or device sample. Fails unless the target is at least
+  /// lookaheadSeconds away; isPlaying turns true straight away (see TransportScheduler).
+  bool startAtHostTime(int64_t hostTimeNs, double lookaheadSeconds) SWIFT_NAME(start(atHostTime:lookahead:));
+  bool startAtSample(int64_t deviceSample, double lookaheadSeconds) SWIFT_NAME(start(atSample:lookahead:));
+  /// Stops exactly on a future host time or device sample, leaving the position there
+  bool stopAtHostTime(int64_t hostTimeNs, double lookaheadSeconds) SWIFT_NAME(stop(atHostTime:lookahead:));
+  bool stopAtSample(int64_t deviceSample, double lookaheadSeconds) SWIFT_NAME(stop(atSample:lookahead:));
+  void cancelScheduledTransport();
+  bool hasScheduledTransport() const SWIFT_COMPUTED_PROPERTY;
+  /// Device sample the next audio block starts at, counted since the device started
+  int64_t getDeviceSamplePosition() const SWIFT_COMPUTED_PROPERTY;
+  /// Monotonic host clock that scheduled starts and stops are given in
+  int64_t getHostTimeNs() const SWIFT_COMPUTED_PROPERTY;
   void setTempo(double bpm) SWIFT_COMPUTED_PROPERTY;
   double getTempo() const SWIFT_COMPUTED_PROPERTY;
   bool isPlaying() const SWIFT_COMPUTED_PROPERTY;
+  /// Playing state, position, tempo and loop as of the last audio block. Lock-free and
+  /// safe from any thread, so playheads can poll it at display rate (see TransportProbe).
+  TransportSnapshot getTransportSnapshot() const SWIFT_COMPUTED_PROPERTY;
+  /// Queues a new loop range that takes over at the end of the current loop (quantiseBeats
+  /// 0) or on the next multiple of quantiseBeats, without stopping the transport or
+  /// reallocating the playback context. Sample-accurate unless the new range starts later
+  /// than the current position, which switches on a block boundary (see LoopSwitcher).
+  bool queueLoopRange(double startSeconds, double endSeconds, double quantiseBeats)
+      SWIFT_NAME(queueLoopRange(start:end:quantiseBeats:));
+  void cancelQueuedLoopRange();
+  bool hasQueuedLoopRange() const SWIFT_COMPUTED_PROPERTY;
+
+  /// Records every MIDI input into the clip with this MidiClipManager clip ID while the
+  /// transport plays, merging as it goes (incremental) or when recording stops (see MidiRecorder)
+  bool startMidiRecording(int clipID, bool incremental) SWIFT_NAME(startMidiRecording(clipID:incremental:));
+  /// Returns the number of notes recorded in the take
+  int stopMidiRecording();
+  bool isRecordingMidi() const SWIFT_COMPUTED_PROPERTY;
+  MidiRecordingStats getMidiRecordingStats() const SWIFT_COMPUTED_PROPERTY;
+  void resetMidiRecordingStats();
+  /// Virtual MIDI input, for recording without devices: messages take the same path as a
+  /// device's, on channels 1-16. atSeconds >= 0 places them on the timeline directly; -1 stamps them from
+  /// the playing transport like live input.
+  void sendVirtualNoteOn(int channel, int noteNumber, int velocity, double atSeconds)
+      SWIFT_NAME(sendVirtualNoteOn(channel:noteNumber:velocity:atSeconds:));
+  void sendVirtualNoteOff(int channel, int noteNumber, double atSeconds)
+      SWIFT_NAME(sendVirtualNoteOff(channel:noteNumber:atSeconds:));
+  void sendVirtualController(int channel, int controller, int value, double atSeconds)
+      SWIFT_NAME(sendVirtualController(channel:controller:value:atSeconds:));
   void exportAudio(const std::string &filePath, void (*onprogresschange)(float))
       SWIFT_NAME(exportAudio(to:onProgressChange:));
+  /// Exports at a target integrated loudness with a true-peak ceiling. The mix is
+  /// rendered once into a float render cache (reused while the edit is unchanged) and
+  /// analysed without writing output; the second pass applies gain and a true-peak
+  /// limiter while writing 24-bit audio in the format matching the file extension.
+  bool exportNormalisedAudio(const std::string &filePath, double targetLufs, double truePeakCeilingDb,
+                             void (*onprogresschange)(float))
+      SWIFT_NAME(exportNormalisedAudio(to:targetLufs:truePeakCeilingDb:onProgressChange:));
+  /// Renders the mix once and writes every target from it in parallel, each with its own
+  /// format, bit depth, dither and sample rate. Returns the number of files written.
+  int exportAudioFormats(const ExportBuilder &builder, void (*onprogresschange)(float))
+      SWIFT_NAME(exportAudioFormats(builder:onProgressChange:));
+  /// Renders segments of the timeline concurrently, each on its own copy of the edit with
+  /// preRollSeconds of lead-in, and joins them sample-exactly (see ChunkedRenderer).
+  /// numChunks 0 uses one segment per CPU.
+  bool exportAudioChunked(const std::string &filePath, int numChunks, double preRollSeconds,
+                          void (*onprogresschange)(float))
+      SWIFT_NAME(exportAudioChunked(to:numChunks:preRollSeconds:onProgressChange:));
   const bool isClickTrackEnabled();
   void enableClickTrack();
   void disableClickTrack();
   te::Edit *getEdit() const SWIFT_RETURNS_INDEPENDENT_VALUE;
 
+  /// Saves the edit as a binary snapshot (see EditSnapshot)
+  bool saveSnapshot(const std::string &filePath, bool compress) SWIFT_NAME(saveSnapshot(to:compress:));
+  /// Replaces the edit with one loaded from a snapshot. Existing track and clip managers
+  /// move to the new edit; fails while one of them has a batch or recording open.
+  bool loadSnapshot(const std::string &filePath) SWIFT_NAME(loadSnapshot(from:));
+
+  /// Journals every edit change to the directory on a background thread (see EditAutosaver).
+  /// An earlier session's files are moved into its previous-session subdirectory first.
+  bool enableAutosave(const std::string &directoryPath, int intervalMs)
+      SWIFT_NAME(enableAutosave(directory:intervalMs:));
+  /// Writes outstanding changes and stops autosaving
+  void disableAutosave();
+  bool isAutosaving() const SWIFT_COMPUTED_PROPERTY;
+  /// Replaces the edit with the state recovered from an autosave directory
+  bool recoverAutosave(const std::string &directoryPath) SWIFT_NAME(recoverAutosave(directory:));
+
+  /// Changes the graph worker count and reallocates the playback context
+  void setNumAudioThreads(int numThreads) SWIFT_NAME(setNumAudioThreads(_:));
+  int getNumAudioThreads() const SWIFT_COMPUTED_PROPERTY;
+
+  /// When enabled, samplers and audio clips loaded afterwards use content converted to
+  /// the device rate up front, so playback never interpolates
+  void setPreResampleSamples(bool shouldPreResample) SWIFT_NAME(setPreResampleSamples(_:));
+  bool isPreResamplingSamples() const SWIFT_COMPUTED_PROPERTY;
+
+  /// Tempo-synced clips waiting for their pre-rendered stretch proxy after a tempo change.
+  /// They keep stretching in real time until it is ready (see TimeStretchProxies).
+  int getPendingStretchProxies() const SWIFT_COMPUTED_PROPERTY;
+
+  /// True when the engine was created with AudioEngineOptions::inMemoryProject (see there
+  /// for what it does and doesn't keep off the disk)
+  bool isInMemoryProject() const SWIFT_COMPUTED_PROPERTY;
+
+  /// Overall audio callback load reported by the device manager
+  double getCpuUsage() const SWIFT_COMPUTED_PROPERTY;
+  /// Per-track load, heaviest first, so the first entry is the critical path candidate
+  std::vector<TrackCpuUsage> getTrackCpuUsage() const;
+  std::vector<PluginCpuUsage> getPluginCpuUsage() const;
+
+  /// How long tracktion took to reallocate the playback graph after structural batches
+  GraphRebuildStats getGraphRebuildStats() const SWIFT_COMPUTED_PROPERTY;
+  void resetGraphRebuildStats();
+
+  /// Allocations, locks and blocking calls seen in the audio callback since the last reset
+  /// (see RealtimeSafetyChecker). Each one is also printed with its stack trace.
+  bool isCheckingRealtimeSafety() const SWIFT_COMPUTED_PROPERTY;
+  RealtimeViolations getRealtimeViolations() const SWIFT_COMPUTED_PROPERTY;
+  void resetRealtimeViolations();
+
+  /// Memory by subsystem plus the process's resident size. Cheap enough to poll every
+  /// few seconds for budgets and leak alerts (see MemoryAccountant).
+  MemoryReport getMemoryReport() const SWIFT_COMPUTED_PROPERTY;
+
+  /// Post-fader levels of the master output and of a track. Lock-free, so poll at display
+  /// rate. Tracks created other than through TrackManager have no meter and read silence.
+  MeterReading getMasterMeter() const SWIFT_NAME(getMasterMeter());
+  MeterReading getTrackMeter(int trackID) const SWIFT_NAME(getTrackMeter(trackID:));
+  /// Restarts integrated loudness on every meter, e.g. at the start of a compliance pass
+  void resetLoudness();
+
 private:
-  AudioEngine(const std::string &name);
+  AudioEngine(const std::string &name, const AudioEngineOptions &options);
+  bool replaceEdit(const juce::ValueTree &state);
 
   std::unique_ptr<te::Engine> engine;
+  // Declared before the edit so that it outlives the edit's probe plugin
+  std::unique_ptr<TransportProbe> transportProbe;
+  std::unique_ptr<TransportScheduler> transportScheduler;
+  std::unique_ptr<GraphRebuildTimer> graphRebuildTimer;
   std::unique_ptr<te::Edit> edit;
+  std::unique_ptr<EditAutosaver> autosaver;
+  std::unique_ptr<RenderCache> renderCache;
+  std::unique_ptr<TimeStretchProxies> stretchProxies;
+  std::unique_ptr<LoopSwitcher> loopSwitcher;
+  std::unique_ptr<MidiRecorder> midiRecorder;
+  std::unique_ptr<RealtimeSafetyChecker> realtimeChecker;
+  std::unique_ptr<MemoryAccountant> memoryAccountant;
+  juce::File autosaveDirectory;
+  int autosaveIntervalMs = 0;
   te::TransportControl *transport;
 
   std::atomic<int> refCount{0};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "CJuceTracktionExport.h"
+#include "EngineHelpers.h"
+#include "SwiftBridgingCompat.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <tracktion_engine/tracktion_engine.h>
+#include <vector>
+
+class TransportProbe;
+
+/// Progress of the current (or last) audio recording
+struct CJUCETRACKTION_API AudioRecordingStats
+{
+  /// Samples per channel written to disk, summed over the armed tracks
+  int64_t samplesWritten = 0;
+  /// Input blocks lost because a track's FIFO was full, and their samples per channel
+  int64_t dropouts = 0;
+  int64_t droppedSamples = 0;
+  /// Input captured but not yet on disk, now and at worst during the take
+  double backlogSeconds = 0.0;
+  double peakBacklogSeconds = 0.0;
+  int64_t writeErrors = 0;
+} SWIFT_SELF_CONTAINED;
+
+/// Records device input onto armed tracks. The audio thread only copies each armed
+/// track's input channels into that track's FIFO, preallocated when recording starts;
+/// a dedicated writer thread drains the FIFOs into 24-bit WAV files. A FIFO that is
+/// full, because the disk fell more than fifoSeconds behind, loses the block and counts
+/// a dropout rather than blocking the audio thread.
+class AudioRecorder : private juce::AudioIODeviceCallback,
+                      private juce::Thread
+{
+public:
+  /// A finished recording, for the caller to add as a clip. offsetSeconds is the part of
+  /// the file from before the edit's start that latency compensation moved it back into.
+  struct Take
+  {
+    int trackID;
+    juce::File file;
+    double startSeconds;
+    double offsetSeconds;
+  };
+
+  explicit AudioRecorder(te::Edit &edit);
+  ~AudioRecorder() override;
+
+  /// Records numChannels of the active input channels (the device's, or the fake
+  /// input's) from firstInputChannel, and fails for channels that don't exist. A stereo
+  /// track on a single input records it on both sides. Tracks can only be armed and
+  /// disarmed while not recording.
+  bool arm(int trackID, const juce::String &trackName, int firstInputChannel, int numChannels);
+  bool disarm(int trackID);
+  bool isArmed(int trackID) const;
+
+  /// Opens a file per armed track in directory and captures from the next input block.
+  /// Takes start at the transport position of that block, moved back by the device's
+  /// input and output latency: what arrives now was played along to output heard that
+  /// long ago. Fails if an armed track's channels have gone, e.g. with the device.
+  bool start(const juce::File &directory);
+  /// Stops capturing and returns once the writer thread has finished every file
+  std::vector<Take> stop();
+  bool isRecording() const { return recording.load(); }
+
+  AudioRecordingStats getStats() const;
+
+  /// Replaces the device input with a file, decoded up front and delivered in real time
+  /// from a thread of its own, so recording runs without audio hardware. An empty path
+  /// goes back to the device. Can't be changed while recording.
+  bool setFakeInput(const juce::File &file, bool loop);
+
+  /// Captures a block of input for the armed tracks; called by the device callback or
+  /// the fake input, never both
+  void processInput(const float *const *inputChannelData, int numInputChannels, int numSamples);
+
+  static constexpr double fifoSeconds = 10.0;
+
+private:
+  struct ArmedTrack;
+  class FakeInput;
+
+  void audioDeviceIOCallbackWithContext(const float *const *inputChannelData, int numInputChannels,
+                                        float *const *outputChannelData, int numOutputChannels, int numSamples,
+                                        const juce::AudioIODeviceCallbackContext &) override;
+  void audioDeviceAboutToStart(juce::AudioIODevice *) override {}
+  void audioDeviceStopped() override {}
+
+  // Writer thread
+  void run() override;
+  bool writeAvailable();
+
+  int getNumInputChannels() const;
+  bool hasInputs(int firstInputChannel, int numChannels) const;
+
+  te::Edit &edit;
+  TransportProbe *const probe;
+  std::vector<std::unique_ptr<ArmedTrack>> tracks;
+  std::unique_ptr<FakeInput> fakeInput;
+
+  std::atomic<bool> usingFakeInput{false};
+  std::atomic<bool> recording{false};
+  // Set around processInput so stop() knows when the audio thread has let go
+  std::atomic<bool> capturing{false};
+  std::atomic<bool> positioned{false};
+  std::atomic<double> startSeconds{0.0};
+  double latencySeconds = 0.0;
+  double sampleRate = 0.0;
+
+  std::atomic<int64_t> dropouts{0}, droppedSamples{0}, writeErrors{0};
+  std::atomic<int> peakBacklog{0};
+};
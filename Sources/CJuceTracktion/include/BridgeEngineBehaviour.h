@@ -0,0 +1,97 @@
+#pragma once
+
+#include "AudioEngine.h"
+#include "EngineHelpers.h"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <tracktion_engine/tracktion_engine.h>
+
+class GraphRebuildTimer;
+class TransportProbe;
+class TransportScheduler;
+
+/// EngineBehaviour installed by AudioEngine. Holds the per-engine options that the
+/// managers and plugins need to reach through te::Engine.
+class BridgeEngineBehaviour : public te::EngineBehaviour
+{
+public:
+  explicit BridgeEngineBehaviour(const AudioEngineOptions &options)
+      : numAudioThreads(options.numAudioThreads),
+        preResampleSamples(options.preResampleSamples),
+        inMemoryProject(options.inMemoryProject) {}
+
+  /// Returns nullptr for engines that weren't created by AudioEngine
+  static BridgeEngineBehaviour *get(te::Engine &engine)
+  {
+    return dynamic_cast<BridgeEngineBehaviour *>(&engine.getEngineBehaviour());
+  }
+
+  /// Rate that sample content should be converted to at load time, or 0 to keep the
+  /// files' own rates and let playback interpolate
+  static double getPreResampleRate(te::Engine &engine)
+  {
+    auto *behaviour = get(engine);
+    return behaviour != nullptr && behaviour->preResampleSamples ? engine.getDeviceManager().getSampleRate() : 0.0;
+  }
+
+  /// False for in-memory projects, which must not leave cache files behind
+  static bool canWriteCacheFiles(te::Engine &engine)
+  {
+    auto *behaviour = get(engine);
+    return behaviour == nullptr || !behaviour->inMemoryProject;
+  }
+
+  /// Registers something that keeps a pointer to the engine's edit (see EditFollower).
+  /// Engines not created by AudioEngine never replace their edit, so there's nothing to do.
+  static void addEditFollower(te::Engine &engine, AudioEngineHelpers::EditFollower *follower)
+  {
+    if (auto *behaviour = get(engine))
+      behaviour->editFollowers.push_back(follower);
+  }
+
+  static void removeEditFollower(te::Engine &engine, AudioEngineHelpers::EditFollower *follower)
+  {
+    if (auto *behaviour = get(engine))
+      behaviour->editFollowers.erase(std::remove(behaviour->editFollowers.begin(), behaviour->editFollowers.end(),
+                                                 follower),
+                                     behaviour->editFollowers.end());
+  }
+
+  bool isEditHeld() const
+  {
+    return std::any_of(editFollowers.begin(), editFollowers.end(),
+                       [](const AudioEngineHelpers::EditFollower *f) { return f->isHoldingEdit(); });
+  }
+
+  /// Moves every follower to newEdit, or detaches them all when it's nullptr
+  void replaceEdit(te::Edit *newEdit)
+  {
+    // Followers may deregister while being told
+    const auto followers = editFollowers;
+    for (auto *follower : followers)
+      follower->editReplaced(newEdit);
+
+    if (newEdit == nullptr)
+      editFollowers.clear();
+  }
+
+  int getNumberOfCPUsToUseForAudio() override
+  {
+    const int threads = numAudioThreads.load();
+    return threads > 0 ? threads : te::EngineBehaviour::getNumberOfCPUsToUseForAudio();
+  }
+
+  std::atomic<int> numAudioThreads;
+  std::atomic<bool> preResampleSamples;
+  const bool inMemoryProject;
+  /// Set by the engine's TransportProbe for the probe plugins to find it
+  std::atomic<TransportProbe *> transportProbe{nullptr};
+  /// Likewise for the TransportScheduler and its gate plugins
+  std::atomic<TransportScheduler *> transportScheduler{nullptr};
+  /// Set by the engine's GraphRebuildTimer; only used on the message thread
+  GraphRebuildTimer *graphRebuildTimer = nullptr;
+
+private:
+  std::vector<AudioEngineHelpers::EditFollower *> editFollowers;
+};
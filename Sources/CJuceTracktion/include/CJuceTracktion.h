@@ -7,6 +7,28 @@
 // Project headers
 #include "EngineHelpers.h"
 #include "AudioEngine.h"
+#include "AudioRecorder.h"
+#include "ChunkedRenderer.h"
+#include "DrumSamplerPlugin.h"
+#include "EditAutosaver.h"
+#include "EditSnapshot.h"
+#include "GraphRebuildTimer.h"
+#include "LoopSwitcher.h"
+#include "LoudnessMeter.h"
+#include "MemoryAccountant.h"
+#include "MeterPlugin.h"
 #include "MidiNote.h"
 #include "MidiClipManager.h"
+#include "MidiRecorder.h"
+#include "MultiFormatExporter.h"
+#include "OscServer.h"
+#include "PresetRegistry.h"
+#include "RealtimeSafetyChecker.h"
+#include "RenderCache.h"
+#include "SampleCache.h"
+#include "TimeStretchProxies.h"
+#include "TrackFreezer.h"
 #include "TrackManager.h"
+#include "TransportProbe.h"
+#include "TransportScheduler.h"
+#include "TruePeakLimiter.h"
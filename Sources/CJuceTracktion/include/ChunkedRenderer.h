@@ -0,0 +1,29 @@
+#pragma once
+
+#include "EngineHelpers.h"
+#include <tracktion_engine/tracktion_engine.h>
+
+/// Renders an edit in parallel by splitting its timeline into segments.
+/// Every segment renders on its own copy of the edit (and so its own playback graph),
+/// starting a pre-roll earlier so plugin state, delay lines and tails are settled when
+/// the segment begins. The pre-roll is then dropped and the segments are joined at
+/// exact sample positions, so the result lines up with a sequential render.
+class ChunkedRenderer
+{
+public:
+  struct Options
+  {
+    /// Number of segments rendered at once (0 = one per CPU)
+    int numChunks = 0;
+    /// Audio rendered before each segment and discarded. Effects with memory longer than
+    /// this (long reverbs, slow LFOs) can differ slightly across a join.
+    double preRollSeconds = 2.0;
+    /// Shorter edits use fewer segments, since each one pays for its pre-roll
+    double minChunkSeconds = 10.0;
+    int bitDepth = 24;
+  };
+
+  /// Writes the full mix to destFile in the format matching its extension
+  static bool render(te::Edit &edit, const juce::File &destFile, const Options &options,
+                     void (*onprogresschange)(float));
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "EngineHelpers.h"
+#include "SampleCache.h"
+#include <array>
+#include <memory>
+#include <string>
+#include <tracktion_engine/tracktion_engine.h>
+#include <vector>
+
+/// One-shot sampler for drum and percussion content.
+/// Voices live in a fixed pool so note-on never allocates; interpolation and mixing go
+/// through juce::FloatVectorOperations, with per-note choke groups, a polyphony limit and
+/// oldest-voice stealing with a short fade instead of a hard cut. Sounds are published to
+/// the audio thread as immutable tables, so loading never makes a block wait or miss notes.
+class DrumSamplerPlugin : public te::Plugin
+{
+public:
+  static constexpr int maxVoices = 64;
+
+  DrumSamplerPlugin(te::PluginCreationInfo info);
+  ~DrumSamplerPlugin() override;
+
+  static const char *getPluginName() { return "Drum Sampler"; }
+  static const char *xmlTypeName;
+
+  juce::String getName() const override { return getPluginName(); }
+  juce::String getPluginType() override { return xmlTypeName; }
+  juce::String getShortName(int) override { return "Drums"; }
+  juce::String getSelectableDescription() override { return getName(); }
+  bool needsConstantBufferSize() override { return false; }
+
+  bool isSynth() override { return true; }
+  bool takesMidiInput() override { return true; }
+  bool takesAudioInput() override { return false; }
+  bool producesAudioWhenNoAudioInput() override { return true; }
+  int getNumOutputChannelsGivenInputs(int) override { return 2; }
+
+  void initialise(const te::PluginInitialisationInfo &) override;
+  void deinitialise() override;
+  void reset() override;
+  void applyToBuffer(const te::PluginRenderContext &) override;
+  void restorePluginStateFromValueTree(const juce::ValueTree &) override;
+
+  /// Loads a sample for a note. Sounds in the same non-zero choke group cut each other off.
+  juce::String addSound(const std::string &filePath, int noteNumber, int chokeGroup, float gain);
+  void clearSounds();
+  int getNumSounds() const;
+
+  void setMaxPolyphony(int voices);
+  int getMaxPolyphony() const { return maxPolyphony.load(); }
+  int getNumActiveVoices() const { return numActiveVoices.load(); }
+
+  /// Bytes held by decoded sample data. Content is shared through SampleCache, so
+  /// plugins loading the same files report the same buffers.
+  size_t getSampleMemoryBytes() const;
+
+private:
+  struct Sound
+  {
+    std::string filePath;
+    SampleCache::SamplePtr sample;
+    int noteNumber = 0;
+    int chokeGroup = 0;
+    float gain = 1.0f;
+  };
+
+  /// Swapped in whole; sounds carried over keep playing on the voices using them
+  struct SoundTable
+  {
+    std::vector<std::shared_ptr<const Sound>> sounds;
+    std::array<const Sound *, 128> noteMap{};
+
+    bool contains(const Sound *sound) const;
+  };
+
+  struct Voice
+  {
+    const Sound *sound = nullptr;
+    double position = 0.0;
+    double increment = 1.0;
+    float gain = 0.0f;
+    float fadeStep = 0.0f;
+    int noteNumber = -1;
+    int chokeGroup = 0;
+    uint32_t age = 0;
+
+    bool isFading() const { return fadeStep > 0.0f; }
+  };
+
+  juce::String loadSound(Sound &sound);
+  void publishTable(std::vector<std::shared_ptr<const Sound>> sounds);
+  void freeRetiredTables();
+  void loadSoundsFromState();
+
+  /// Audio thread: announces the current table and drops voices whose sound has gone
+  const SoundTable *acquireTable();
+  void startVoice(const SoundTable &table, int noteNumber, float velocity);
+  void fadeOut(Voice &voice);
+  void renderVoices(juce::AudioBuffer<float> &dest, int startSample, int numSamples);
+  void renderVoice(Voice &voice, juce::AudioBuffer<float> &dest, int startSample, int numSamples);
+
+  // The newest table is published; older ones wait until the audio thread isn't using them
+  std::vector<std::unique_ptr<SoundTable>> tables;
+  std::atomic<SoundTable *> table{nullptr};
+  std::atomic<SoundTable *> tableInUse{nullptr};
+  const SoundTable *lastTable = nullptr;
+
+  std::array<Voice, maxVoices> voices;
+  std::atomic<bool> voicesNeedReset{false};
+  juce::AudioBuffer<float> scratch;
+  // Per-chunk read positions and fractions for the resampling path, plus the next samples
+  std::vector<int> interpIndex;
+  juce::AudioBuffer<float> interp;
+  double outputSampleRate = 44100.0;
+  int fadeSamples = 64;
+  uint32_t nextVoiceAge = 0;
+
+  std::atomic<int> maxPolyphony{maxVoices};
+  std::atomic<int> numActiveVoices{0};
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DrumSamplerPlugin)
+};
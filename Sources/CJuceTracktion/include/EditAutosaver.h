@@ -0,0 +1,70 @@
+#pragma once
+
+#include "EngineHelpers.h"
+#include <memory>
+#include <mutex>
+#include <tracktion_engine/tracktion_engine.h>
+#include <vector>
+
+/// Incremental autosave for an edit.
+/// Every ValueTree change is recorded on the message thread as a small delta (the
+/// index path of the node plus the change) and handed to a background thread, which
+/// appends it to a journal and applies it to a private copy of the tree. When the
+/// journal grows past a limit that copy is written out as an EditSnapshot and the
+/// journal starts again, so neither the message nor the audio thread ever serialises
+/// the edit. recover() rebuilds the state from the last snapshot plus the journal.
+///
+/// Files already in the directory belong to an earlier session, possibly one that
+/// crashed, so they're moved into getPreviousSessionDirectory() before the first
+/// snapshot is written, replacing whatever an older session left there.
+class EditAutosaver : private juce::ValueTree::Listener,
+                      private juce::Thread
+{
+public:
+  /// resumeSession is for a new edit in the same session, whose files can be overwritten
+  EditAutosaver(te::Edit &edit, const juce::File &directory, int intervalMs = 2000, bool resumeSession = false);
+  /// Writes any pending changes before returning
+  ~EditAutosaver() override;
+
+  /// Wakes the writer thread instead of waiting for the next interval
+  void flush();
+
+  /// Rebuilds the latest autosaved edit state from a directory, or returns an invalid tree
+  static juce::ValueTree recover(const juce::File &directory);
+  static bool hasRecoveryData(const juce::File &directory);
+  /// Where the files of the session before the current one are kept, for recover()
+  static juce::File getPreviousSessionDirectory(const juce::File &directory);
+
+  /// Journal size that triggers a compaction into a full snapshot
+  static constexpr juce::int64 compactionBytes = 8 * 1024 * 1024;
+
+private:
+  struct Delta;
+
+  void run() override;
+  void writePending();
+  void compact();
+  void record(std::unique_ptr<Delta> delta);
+  std::vector<int> getPathTo(const juce::ValueTree &node);
+
+  void valueTreePropertyChanged(juce::ValueTree &, const juce::Identifier &) override;
+  void valueTreeChildAdded(juce::ValueTree &, juce::ValueTree &) override;
+  void valueTreeChildRemoved(juce::ValueTree &, juce::ValueTree &, int) override;
+  void valueTreeChildOrderChanged(juce::ValueTree &, int, int) override;
+
+  juce::ValueTree state;
+  const juce::File directory;
+  const int intervalMs;
+
+  std::mutex pendingLock;
+  std::vector<std::unique_ptr<Delta>> pending;
+
+  // Recently resolved nodes, so bulk edits under one parent don't search its siblings
+  // on every change. Cleared whenever a change can shift indices.
+  std::vector<std::pair<juce::ValueTree, std::vector<int>>> pathCache;
+
+  // Only touched by the writer thread
+  juce::ValueTree shadow;
+  std::unique_ptr<juce::FileOutputStream> journal;
+  int generation = 0;
+};
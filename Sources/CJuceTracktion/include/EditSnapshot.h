@@ -0,0 +1,26 @@
+#pragma once
+
+#include "EngineHelpers.h"
+#include <tracktion_engine/tracktion_engine.h>
+
+/// Compact binary persistence for edit state.
+/// A snapshot is a small header (magic, format version, flags) followed by the tree in
+/// JUCE's binary ValueTree encoding, optionally GZIP-compressed. Properties keep their
+/// var types, so converting a loaded snapshot back to XML gives the same document as
+/// the tree it was saved from.
+class EditSnapshot
+{
+public:
+  static constexpr int currentVersion = 1;
+
+  static bool write(const juce::ValueTree &state, juce::OutputStream &out, bool compress);
+  /// Returns an invalid tree if the stream isn't a snapshot or has a newer version
+  static juce::ValueTree read(juce::InputStream &in);
+
+  /// Writes via a temporary file, so an interrupted save never leaves a truncated snapshot
+  static bool writeToFile(const juce::ValueTree &state, const juce::File &file, bool compress);
+  static juce::ValueTree readFromFile(const juce::File &file);
+
+  /// True if the file starts with the snapshot header
+  static bool isSnapshotFile(const juce::File &file);
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <tracktion_engine/tracktion_engine.h>
+#include <utility>
 
 namespace te = tracktion;
 using namespace std::literals;
@@ -8,6 +9,22 @@ using namespace std::literals;
 namespace AudioEngineHelpers
 {
 
+    /// True when there's no display to talk to (Linux without X11/Wayland) or the process
+    /// sets CJUCETRACKTION_HEADLESS=1, e.g. render servers, CI and batch tools
+    inline bool isHeadlessProcess()
+    {
+        auto forced = juce::SystemStats::getEnvironmentVariable("CJUCETRACKTION_HEADLESS", {});
+        if (forced.isNotEmpty())
+            return forced.getIntValue() != 0;
+
+       #if JUCE_LINUX || JUCE_BSD
+        return juce::SystemStats::getEnvironmentVariable("DISPLAY", {}).isEmpty()
+            && juce::SystemStats::getEnvironmentVariable("WAYLAND_DISPLAY", {}).isEmpty();
+       #else
+        return false;
+       #endif
+    }
+
     inline te::Project::Ptr createTempProject(te::Engine &engine)
     {
         auto file = engine.getTemporaryFileManager().getTempDirectory().getChildFile("temp_project").withFileExtension(te::projectFileSuffix);
@@ -15,18 +32,93 @@ namespace AudioEngineHelpers
         return tempProject.project;
     }
 
+    /// Loops the transport around the clip. If it's already playing it keeps going, since
+    /// restarting from zero leaves an audible gap; use AudioEngine::queueLoopRange for a
+    /// switch on the loop boundary.
     template <typename ClipType>
     typename ClipType::Ptr loopAroundClip(ClipType &clip)
     {
         auto &transport = clip.edit.getTransport();
         transport.setLoopRange(clip.getEditTimeRange());
         transport.looping = true;
-        transport.setPosition(0s);
-        transport.play(false);
+
+        if (!transport.isPlaying())
+        {
+            transport.setPosition(0s);
+            transport.play(false);
+        }
 
         return clip;
     }
 
+    /// Holds on to an AudioEngine's edit. When AudioEngine replaces the edit (snapshot
+    /// loads, autosave recovery) it hands every follower the new one before deleting the
+    /// old one, and nullptr when the engine itself is deleted. Message thread only.
+    class EditFollower
+    {
+    public:
+        virtual ~EditFollower() = default;
+        virtual void editReplaced(te::Edit *newEdit) = 0;
+        /// True while the edit mustn't be swapped out, e.g. in the middle of a batch
+        virtual bool isHoldingEdit() const { return false; }
+    };
+
+    /// Groups structural edits so the playback graph is rebuilt once instead of per change.
+    /// Batches nest: only the outermost commit releases the inhibitor, and it only restarts
+    /// playback when a track, clip or plugin was added or removed. Outside a batch, edits
+    /// are left to tracktion's own coalesced restart.
+    class EditBatch
+    {
+    public:
+        void begin(te::Edit &edit)
+        {
+            if (depth++ > 0)
+                return;
+
+            edit.getUndoManager().beginNewTransaction();
+            inhibitor = std::make_unique<te::TransportControl::ReallocationInhibitor>(edit.getTransport());
+        }
+
+        /// Returns true when this call closed the outermost batch.
+        bool commit(te::Edit &edit)
+        {
+            if (depth == 0 || --depth > 0)
+                return false;
+
+            inhibitor.reset();
+            lastInsertedTrack = nullptr;
+
+            // Goes through tracktion's queue, so it merges with any restart it held back
+            restarted = std::exchange(structuralChange, false);
+            if (restarted)
+                edit.restartPlayback();
+
+            edit.getUndoManager().beginNewTransaction();
+            return true;
+        }
+
+        bool isActive() const { return depth > 0; }
+
+        /// Whether the last outermost commit asked tracktion to rebuild the playback graph
+        bool restartedPlayback() const { return restarted; }
+
+        /// Called by managers after adding or removing tracks, clips or plugins
+        void markStructuralChange()
+        {
+            if (depth > 0)
+                structuralChange = true;
+        }
+
+        /// Insertion point cache so appending tracks doesn't walk the whole track list each time.
+        te::Track::Ptr lastInsertedTrack;
+
+    private:
+        int depth = 0;
+        bool structuralChange = false;
+        bool restarted = false;
+        std::unique_ptr<te::TransportControl::ReallocationInhibitor> inhibitor;
+    };
+
     inline te::AudioTrack *getOrInsertAudioTrackAt(te::Edit &edit, int index)
     {
         edit.ensureNumberOfAudioTracks(index + 1);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "AudioEngine.h"
+#include "EngineHelpers.h"
+#include <mutex>
+#include <tracktion_engine/tracktion_engine.h>
+
+/// Times the playback graph rebuilds that follow structural TrackManager/MidiClipManager
+/// batches. The outermost commit asks tracktion for one restart; the time runs from there
+/// until tracktion reports the reallocated playback context. Restarts tracktion makes on
+/// its own, outside a batch, aren't timed. Message thread only, apart from reading the stats.
+class GraphRebuildTimer : private te::TransportControl::Listener
+{
+public:
+  explicit GraphRebuildTimer(te::Engine &engine);
+  ~GraphRebuildTimer() override;
+
+  /// The timer for an engine created by AudioEngine, or nullptr
+  static GraphRebuildTimer *get(te::Engine &engine);
+
+  /// Follows the edit's transport. Detach before the edit is deleted.
+  void attach(te::Edit &edit);
+  void detach();
+
+  /// Called after a batch commit that restarted playback. Commits that land before the
+  /// context has been reallocated merge into the rebuild already being timed.
+  void restartRequested();
+
+  GraphRebuildStats getStats() const;
+  void resetStats();
+
+private:
+  void playbackContextChanged() override;
+
+  te::Engine &engine;
+  te::Edit *edit = nullptr;
+  double pendingSince = 0.0;
+
+  mutable std::mutex statsLock;
+  GraphRebuildStats stats;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "EngineHelpers.h"
+#include <atomic>
+#include <memory>
+#include <tracktion_engine/tracktion_engine.h>
+
+/// Queued loop-range changes made while playing, without stopping the transport or
+/// reallocating the context. The switch is made on the audio thread, between device
+/// blocks, by moving the playback context's play head directly. When the new range starts
+/// at or before the current position the old range is shortened to end at the switch
+/// point, and the play head's own loop wrap makes the jump on the exact sample. A play
+/// head can only jump forward on a block boundary, so a range starting later takes over
+/// at the start of the block the switch point falls in.
+///
+/// The play head belongs to the playback context: cancel() before anything frees it.
+class LoopSwitcher : private juce::AudioIODeviceCallback,
+                     private juce::AsyncUpdater
+{
+public:
+  explicit LoopSwitcher(te::Edit &edit);
+  ~LoopSwitcher() override;
+
+  /// Switches to range at the end of the current loop (quantiseBeats 0) or on the next
+  /// multiple of quantiseBeats. Applies immediately when the transport is stopped.
+  bool queue(te::TimeRange range, double quantiseBeats);
+  /// Once this returns the audio thread no longer refers to the context's play head
+  void cancel();
+  bool isPending() const { return state != idle; }
+
+private:
+  enum State
+  {
+    idle,
+    queued,
+    wrapping // play head loops [start, switchPoint) until its next wrap
+  };
+
+  void audioDeviceIOCallbackWithContext(const float *const *, int, float *const *outputChannelData,
+                                        int numOutputChannels, int numSamples,
+                                        const juce::AudioIODeviceCallbackContext &) override;
+  void audioDeviceAboutToStart(juce::AudioIODevice *) override {}
+  void audioDeviceStopped() override {}
+
+  // Brings the transport's own loop range in line once the audio thread has switched
+  void handleAsyncUpdate() override;
+
+  te::Edit &edit;
+  std::atomic<int> state{idle};
+  std::atomic<te::graph::PlayHead *> playHead{nullptr};
+  std::atomic<juce::int64> newStart{0}, newEnd{0};
+  // Timeline sample to switch at, or -1 for the end of the current loop
+  std::atomic<juce::int64> switchPoint{-1};
+
+  te::TimeRange pendingRange;
+  std::unique_ptr<te::TransportControl::ReallocationInhibitor> inhibitor;
+};
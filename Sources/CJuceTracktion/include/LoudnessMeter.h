@@ -0,0 +1,101 @@
+#pragma once
+
+#include "CJuceTracktionExport.h"
+#include "EngineHelpers.h"
+#include "SwiftBridgingCompat.h"
+#include <array>
+#include <atomic>
+#include <juce_dsp/juce_dsp.h>
+#include <tracktion_engine/tracktion_engine.h>
+
+/// Latest levels from a meter. Peak and RMS are dBFS over the last 100 ms window;
+/// loudness values are LUFS (ITU-R BS.1770 / EBU R128). Silence reads as -100.
+struct CJUCETRACKTION_API MeterReading
+{
+  float peakLeft = -100.0f;
+  float peakRight = -100.0f;
+  float rmsLeft = -100.0f;
+  float rmsRight = -100.0f;
+  float momentaryLufs = -100.0f;
+  float shortTermLufs = -100.0f;
+  float integratedLufs = -100.0f;
+} SWIFT_SELF_CONTAINED;
+
+/// Peak, RMS and K-weighted loudness meter.
+/// process() runs on the audio thread without locks or allocation; results are published
+/// every 100 ms through atomics, so getReading() can be polled from any thread.
+/// Integrated loudness uses the BS.1770 absolute and relative gates over a fixed
+/// 0.1 LU histogram, so it runs in constant memory however long the programme is.
+class LoudnessMeter
+{
+public:
+  static constexpr int maxChannels = 2;
+  static constexpr float silenceDb = -100.0f;
+
+  LoudnessMeter();
+
+  /// Call before processing and whenever the sample rate changes; clears all history
+  void prepare(double sampleRate);
+  void process(const juce::AudioBuffer<float> &buffer, int startSample, int numSamples);
+
+  MeterReading getReading() const;
+
+  /// Restarts integrated loudness. Safe from any thread: applied on the next process().
+  void resetIntegrated() { resetRequested = true; }
+
+private:
+  // One lane per channel, so the K-weighting filters run on all channels at once
+  using Lanes = juce::dsp::SIMDRegister<double>;
+  static_assert(Lanes::SIMDNumElements >= maxChannels, "K-weighting needs a lane per channel");
+
+  struct Biquad
+  {
+    Lanes b0 = Lanes::expand(1.0), b1 = Lanes::expand(0.0), b2 = Lanes::expand(0.0);
+    Lanes a1 = Lanes::expand(0.0), a2 = Lanes::expand(0.0);
+    Lanes z1 = Lanes::expand(0.0), z2 = Lanes::expand(0.0);
+
+    void setCoefficients(double newB0, double newB1, double newB2, double newA1, double newA2)
+    {
+      *this = {Lanes::expand(newB0), Lanes::expand(newB1), Lanes::expand(newB2),
+               Lanes::expand(newA1), Lanes::expand(newA2)};
+    }
+
+    Lanes process(Lanes x)
+    {
+      const Lanes y = b0 * x + z1;
+      z1 = b1 * x - a1 * y + z2;
+      z2 = b2 * x - a2 * y;
+      return y;
+    }
+  };
+
+  static constexpr int shortTermBlocks = 30;   // 3 s of 100 ms blocks
+  static constexpr int momentaryBlocks = 4;    // 400 ms
+  static constexpr int histogramBins = 800;    // -70 .. +10 LUFS in 0.1 LU steps
+
+  void clearHistory();
+  void finishBlock();
+  double getIntegratedPower() const;
+
+  int blockSamples = 4410;
+  int blockPosition = 0;
+  int numChannelsSeen = 1;
+
+  Biquad shelf, highPass;
+  std::array<float, maxChannels> blockPeak{};
+  std::array<double, maxChannels> blockSquares{};
+  std::array<double, maxChannels> blockWeighted{};
+
+  std::array<double, shortTermBlocks> blockPowers{};
+  int nextBlock = 0;
+  juce::int64 totalBlocks = 0;
+
+  std::array<double, histogramBins> binPower{};
+  std::array<juce::uint32, histogramBins> binCount{};
+  double gatedPower = 0.0;
+  juce::uint64 gatedCount = 0;
+
+  std::atomic<bool> resetRequested{false};
+  std::atomic<float> peak[maxChannels], rms[maxChannels];
+  std::atomic<float> momentary{silenceDb}, shortTerm{silenceDb}, integrated{silenceDb};
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CJuceTracktionExport.h"
+#include "EngineHelpers.h"
+#include "SwiftBridgingCompat.h"
+#include <cstdint>
+#include <tracktion_engine/tracktion_engine.h>
+
+/// Memory held by an engine, broken down by subsystem. Sizes are in bytes; everything
+/// except residentBytes is computed from the objects' own sizes rather than measured.
+struct CJUCETRACKTION_API MemoryReport
+{
+  /// Decoded sounds owned by te::SamplerPlugins
+  int64_t samplerSampleBytes = 0;
+  /// Process-wide SampleCache, which also holds every DrumSamplerPlugin's sounds
+  int64_t sampleCacheBytes = 0;
+  /// tracktion's audio file cache for clip playback
+  int64_t audioFileCacheBytes = 0;
+  /// Stored undo transactions, in the UndoManager's size units (roughly bytes)
+  int64_t undoHistoryBytes = 0;
+  int64_t editStateBytes = 0;
+  /// Node output buffers of the playback graph, when a context is allocated
+  int64_t playbackBufferBytes = 0;
+  /// Plugin objects themselves; hosted plugins' own heaps aren't visible
+  int64_t pluginInstanceBytes = 0;
+  int numPlugins = 0;
+  /// Resident size of the whole process, and the part not attributed above
+  int64_t residentBytes = 0;
+  int64_t otherBytes = 0;
+} SWIFT_SELF_CONTAINED;
+
+/// Builds MemoryReports for an edit. Each report walks tracks and plugins only; the
+/// edit's ValueTree is measured again only after it changed, so polling every few
+/// seconds stays cheap however large the edit is. Call from the message thread.
+class MemoryAccountant : private juce::ValueTree::Listener
+{
+public:
+  explicit MemoryAccountant(te::Edit &edit);
+  ~MemoryAccountant() override;
+
+  MemoryReport getReport();
+
+  /// Resident set size of the process, or 0 where it can't be read
+  static int64_t getResidentBytes();
+
+private:
+  void valueTreePropertyChanged(juce::ValueTree &, const juce::Identifier &) override { stateChanged = true; }
+  void valueTreeChildAdded(juce::ValueTree &, juce::ValueTree &) override { stateChanged = true; }
+  void valueTreeChildRemoved(juce::ValueTree &, juce::ValueTree &, int) override { stateChanged = true; }
+
+  te::Edit &edit;
+  bool stateChanged = true;
+  int64_t editStateBytes = 0;
+};
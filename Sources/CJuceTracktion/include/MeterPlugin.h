@@ -0,0 +1,45 @@
+#pragma once
+
+#include "EngineHelpers.h"
+#include "LoudnessMeter.h"
+#include <tracktion_engine/tracktion_engine.h>
+
+/// Pass-through plugin that feeds a LoudnessMeter. TrackManager appends one to each track
+/// it creates (post-fader), and AudioEngine to the master chain and to the tracks of every
+/// edit it creates or loads.
+class MeterPlugin : public te::Plugin
+{
+public:
+  MeterPlugin(te::PluginCreationInfo info);
+  ~MeterPlugin() override;
+
+  static const char *getPluginName() { return "Meter"; }
+  static const char *xmlTypeName;
+
+  juce::String getName() const override { return getPluginName(); }
+  juce::String getPluginType() override { return xmlTypeName; }
+  juce::String getShortName(int) override { return "Meter"; }
+  juce::String getSelectableDescription() override { return getName(); }
+  bool needsConstantBufferSize() override { return false; }
+
+  bool takesMidiInput() override { return false; }
+  bool takesAudioInput() override { return true; }
+  bool producesAudioWhenNoAudioInput() override { return false; }
+  int getNumOutputChannelsGivenInputs(int numInputChannels) override { return numInputChannels; }
+
+  void initialise(const te::PluginInitialisationInfo &) override;
+  void deinitialise() override {}
+  void applyToBuffer(const te::PluginRenderContext &) override;
+
+  MeterReading getReading() const { return meter.getReading(); }
+  void resetIntegratedLoudness() { meter.resetIntegrated(); }
+
+  /// Appends a meter to the end of the chain unless it already has one
+  static void addTo(te::Edit &edit, te::PluginList &plugins);
+
+private:
+  LoudnessMeter meter;
+  double preparedSampleRate = 0.0;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MeterPlugin)
+};
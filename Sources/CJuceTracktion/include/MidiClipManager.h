@@ -9,11 +9,13 @@
 #include <vector>
 #include <memory>
 
-class CJUCETRACKTION_API MidiClipManager
+/// Follows the engine's edit when AudioEngine replaces it. The edit belongs to the
+/// engine; the edit can't be replaced while a batch is open.
+class CJUCETRACKTION_API MidiClipManager : private AudioEngineHelpers::EditFollower
 {
 public:
   MidiClipManager(te::Edit *edit);
-  ~MidiClipManager();
+  ~MidiClipManager() override;
   static MidiClipManager *create(te::Edit *edit);
 
   int createMidiClip(int trackID, const std::string &name, double startBar, double lengthInBars)
@@ -25,8 +27,19 @@ public:
       SWIFT_NAME(MidiClipManager.removeNote(clipID:noteNumber:startTime:));
   std::vector<MidiNote> getNotes(int clipID) SWIFT_NAME(MidiClipManager.getNotes(clipID:));
 
+  /// Starts a batch: clips and notes added until commitBatch() are applied with a
+  /// single playback graph rebuild and undo transaction. Batches nest.
+  void beginBatch() SWIFT_NAME(MidiClipManager.beginBatch());
+  void commitBatch() SWIFT_NAME(MidiClipManager.commitBatch());
+  bool isBatching() const SWIFT_COMPUTED_PROPERTY;
+
 private:
-  std::unique_ptr<te::Edit> edit;
+  void editReplaced(te::Edit *newEdit) override;
+  bool isHoldingEdit() const override { return batch.isActive(); }
+
+  te::Edit *edit;
+  AudioEngineHelpers::EditBatch batch;
+  int pendingLoopClipID = -1;
   te::MidiClip *getMidiClipByID(int clipID);
   std::atomic<int> refCount{0};
 
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "CJuceTracktionExport.h"
+#include "EngineHelpers.h"
+#include "SwiftBridgingCompat.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <tracktion_engine/tracktion_engine.h>
+#include <vector>
+
+class TransportProbe;
+struct TransportSnapshot;
+
+/// Counters for MIDI recording, kept across takes until reset
+struct CJUCETRACKTION_API MidiRecordingStats
+{
+  /// Channel messages accepted while recording
+  int64_t eventsReceived = 0;
+  /// Messages lost because the queue was full; the message thread drains it every 50 ms
+  int64_t eventsDropped = 0;
+  int64_t notesRecorded = 0;
+  int64_t controllersRecorded = 0;
+} SWIFT_SELF_CONTAINED;
+
+/// Records MIDI input into a te::MidiClip. Every MIDI input device gets the recorder as a
+/// consumer; on the device's MIDI thread each channel message is stamped with its edit
+/// time, taken from the lock-free TransportProbe snapshot plus the time since that block,
+/// less the device's output latency, and pushed onto a bounded queue without locking or
+/// allocating. The message thread
+/// drains the queue and merges notes (paired on/off) and controllers into the clip, either
+/// every drain or once when recording stops. A take is one undo transaction.
+class MidiRecorder : private te::MidiInputDevice::Consumer,
+                     private juce::Timer
+{
+public:
+  explicit MidiRecorder(te::Edit &edit);
+  ~MidiRecorder() override;
+
+  /// Records into the MIDI clip with this ID while the transport plays. Notes running
+  /// past the clip's end extend it.
+  bool start(int clipID, bool incremental);
+  /// Merges the rest of the take, ending held notes now. Returns the notes recorded.
+  int stop();
+  bool isRecording() const { return recording.load(); }
+
+  MidiRecordingStats getStats() const;
+  void resetStats();
+
+  /// The virtual input: delivers a message exactly as a MIDI device would, from any thread.
+  /// A non-negative editSeconds places it on the timeline directly, transport or not;
+  /// otherwise it's stamped like device input.
+  void injectMessage(const juce::MidiMessage &message, double editSeconds);
+
+  /// Edit time of live input arriving at hostTimeNs, wrapped into the loop
+  static double getLiveEditSeconds(const TransportSnapshot &snapshot, int64_t hostTimeNs, double latencySeconds);
+
+private:
+  struct Event
+  {
+    // Edit time, wrapped into the loop; note lengths come from the host times instead,
+    // so notes held across a loop wrap keep their length
+    double seconds;
+    int64_t hostTimeNs;
+    bool explicitTime;
+    uint8_t data[3];
+  };
+
+  struct HeldNote
+  {
+    bool active = false;
+    bool explicitTime = false;
+    double seconds = 0.0;
+    int64_t hostTimeNs = 0;
+    uint8_t velocity = 0;
+  };
+
+  // Bounded multi-producer queue, since devices call in on their own threads: a slot's
+  // sequence says whether it's free for the write index or full for the read index
+  struct Slot
+  {
+    std::atomic<uint32_t> sequence{0};
+    Event event;
+  };
+
+  static constexpr uint32_t queueSize = 4096;
+
+  void handleIncomingMidiMessage(const juce::MidiMessage &, te::MPESourceID) override;
+  void timerCallback() override;
+
+  void push(const juce::MidiMessage &message, double editSeconds);
+  bool pop(Event &event);
+  void drain();
+  void merge(bool endHeldNotes);
+
+  te::Edit &edit;
+  TransportProbe *const probe;
+
+  std::vector<Slot> slots;
+  std::atomic<uint32_t> writeIndex{0};
+  uint32_t readIndex = 0;
+
+  std::atomic<bool> recording{false};
+  std::atomic<double> outputLatencySeconds{0.0};
+  std::atomic<int64_t> eventsReceived{0}, eventsDropped{0};
+
+  // Message thread only
+  int clipID = -1;
+  bool incremental = false;
+  std::vector<Event> pending;
+  std::array<HeldNote, 16 * 128> heldNotes;
+  int64_t lastHostTimeNs = 0;
+  int notesThisTake = 0;
+  int64_t notesRecorded = 0, controllersRecorded = 0;
+};
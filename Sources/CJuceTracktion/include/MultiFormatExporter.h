@@ -0,0 +1,54 @@
+#pragma once
+
+#include "CJuceTracktionExport.h"
+#include "EngineHelpers.h"
+#include "SwiftBridgingCompat.h"
+#include <string>
+#include <tracktion_engine/tracktion_engine.h>
+#include <vector>
+
+/// One deliverable of a multi-format export. The format comes from the file extension
+/// (.wav, .aif, .flac, .ogg).
+struct CJUCETRACKTION_API ExportTarget {
+    std::string filePath;
+    int bitDepth;
+    bool dither;
+    double sampleRate;
+    int quality;
+
+    ExportTarget() : filePath(""), bitDepth(24), dither(false), sampleRate(0.0), quality(-1) {}
+    ExportTarget(const std::string& path, int bits, bool shouldDither, double rate, int qualityIndex = -1)
+        : filePath(path), bitDepth(bits), dither(shouldDither), sampleRate(rate), quality(qualityIndex) {}
+} SWIFT_SELF_CONTAINED;
+
+/// Builder for the targets of AudioEngine::exportAudioFormats (Swift-friendly)
+class CJUCETRACKTION_API ExportBuilder {
+public:
+    /// sampleRate 0 keeps the render rate; dither adds TPDF noise at the target bit depth
+    void addTarget(const std::string& filePath, int bitDepth, bool dither, double sampleRate)
+        SWIFT_MUTATING
+        SWIFT_NAME(ExportBuilder.addTarget(filePath:bitDepth:dither:sampleRate:));
+
+    /// quality is the format's quality option index, e.g. the Ogg Vorbis bitrate (-1 = default)
+    void addTarget(const std::string& filePath, int bitDepth, bool dither, double sampleRate, int quality)
+        SWIFT_MUTATING
+        SWIFT_NAME(ExportBuilder.addTarget(filePath:bitDepth:dither:sampleRate:quality:));
+
+    const std::vector<ExportTarget>& getTargets() const { return targets; }
+    void clear() SWIFT_MUTATING { targets.clear(); }
+    size_t getTargetCount() const { return targets.size(); }
+
+private:
+    std::vector<ExportTarget> targets;
+} SWIFT_SELF_CONTAINED;
+
+/// Streams one rendered mix to several encoders at once. The source is read a block at a
+/// time and every block is shared with all encoders, each of which resamples, dithers and
+/// writes on its own thread.
+class MultiFormatExporter
+{
+public:
+    /// Returns the number of targets written successfully
+    static int exportTargets(te::Engine& engine, juce::AudioFormatReader& source,
+                             const std::vector<ExportTarget>& targets, void (*onprogresschange)(float));
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "CJuceTracktionExport.h"
+#include "EngineHelpers.h"
+#include <array>
+#include <atomic>
+#include <juce_osc/juce_osc.h>
+#include <memory>
+#include <tracktion_engine/tracktion_engine.h>
+#include <vector>
+
+class AudioEngine;
+class MidiClipManager;
+class OscLiveInputPlugin;
+class TrackManager;
+
+/// Remote control over OSC on localhost, so controllers can drive a headless engine
+/// without going through Swift. Numbers may be sent as ints or floats.
+///
+///   /transport/play                       /transport/stop
+///   /transport/loop     start end quantiseBeats          (queueLoopRange, seconds)
+///   /tempo              bpm
+///   /track/create       name                             -> track ID
+///   /track/remove       trackID
+///   /track/audioclip    trackID path startBar lengthInBars
+///   /track/midiclip     trackID startBar lengthInBars    -> clip ID
+///   /track/live         trackID                          -> enables /live/note for the track
+///   /clip/create        trackID name startBar lengthInBars -> clip ID
+///   /clip/delete        trackID clipID
+///   /clip/note/add      clipID note startBeat lengthBeats velocity
+///   /clip/note/remove   clipID note startBeat
+///   /param/bind         slot trackID pluginIndex parameterIndex
+///   /live/note          trackID note velocity            (velocity 0 is a note-off)
+///   /live/param         slot value                       (0-1, as the parameter's normalised value)
+///
+/// Edit commands run on the message thread through AudioEngine, TrackManager and
+/// MidiClipManager. A bundle is all or nothing: it's rejected unless every message in it
+/// is a known command, and applied as one batch that's committed once, so there's one
+/// undo transaction and the graph isn't rebuilt until every message has been applied.
+/// If a command fails, the edit changes and bindings made so far are undone and every
+/// message in the bundle is answered with -1. Transport commands aren't undone. Bundle
+/// time tags are ignored.
+///
+/// /live messages never wait for the message thread, even inside bundles. Notes are
+/// queued lock-free on the OSC thread for an OscLiveInputPlugin at the head of the track,
+/// which plays them at the start of the next block. Parameter values are set from the OSC
+/// thread the way automation sets them from the audio thread, and the edit's state
+/// catches up asynchronously.
+///
+/// With a reply port, each edit command is answered with /reply address result to
+/// localhost, result being the new ID, 1 for success or -1 for failure.
+///
+/// The managers must share the engine's edit and outlive the server. When the engine
+/// loads a snapshot the server drops its live tracks and parameter bindings, which
+/// belong to the old edit, and keeps listening on the same ports.
+class CJUCETRACKTION_API OscServer : private juce::OSCReceiver::Listener<juce::OSCReceiver::MessageLoopCallback>,
+                                     private AudioEngineHelpers::EditFollower
+{
+public:
+  OscServer(AudioEngine &engine, TrackManager &tracks, MidiClipManager &clips);
+  ~OscServer() override;
+
+  /// Listens on 127.0.0.1:port (0 picks a free port, see getPort). replyPort 0 sends no replies.
+  bool start(int port, int replyPort);
+  void stop();
+  bool isRunning() const { return socket != nullptr; }
+  int getPort() const;
+
+  static constexpr int maxLiveTracks = 64;
+  static constexpr int maxParameterSlots = 256;
+
+private:
+  // Runs on the OSC thread and only picks out /live messages
+  struct LiveListener : juce::OSCReceiver::Listener<juce::OSCReceiver::RealtimeCallback>
+  {
+    explicit LiveListener(OscServer &s) : server(s) {}
+    void oscMessageReceived(const juce::OSCMessage &) override;
+    void oscBundleReceived(const juce::OSCBundle &) override;
+    OscServer &server;
+  };
+
+  struct LiveTrack
+  {
+    std::atomic<int> trackID{0};
+    std::atomic<OscLiveInputPlugin *> plugin{nullptr};
+  };
+
+  // Live tracks and parameter slots, so a failed bundle can put them back
+  struct Bindings
+  {
+    std::array<int, maxLiveTracks> liveTrackIDs{};
+    std::array<te::AutomatableParameter *, maxParameterSlots> parameters{};
+  };
+
+  void oscMessageReceived(const juce::OSCMessage &) override;
+  void oscBundleReceived(const juce::OSCBundle &) override;
+  void editReplaced(te::Edit *newEdit) override;
+
+  /// Returns the reply's result
+  int applyMessage(const juce::OSCMessage &message);
+  void applyLiveMessage(const juce::OSCMessage &message);
+  int enableLiveInput(int trackID);
+  int bindParameter(int slot, int trackID, int pluginIndex, int parameterIndex);
+  Bindings getBindings() const;
+  void setBindings(const Bindings &bindings);
+  void reply(const juce::String &address, int result);
+
+  AudioEngine &engine;
+  TrackManager &tracks;
+  MidiClipManager &clips;
+  te::Engine *followedEngine = nullptr;
+
+  juce::OSCReceiver receiver;
+  juce::OSCSender sender;
+  std::unique_ptr<juce::DatagramSocket> socket;
+  LiveListener liveListener{*this};
+  bool replying = false;
+  int replyPort = 0;
+
+  // Written on the message thread, read on the OSC thread. Everything the OSC thread
+  // could still be pointing at is kept alive until the server stops.
+  std::array<LiveTrack, maxLiveTracks> liveTracks;
+  std::array<std::atomic<te::AutomatableParameter *>, maxParameterSlots> parameters{};
+  std::vector<te::Plugin::Ptr> heldPlugins;
+  std::vector<te::AutomatableParameter::Ptr> heldParameters;
+};
+
+/// Pass-through plugin at the head of a track that plays notes queued by OscServer,
+/// e.g. into a sampler after it
+class OscLiveInputPlugin : public te::Plugin
+{
+public:
+  OscLiveInputPlugin(te::PluginCreationInfo info);
+  ~OscLiveInputPlugin() override;
+
+  static const char *getPluginName() { return "OSC Live Input"; }
+  static const char *xmlTypeName;
+
+  juce::String getName() const override { return getPluginName(); }
+  juce::String getPluginType() override { return xmlTypeName; }
+  juce::String getShortName(int) override { return "OSC"; }
+  juce::String getSelectableDescription() override { return getName(); }
+  bool needsConstantBufferSize() override { return false; }
+
+  bool takesMidiInput() override { return true; }
+  bool takesAudioInput() override { return true; }
+  bool producesAudioWhenNoAudioInput() override { return false; }
+  int getNumOutputChannelsGivenInputs(int numInputChannels) override { return numInputChannels; }
+
+  void initialise(const te::PluginInitialisationInfo &) override {}
+  void deinitialise() override {}
+  void applyToBuffer(const te::PluginRenderContext &) override;
+
+  /// From a single thread at a time: queues a note for the next block. Returns false
+  /// when the queue is full.
+  bool queueNote(int noteNumber, int velocity);
+
+private:
+  struct Note
+  {
+    uint8_t number;
+    uint8_t velocity;
+  };
+
+  static constexpr int queueSize = 512;
+
+  juce::AbstractFifo fifo{queueSize};
+  std::array<Note, queueSize> queue{};
+  const te::MPESourceID sourceID;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OscLiveInputPlugin)
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "CJuceTracktionExport.h"
+#include "EngineHelpers.h"
+#include "SwiftBridgingCompat.h"
+#include <string>
+#include <tracktion_engine/tracktion_engine.h>
+#include <vector>
+
+/// Process-wide table of plugin presets. Each preset's XML, from a built-in string or
+/// a SoundBank file, is parsed once into an immutable ValueTree; plugins are then
+/// created or switched by copying state from that tree.
+/// "Organ" and "Lead" 4OSC presets are registered by default.
+class CJUCETRACKTION_API PresetRegistry
+{
+public:
+  /// Registering an existing name replaces it; plugins already using it keep their state
+  static void registerPresetXml(const std::string &name, const std::string &xml)
+      SWIFT_NAME(PresetRegistry.registerPreset(name:xml:));
+  static bool registerPresetFile(const std::string &name, const std::string &filePath)
+      SWIFT_NAME(PresetRegistry.registerPreset(name:filePath:));
+
+  static bool hasPreset(const std::string &name) SWIFT_NAME(PresetRegistry.hasPreset(_:));
+  static std::vector<std::string> getPresetNames();
+
+  /// Parses every preset that hasn't been used yet on a background thread
+  static void prewarm();
+
+  /// The compiled PLUGIN state, or an invalid tree if the preset is unknown or unparseable.
+  /// Shared between callers: copy it before making changes.
+  static juce::ValueTree getPreset(const std::string &name);
+
+  /// Creates a plugin of the preset's type with its state applied, not yet inserted
+  static te::Plugin::Ptr createPlugin(te::Edit &edit, const std::string &name);
+
+  /// Applies the preset to an existing plugin of the same type
+  static bool applyPreset(te::Plugin &plugin, const std::string &name);
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "CJuceTracktionExport.h"
+#include "EngineHelpers.h"
+#include "SwiftBridgingCompat.h"
+#include <cstdint>
+#include <tracktion_engine/tracktion_engine.h>
+
+/// Calls made on a checked audio thread since the counts were last reset
+struct CJUCETRACKTION_API RealtimeViolations
+{
+  int64_t allocations = 0;   // malloc, calloc, realloc, aligned allocations
+  int64_t deallocations = 0; // free
+  int64_t locks = 0;         // pthread mutex locks
+  int64_t blockingCalls = 0; // sleeps and file/console reads and writes
+  /// Violations that were counted but not reported because the report queue was full
+  int64_t unreported = 0;
+} SWIFT_SELF_CONTAINED;
+
+/// Debug-only check that the audio callback stays allocation- and lock-free.
+/// Builds with SWIFTTRACKTIONKIT_REALTIME_CHECKS=1 interpose malloc/free, mutex locks and
+/// blocking calls (sleeps, read, write) for the whole process. The interposed functions
+/// only look at a per-thread flag in a pthread key, which is set while the engine's device
+/// callbacks run, so other threads pay a single pthread_getspecific. Each violation is counted and its stack is
+/// captured into a preallocated queue; a message-thread timer symbolises and prints them.
+/// tracktion_graph's worker threads are not marked: they wait on semaphores between jobs.
+class RealtimeSafetyChecker : private juce::Timer
+{
+public:
+  /// Moves tracktion's device callback between the window markers, so juce stops and
+  /// restarts it once on an open device; create the checker before the edit plays
+  explicit RealtimeSafetyChecker(te::Engine &engine);
+  ~RealtimeSafetyChecker() override;
+
+  /// False when the hooks were compiled out; the checker then marks nothing
+  static bool isAvailable();
+
+  /// Process-wide counts: the hooks are shared by every engine
+  static RealtimeViolations getViolations();
+  static void resetViolations();
+
+  /// Moves the end of the checked window behind device callbacks added after the checker,
+  /// such as LoopSwitcher's, so they are checked too
+  void includeLaterCallbacks();
+
+private:
+  struct WindowMarker;
+
+  void timerCallback() override;
+
+  te::Engine &engine;
+  std::unique_ptr<WindowMarker> windowStart, windowEnd;
+};
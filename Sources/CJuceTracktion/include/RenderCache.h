@@ -0,0 +1,42 @@
+#pragma once
+
+#include "EngineHelpers.h"
+#include <memory>
+#include <tracktion_engine/tracktion_engine.h>
+
+/// Float render of an edit's full mix, reused while the edit is unchanged.
+/// Exports read from the cache instead of rendering the edit again, and keep the
+/// loudness analysis of the cached mix so later exports can skip that pass too.
+class RenderCache
+{
+public:
+  struct Analysis
+  {
+    bool valid = false;
+    double integratedLufs = -100.0;
+    double truePeakDb = -100.0;
+  };
+
+  explicit RenderCache(te::Edit &edit);
+  ~RenderCache();
+
+  /// Returns the cached mix for the edit's current state, rendering it first if the edit
+  /// changed since the last render. Returns an invalid File on failure.
+  juce::File getOrRender(void (*onprogresschange)(float));
+
+  /// Loudness and true peak of the cached mix, measured on first request
+  Analysis getAnalysis();
+
+  void clear();
+
+  /// Opens a reader on a cache file; the caller owns it
+  static std::unique_ptr<juce::AudioFormatReader> createReader(const juce::File &file);
+
+private:
+  juce::String computeKey() const;
+
+  te::Edit &edit;
+  juce::String cachedKey;
+  juce::File cachedFile;
+  Analysis analysis;
+};
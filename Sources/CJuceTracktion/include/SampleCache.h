@@ -0,0 +1,61 @@
+#pragma once
+
+#include "EngineHelpers.h"
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tracktion_engine/tracktion_engine.h>
+#include <vector>
+
+/// Process-wide cache of decoded sample content, optionally converted once to a target
+/// rate with a windowed-sinc interpolator (low-passed first when going down in rate).
+/// Entries are immutable and shared, so the same kit loaded on many tracks decodes and
+/// resamples only once. The cache only holds weak references: content is freed when the
+/// last sound using it goes, and decoded again if it's needed after that.
+class SampleCache
+{
+public:
+  struct Sample
+  {
+    juce::AudioBuffer<float> audio;
+    double sampleRate = 0.0;
+  };
+
+  using SamplePtr = std::shared_ptr<const Sample>;
+
+  static SampleCache &getInstance();
+
+  /// Decodes the file and converts it to targetSampleRate (0 keeps the file's own rate).
+  /// Blocks until the entry is ready; returns nullptr if the file can't be read.
+  SamplePtr getSample(const juce::File &file, double targetSampleRate);
+
+  /// Loads several files in parallel on the cache's worker pool and waits for them. Hold
+  /// on to the result until the samples have been picked up, or they're freed again.
+  std::vector<SamplePtr> prefetch(const std::vector<juce::File> &files, double targetSampleRate);
+
+  /// Returns a float WAV of the file at targetSampleRate, written into cacheDirectory on
+  /// first use. Returns the original file when it's already at that rate or on failure.
+  juce::File getResampledFile(const juce::File &file, double targetSampleRate, const juce::File &cacheDirectory);
+
+  /// Bytes of decoded content still in use
+  size_t getMemoryBytes() const;
+  /// Forgets every entry; content still in use stays alive with its users
+  void clear();
+
+private:
+  struct Entry
+  {
+    std::shared_future<SamplePtr> loading; // valid until the load has finished
+    std::weak_ptr<const Sample> sample;
+  };
+
+  SampleCache();
+
+  std::shared_future<SamplePtr> findOrSchedule(const juce::File &file, double targetSampleRate, bool runInline);
+  static SamplePtr load(const juce::File &file, double targetSampleRate);
+
+  mutable std::mutex lock;
+  std::map<juce::String, Entry> entries;
+  juce::ThreadPool pool;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "EngineHelpers.h"
+#include <atomic>
+#include <memory>
+#include <tracktion_engine/tracktion_engine.h>
+
+/// Pre-rendered time-stretch proxies for tempo-synced wave clips.
+/// After a tempo change every auto-tempo clip keeps playing with real-time stretching
+/// while a background pool renders its source at the new tempo with the offline (higher
+/// quality) stretcher. As each proxy finishes the clip is pointed at it, so it plays at
+/// its natural speed and the audio thread no longer stretches it. The original source is
+/// kept in the clip state and restored when the clip's stretch ratio changes; clips whose
+/// ratio stays the same keep their proxy. Proxies live in the engine's temp directory, so
+/// snapshots leave them out (see removeStretchProxies).
+class TimeStretchProxies : private juce::ValueTree::Listener,
+                           private juce::AsyncUpdater
+{
+public:
+  explicit TimeStretchProxies(te::Edit &edit);
+  ~TimeStretchProxies() override;
+
+  /// Proxies queued or rendering
+  int getNumPending() const { return numPending; }
+
+  /// Points clips in a copy of an edit's state back at their original sources
+  static void removeStretchProxies(juce::ValueTree &editState);
+
+private:
+  class RenderJob;
+
+  void handleAsyncUpdate() override;
+  void renderFinished(juce::int64 generation, te::EditItemID clipID, const juce::File &proxy);
+  void applyProxy(te::WaveAudioClip &clip, const juce::File &proxy);
+
+  void valueTreePropertyChanged(juce::ValueTree &, const juce::Identifier &) override;
+  void valueTreeChildAdded(juce::ValueTree &, juce::ValueTree &) override;
+
+  te::Edit &edit;
+  juce::ThreadPool renderPool;
+  juce::int64 generation = 0;
+  std::atomic<int> numPending{0};
+  std::shared_ptr<bool> alive = std::make_shared<bool>(true);
+};
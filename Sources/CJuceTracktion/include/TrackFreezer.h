@@ -0,0 +1,48 @@
+#pragma once
+
+#include "EngineHelpers.h"
+#include <map>
+#include <memory>
+#include <tracktion_engine/tracktion_engine.h>
+
+/// Renders tracks (clips plus plugin chain) to cached audio files on a background
+/// thread and swaps in a proxy track that just plays the file. The original track's
+/// processing is switched off until it is edited again, explicitly unfrozen or the
+/// freezer is deleted. Meters and changes to names or colours don't count as edits.
+///
+/// The proxy only lives as long as the freezer: it is marked so snapshots leave it out
+/// (see removeFreezeProxies) and isFreezeProxy lets listings skip it.
+///
+/// te::AudioTrack::setFrozen isn't used because it stops the transport and renders
+/// synchronously on the message thread through Renderer::renderToFile. Its frozen flag
+/// is also saved with the edit, so freezes would outlive the cache that backs them.
+class TrackFreezer
+{
+public:
+  explicit TrackFreezer(te::Edit &edit);
+  ~TrackFreezer();
+
+  /// Starts a background render; the swap happens on the message thread once it finishes.
+  bool freeze(te::AudioTrack &track);
+  bool unfreeze(te::AudioTrack &track);
+
+  bool isFrozen(const te::AudioTrack &track) const;
+  bool isFreezing(const te::AudioTrack &track) const;
+
+  static bool isFreezeProxy(const te::Track &track);
+  /// Removes proxy tracks from a copy of an edit's state and switches their sources back on
+  static void removeFreezeProxies(juce::ValueTree &editState);
+
+private:
+  struct FrozenTrack;
+  class RenderRunner;
+
+  void renderFinished(int trackID, const juce::File &file);
+  void unfreezeAfterEdit(int trackID);
+  void restore(FrozenTrack &entry, te::AudioTrack *track);
+
+  te::Edit &edit;
+  juce::ThreadPool renderPool{1};
+  std::map<int, std::unique_ptr<FrozenTrack>> tracks;
+  std::shared_ptr<bool> alive = std::make_shared<bool>(true);
+};
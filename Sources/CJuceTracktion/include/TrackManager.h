@@ -1,7 +1,9 @@
 #pragma once
 
+#include "AudioRecorder.h"
 #include "CJuceTracktionExport.h"
 #include "EngineHelpers.h"
+#include "TrackFreezer.h"
 #include <juce_core/juce_core.h>
 #include <map>
 #include <string>
@@ -13,9 +15,10 @@
 struct CJUCETRACKTION_API SamplerSample {
     std::string filePath;
     int noteNumber;
+    int chokeGroup;
 
-    SamplerSample() : filePath(""), noteNumber(0) {}
-    SamplerSample(const std::string& path, int note) : filePath(path), noteNumber(note) {}
+    SamplerSample() : filePath(""), noteNumber(0), chokeGroup(0) {}
+    SamplerSample(const std::string& path, int note, int choke = 0) : filePath(path), noteNumber(note), chokeGroup(choke) {}
 } SWIFT_SELF_CONTAINED;
 
 /// Builder for creating sampler plugins with Swift-friendly API
@@ -28,6 +31,15 @@ public:
         SWIFT_MUTATING
         SWIFT_NAME(SamplerPluginBuilder.addSample(filePath:noteNumber:));
 
+    /// Samples sharing a non-zero choke group cut each other off (high-performance sampler only)
+    void addSample(const std::string& filePath, int noteNumber, int chokeGroup)
+        SWIFT_MUTATING
+        SWIFT_NAME(SamplerPluginBuilder.addSample(filePath:noteNumber:chokeGroup:));
+
+    /// Voice limit for the high-performance sampler; the oldest voice is stolen beyond it
+    void setMaxPolyphony(int voices) SWIFT_MUTATING SWIFT_NAME(SamplerPluginBuilder.setMaxPolyphony(_:));
+    int getMaxPolyphony() const { return maxPolyphony; }
+
     const std::vector<SamplerSample>& getSamples() const;
     void clear() SWIFT_MUTATING;
 
@@ -35,19 +47,27 @@ public:
 
 private:
     std::vector<SamplerSample> samples;
+    int maxPolyphony = 32;
 } SWIFT_SELF_CONTAINED;
 
-class CJUCETRACKTION_API TrackManager
+/// Follows the engine's edit when AudioEngine replaces it; tracks of the old edit are
+/// unfrozen and disarmed first. The edit can't be replaced while a batch or recording is open.
+class CJUCETRACKTION_API TrackManager : private AudioEngineHelpers::EditFollower
 {
 public:
   static TrackManager *create(te::Edit *edit);
   TrackManager(te::Edit *edit);
-  ~TrackManager();
+  ~TrackManager() override;
 
   int createAudioTrack(const std::string &name) SWIFT_NAME(TrackManager.createAudioTrack(name:));
   bool removeTrack(int trackID) SWIFT_NAME(TrackManager.removeTrack(byID:));
   bool addAudioClip(int trackID, const std::string &filePath, double startBar, double lengthInBars)
       SWIFT_NAME(TrackManager.addAudioClip(forTrackID:filePath:startBar:lengthInBars:));
+  /// Adds a clip that follows the edit tempo. sourceBpm is the file's own tempo; after
+  /// tempo changes the clip is served from a pre-rendered stretch proxy once it is ready.
+  bool addAudioClip(int trackID, const std::string &filePath, double startBar, double lengthInBars,
+                    double sourceBpm)
+      SWIFT_NAME(TrackManager.addAudioClip(forTrackID:filePath:startBar:lengthInBars:sourceBpm:));
   int addMidiClip(int trackID, double startBar, double lengthInBars)
       SWIFT_NAME(TrackManager.addMidiClip(forTrackID:startBar:lengthInBars:));
 
@@ -55,11 +75,69 @@ public:
   void createSamplerPluginWithBuilder(int trackID, const SamplerPluginBuilder& builder)
       SWIFT_NAME(TrackManager.createSamplerPlugin(trackID:builder:));
 
+  /// Creates the high-performance drum sampler: preallocated voices, vectorised mixing,
+  /// choke groups and a polyphony limit taken from the builder
+  void createDrumSamplerPluginWithBuilder(int trackID, const SamplerPluginBuilder& builder)
+      SWIFT_NAME(TrackManager.createDrumSamplerPlugin(trackID:builder:));
+
+  /// Inserts a plugin configured from a PresetRegistry preset at the start of the chain
+  bool createPresetPlugin(int trackID, const std::string &presetName)
+      SWIFT_NAME(TrackManager.createPresetPlugin(trackID:presetName:));
+
+  /// Switches an existing plugin to a registered preset of the same plugin type
+  bool applyPreset(int trackID, int pluginIndex, const std::string &presetName)
+      SWIFT_NAME(TrackManager.applyPreset(trackID:pluginIndex:presetName:));
+
   /// Legacy method for C++ callers using std::vector directly
   void createSamplerPlugin(int trackID, std::vector<std::string> defaultSampleFiles);
 
+  /// Starts a batch: tracks, clips and plugins added until commitBatch() are applied
+  /// with a single playback graph rebuild and undo transaction. Batches nest.
+  void beginBatch() SWIFT_NAME(TrackManager.beginBatch());
+  void commitBatch() SWIFT_NAME(TrackManager.commitBatch());
+  bool isBatching() const SWIFT_COMPUTED_PROPERTY;
+
+  /// Renders the track and its plugin chain to a cached file in the background, then
+  /// plays that file instead of running the track's DSP until the track is edited again.
+  bool freezeTrack(int trackID) SWIFT_NAME(TrackManager.freezeTrack(byID:));
+  bool unfreezeTrack(int trackID) SWIFT_NAME(TrackManager.unfreezeTrack(byID:));
+  bool isTrackFrozen(int trackID) const SWIFT_NAME(TrackManager.isTrackFrozen(byID:));
+
+  /// Arms the track to record numChannels (1 or 2) of the device's active inputs from
+  /// firstInputChannel, or of the fake input's channels. Fails for channels that don't
+  /// exist. Arming can't change while recording.
+  bool armTrack(int trackID, int firstInputChannel, int numChannels)
+      SWIFT_NAME(TrackManager.armTrack(byID:firstInputChannel:numChannels:));
+  bool disarmTrack(int trackID) SWIFT_NAME(TrackManager.disarmTrack(byID:));
+  bool isTrackArmed(int trackID) const SWIFT_NAME(TrackManager.isTrackArmed(byID:));
+
+  /// Streams armed tracks' input to WAV files in directoryPath (the engine's temp
+  /// directory when empty) through a writer thread (see AudioRecorder)
+  bool startRecording(const std::string &directoryPath) SWIFT_NAME(TrackManager.startRecording(directory:));
+  /// Finishes the files and adds each take as a clip where recording started, less the
+  /// device's input and output latency, as addAudioClip would. Returns the number of
+  /// clips added.
+  int stopRecording() SWIFT_NAME(TrackManager.stopRecording());
+  bool isRecording() const SWIFT_COMPUTED_PROPERTY;
+  AudioRecordingStats getRecordingStats() const SWIFT_COMPUTED_PROPERTY;
+
+  /// Records from a file played in real time instead of the audio device, for testing
+  /// without hardware. An empty path goes back to the device.
+  bool setFakeRecordingInput(const std::string &filePath, bool loop)
+      SWIFT_NAME(TrackManager.setFakeRecordingInput(filePath:loop:));
+
 private:
+  void editReplaced(te::Edit *newEdit) override;
+  bool isHoldingEdit() const override;
+
+  te::AudioTrack *findAudioTrack(int trackID) const;
+  te::WaveAudioClip::Ptr insertAudioClip(te::AudioTrack &track, const juce::File &file, te::TimePosition start,
+                                         te::TimeDuration offset = {});
+
   te::Edit *edit;
+  AudioEngineHelpers::EditBatch batch;
+  std::unique_ptr<TrackFreezer> freezer;
+  std::unique_ptr<AudioRecorder> recorder;
   std::atomic<int> refCount{0};
 
   friend void retainTrackManager(TrackManager *);
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "CJuceTracktionExport.h"
+#include "EngineHelpers.h"
+#include "SwiftBridgingCompat.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <tracktion_engine/tracktion_engine.h>
+#include <vector>
+
+/// Transport state at the start of the last audio block
+struct CJUCETRACKTION_API TransportSnapshot
+{
+  bool isPlaying = false;
+  bool isLooping = false;
+  /// Timeline position in samples at sampleRate, and in seconds
+  int64_t samplePosition = 0;
+  double seconds = 0.0;
+  /// Beats since the start of the timeline, and the zero-based bar and beats into it
+  double beats = 0.0;
+  int bar = 0;
+  double beatInBar = 0.0;
+  double bpm = 120.0;
+  int timeSigNumerator = 4;
+  int timeSigDenominator = 4;
+  double loopStartSeconds = 0.0;
+  double loopEndSeconds = 0.0;
+  double sampleRate = 0.0;
+  /// Monotonic host time of the block in nanoseconds; while playing, extrapolate the
+  /// position from it rather than waiting for the next block
+  int64_t hostTimeNs = 0;
+  /// Blocks published so far, 0 until audio has run
+  int64_t blockCount = 0;
+} SWIFT_SELF_CONTAINED;
+
+/// Publishes a TransportSnapshot on every audio block through a seqlock, so UI playheads
+/// can poll it from any thread without locks or message-thread hops. The audio-thread
+/// side is a TransportProbePlugin at the head of the master chain. The tempo map and loop
+/// range it needs are copied on the message thread whenever they change and handed over
+/// through an atomic pointer that the message thread only frees once the audio thread
+/// has moved on.
+class TransportProbe : private juce::ValueTree::Listener,
+                       private juce::AsyncUpdater
+{
+public:
+  explicit TransportProbe(te::Engine &engine);
+  ~TransportProbe() override;
+
+  /// The probe for an engine created by AudioEngine, or nullptr
+  static TransportProbe *get(te::Engine &engine);
+
+  /// Adds the probe plugin to the edit's master chain unless it's already there, and
+  /// follows the edit's tempo map and loop range. Detach before the edit is deleted.
+  void attach(te::Edit &edit);
+  void detach();
+
+  /// Lock-free, from any thread
+  TransportSnapshot read() const;
+
+  /// Audio thread: publishes the state for a block starting at position
+  void publish(te::TimePosition position, bool isPlaying, double sampleRate);
+
+private:
+  struct Timeline
+  {
+    te::tempo::Sequence sequence;
+    bool looping;
+    te::TimeRange loopRange;
+  };
+
+  void handleAsyncUpdate() override;
+  void freeRetiredTimelines();
+  void write(const TransportSnapshot &snapshot);
+
+  void valueTreePropertyChanged(juce::ValueTree &, const juce::Identifier &) override;
+  void valueTreeChildAdded(juce::ValueTree &, juce::ValueTree &) override;
+  void valueTreeChildRemoved(juce::ValueTree &, juce::ValueTree &, int) override;
+
+  te::Engine &engine;
+  te::Edit *edit = nullptr;
+
+  // The newest timeline is published; older ones wait until the audio thread isn't using them
+  std::vector<std::unique_ptr<Timeline>> timelines;
+  std::atomic<Timeline *> timeline{nullptr};
+  std::atomic<Timeline *> timelineInUse{nullptr};
+  int64_t blockCount = 0;
+
+  // The snapshot stored as atomic words, guarded by an odd/even sequence number
+  static constexpr size_t numWords = (sizeof(TransportSnapshot) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+  std::atomic<uint32_t> sequence{0};
+  std::array<std::atomic<uint64_t>, numWords> words{};
+};
+
+/// Pass-through master plugin that feeds the engine's TransportProbe from the audio thread
+class TransportProbePlugin : public te::Plugin
+{
+public:
+  TransportProbePlugin(te::PluginCreationInfo info);
+  ~TransportProbePlugin() override;
+
+  static const char *getPluginName() { return "Transport Probe"; }
+  static const char *xmlTypeName;
+
+  juce::String getName() const override { return getPluginName(); }
+  juce::String getPluginType() override { return xmlTypeName; }
+  juce::String getShortName(int) override { return "Probe"; }
+  juce::String getSelectableDescription() override { return getName(); }
+  bool needsConstantBufferSize() override { return false; }
+
+  bool takesMidiInput() override { return false; }
+  bool takesAudioInput() override { return true; }
+  bool producesAudioWhenNoAudioInput() override { return false; }
+  int getNumOutputChannelsGivenInputs(int numInputChannels) override { return numInputChannels; }
+
+  void initialise(const te::PluginInitialisationInfo &) override;
+  void deinitialise() override {}
+  void applyToBuffer(const te::PluginRenderContext &) override;
+
+private:
+  TransportProbe *const probe;
+  double sampleRate = 44100.0;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TransportProbePlugin)
+};
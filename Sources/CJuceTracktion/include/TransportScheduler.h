@@ -0,0 +1,147 @@
+#pragma once
+
+#include "EngineHelpers.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <tracktion_engine/tracktion_engine.h>
+
+/// Starts and stops the transport on an exact device sample, given either as a host time
+/// (nanoseconds on the juce::Time high-resolution clock, the clock CoreAudio stamps its
+/// blocks with) or as a position in the device's sample stream.
+///
+/// Commands are made on the audio thread, between device blocks, by moving the playback
+/// context's play head directly, as LoopSwitcher does. A play head can only start or stop
+/// on a block boundary, so a TransportGatePlugin at the head of the master chain silences
+/// the part of the block before a start or after a stop: a start places the play head
+/// offset samples early so the start position lands on the requested sample.
+///
+/// A scheduled start puts the transport into play straight away with its play head held,
+/// so the edit reports playing from then on; the play head itself doesn't move until the
+/// requested sample.
+class TransportScheduler : private juce::AudioIODeviceCallback,
+                           private juce::AsyncUpdater
+{
+public:
+  /// Create after the engine's device callback (and any RealtimeSafetyChecker) so this
+  /// callback runs once each block has been played
+  explicit TransportScheduler(te::Engine &engine);
+  ~TransportScheduler() override;
+
+  /// The scheduler for an engine created by AudioEngine, or nullptr
+  static TransportScheduler *get(te::Engine &engine);
+
+  /// Adds the gate plugin to the edit's master chain unless it's already there. Detach
+  /// before the edit is deleted; pending commands are cancelled.
+  void attach(te::Edit &edit);
+  void detach();
+
+  /// Starts from the current transport position at a host time or device sample. Fails
+  /// when the transport is already playing or the target is less than lookaheadSeconds
+  /// (and never less than two device blocks) away.
+  bool startAt(int64_t target, bool isHostTime, double lookaheadSeconds);
+  /// Stops at a host time or device sample, leaving the position on the stopping sample
+  bool stopAt(int64_t target, bool isHostTime, double lookaheadSeconds);
+  /// Once this returns the audio thread no longer refers to the context's play head, so
+  /// call it before anything frees the playback context
+  void cancel();
+  bool isPending() const { return start.state != idle || stop.state != idle; }
+
+  /// Device sample the next block starts at, counted since the device started
+  int64_t getDeviceSamplePosition() const { return streamPosition.load(); }
+  static int64_t getHostTimeNs();
+
+  /// Audio thread: silences the parts of the current device block the transport isn't
+  /// meant to be heard in. Called by TransportGatePlugin for each part of the block.
+  void applyGate(juce::AudioBuffer<float> &buffer, int startSample, int numSamples);
+
+private:
+  enum State
+  {
+    idle,
+    armed,
+    fired
+  };
+
+  enum Gate
+  {
+    open,
+    closed,       // start armed: anything the held play head lets through is muted
+    openAtOffset, // muted before gateOffset in this block
+    closeAtOffset // muted from gateOffset in this block
+  };
+
+  struct Command
+  {
+    std::atomic<int> state{idle};
+    // Written before state is armed, read by the audio thread once it sees it armed
+    int64_t target = 0;
+    bool isHostTime = false;
+  };
+
+  void audioDeviceIOCallbackWithContext(const float *const *, int, float *const *outputChannelData,
+                                        int numOutputChannels, int numSamples,
+                                        const juce::AudioIODeviceCallbackContext &) override;
+  void audioDeviceAboutToStart(juce::AudioIODevice *) override;
+  void audioDeviceStopped() override {}
+
+  // Brings the transport in line with commands the audio thread has made
+  void handleAsyncUpdate() override;
+
+  bool checkTarget(int64_t target, bool isHostTime, double lookaheadSeconds) const;
+  static void arm(Command &command, int64_t target, bool isHostTime);
+  // Device sample a target falls on, given the host time and first sample of this block
+  int64_t toDeviceSample(const Command &command, int64_t blockHostTimeNs, int64_t blockStart) const;
+
+  te::Engine &engine;
+  te::Edit *edit = nullptr;
+
+  Command start, stop;
+  std::atomic<te::graph::PlayHead *> playHead{nullptr};
+  // Timeline sample the play head starts from, and the one it stopped on
+  std::atomic<int64_t> startPosition{0}, stopPosition{0};
+  // The stop falls inside the block being played; the play head stops after it
+  std::atomic<bool> stopAfterBlock{false};
+
+  std::atomic<int64_t> streamPosition{0};
+  std::atomic<double> sampleRate{0.0};
+
+  std::atomic<int> gate{open};
+  std::atomic<int> gateOffset{0};
+  // Samples of the current device block gated so far, reset after each block
+  std::atomic<int> gatedSamples{0};
+
+  std::unique_ptr<te::TransportControl::ReallocationInhibitor> inhibitor;
+};
+
+/// Pass-through master plugin through which the engine's TransportScheduler mutes the
+/// partial blocks around scheduled starts and stops
+class TransportGatePlugin : public te::Plugin
+{
+public:
+  TransportGatePlugin(te::PluginCreationInfo info);
+  ~TransportGatePlugin() override;
+
+  static const char *getPluginName() { return "Transport Gate"; }
+  static const char *xmlTypeName;
+
+  juce::String getName() const override { return getPluginName(); }
+  juce::String getPluginType() override { return xmlTypeName; }
+  juce::String getShortName(int) override { return "Gate"; }
+  juce::String getSelectableDescription() override { return getName(); }
+  bool needsConstantBufferSize() override { return false; }
+
+  bool takesMidiInput() override { return false; }
+  bool takesAudioInput() override { return true; }
+  bool producesAudioWhenNoAudioInput() override { return false; }
+  int getNumOutputChannelsGivenInputs(int numInputChannels) override { return numInputChannels; }
+
+  void initialise(const te::PluginInitialisationInfo &) override {}
+  void deinitialise() override {}
+  void applyToBuffer(const te::PluginRenderContext &) override;
+
+private:
+  TransportScheduler *const scheduler;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TransportGatePlugin)
+};
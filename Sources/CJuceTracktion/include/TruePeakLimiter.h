@@ -0,0 +1,66 @@
+#pragma once
+
+#include "EngineHelpers.h"
+#include <array>
+#include <tracktion_engine/tracktion_engine.h>
+#include <vector>
+
+/// Estimates inter-sample peaks with 4x polyphase windowed-sinc interpolation, as in
+/// ITU-R BS.1770 Annex 2. One instance per channel.
+class TruePeakDetector
+{
+public:
+  static constexpr int oversampling = 4;
+  static constexpr int tapsPerPhase = 12;
+  /// Input samples between a sample arriving and its interpolated neighbourhood being reported
+  static constexpr int latency = tapsPerPhase / 2;
+
+  TruePeakDetector();
+
+  void reset();
+  /// Returns the largest absolute value among the interpolated points for this input sample
+  float processSample(float x);
+
+private:
+  std::array<float, oversampling * tapsPerPhase> coefficients{};
+  std::array<float, tapsPerPhase> history{};
+  int position = 0;
+};
+
+/// Lookahead brickwall limiter driven by true-peak detection, for offline rendering.
+/// Gain is the minimum required over the lookahead window, smoothed by a box filter of
+/// the same length so it has fully settled when the peak reaches the output, then
+/// released with a one-pole curve. Channels share one gain.
+class TruePeakLimiter
+{
+public:
+  void prepare(double sampleRate, int numChannels, float ceilingDb, double lookaheadMs = 1.5, double releaseMs = 50.0);
+
+  /// Output is delayed by this many samples
+  int getLatencySamples() const { return latency; }
+
+  /// Processes in place
+  void process(juce::AudioBuffer<float> &buffer, int numSamples);
+
+private:
+  float ceiling = 1.0f;
+  int window = 1;
+  int latency = 0;
+  double releaseCoefficient = 0.0;
+
+  std::vector<TruePeakDetector> detectors;
+  std::vector<std::vector<float>> delayLines;
+  int delayPosition = 0;
+
+  // Sliding-window minimum as a monotonic queue in fixed ring storage
+  std::vector<juce::int64> minIndex;
+  std::vector<float> minValue;
+  int minHead = 0, minSize = 0;
+  juce::int64 sampleIndex = 0;
+
+  std::vector<float> boxRing;
+  double boxSum = 0.0;
+  int boxPosition = 0;
+
+  float gain = 1.0f;
+};
@@ -10,6 +10,22 @@ public class AudioEngineManager: ObservableObject {
         cxxEngine = AudioEngine.create(std.string(name))
     }
 
+    /// Creates an engine whose graph processing uses `audioThreads` worker CPUs (0 = engine default)
+    /// `inMemoryProject` defaults to true for headless processes (see AudioEngineOptions)
+    /// `realtimeSafetyChecks` only has an effect in builds with SWIFTTRACKTIONKIT_REALTIME_CHECKS=1
+    public init(name: String, audioThreads: Int, threadPoolStrategy: Int = -1, preResampleSamples: Bool = false,
+                inMemoryProject: Bool? = nil, realtimeSafetyChecks: Bool = false) {
+        var options = AudioEngineOptions()
+        options.numAudioThreads = Int32(audioThreads)
+        options.threadPoolStrategy = Int32(threadPoolStrategy)
+        options.preResampleSamples = preResampleSamples
+        options.realtimeSafetyChecks = realtimeSafetyChecks
+        if let inMemoryProject {
+            options.inMemoryProject = inMemoryProject
+        }
+        cxxEngine = AudioEngine.create(std.string(name), options: options)
+    }
+
     public func start() {
         cxxEngine.start()
         isPlaying = true
@@ -20,11 +36,155 @@ public class AudioEngineManager: ObservableObject {
         isPlaying = false
     }
 
+    /// Starts exactly at a host time in nanoseconds (see `hostTimeNs`), for sync with other
+    /// engines and external clocks. The target must be at least `lookahead` seconds away.
+    @discardableResult
+    public func start(atHostTime hostTimeNs: Int64, lookahead: Double = 0.05) -> Bool {
+        let scheduled = cxxEngine.start(atHostTime: hostTimeNs, lookahead: lookahead)
+        if scheduled {
+            isPlaying = true
+        }
+        return scheduled
+    }
+
+    /// Starts exactly on a device sample (see `deviceSamplePosition`)
+    @discardableResult
+    public func start(atSample deviceSample: Int64, lookahead: Double = 0.05) -> Bool {
+        let scheduled = cxxEngine.start(atSample: deviceSample, lookahead: lookahead)
+        if scheduled {
+            isPlaying = true
+        }
+        return scheduled
+    }
+
+    /// Stops exactly at a host time in nanoseconds, leaving the position on that sample
+    @discardableResult
+    public func stop(atHostTime hostTimeNs: Int64, lookahead: Double = 0.05) -> Bool {
+        return cxxEngine.stop(atHostTime: hostTimeNs, lookahead: lookahead)
+    }
+
+    @discardableResult
+    public func stop(atSample deviceSample: Int64, lookahead: Double = 0.05) -> Bool {
+        return cxxEngine.stop(atSample: deviceSample, lookahead: lookahead)
+    }
+
+    public func cancelScheduledTransport() {
+        cxxEngine.cancelScheduledTransport()
+        isPlaying = cxxEngine.isPlaying
+    }
+
+    public var hasScheduledTransport: Bool {
+        cxxEngine.hasScheduledTransport
+    }
+
+    /// Device sample the next audio block starts at, counted since the device started
+    public var deviceSamplePosition: Int64 {
+        cxxEngine.deviceSamplePosition
+    }
+
+    /// Monotonic host clock in nanoseconds that scheduled starts and stops use
+    public var hostTimeNs: Int64 {
+        cxxEngine.hostTimeNs
+    }
+
     public func setTempo(_ bpm: Double) {
         cxxEngine.tempo = bpm
         tempo = bpm
     }
 
+    /// Switches to a new loop range at the end of the current loop (`quantizeBeats` 0) or on
+    /// the next multiple of `quantizeBeats` without stopping playback. A range that starts
+    /// later than the play head switches at the start of the audio block, not on the sample.
+    @discardableResult
+    public func queueLoop(start: Double, end: Double, quantizeBeats: Double = 0) -> Bool {
+        return cxxEngine.queueLoopRange(start: start, end: end, quantiseBeats: quantizeBeats)
+    }
+
+    public func cancelQueuedLoop() {
+        cxxEngine.cancelQueuedLoopRange()
+    }
+
+    public var hasQueuedLoop: Bool {
+        cxxEngine.hasQueuedLoopRange
+    }
+
+    /// Records all MIDI inputs into a clip (a `MidiClipManagerWrapper` clip ID) while the
+    /// transport plays; `incremental` merges notes into the clip as they're played
+    @discardableResult
+    public func startMidiRecording(clipID: Int32, incremental: Bool = true) -> Bool {
+        return cxxEngine.startMidiRecording(clipID: clipID, incremental: incremental)
+    }
+
+    /// Ends the take, returning the number of notes recorded
+    @discardableResult
+    public func stopMidiRecording() -> Int {
+        return Int(cxxEngine.stopMidiRecording())
+    }
+
+    public var isRecordingMidi: Bool {
+        cxxEngine.isRecordingMidi
+    }
+
+    public var midiRecordingCounts: MidiRecordingCounts {
+        MidiRecordingCounts(cxxEngine.midiRecordingStats)
+    }
+
+    public func resetMidiRecordingCounts() {
+        cxxEngine.resetMidiRecordingStats()
+    }
+
+    /// Virtual MIDI input (channels 1-16) for recording without devices. `atSeconds` places the
+    /// message on the timeline; nil stamps it from the playing transport like live input.
+    public func sendVirtualNoteOn(channel: Int32 = 1, noteNumber: Int32, velocity: Int32, atSeconds: Double? = nil) {
+        cxxEngine.sendVirtualNoteOn(channel: channel, noteNumber: noteNumber, velocity: velocity, atSeconds: atSeconds ?? -1)
+    }
+
+    public func sendVirtualNoteOff(channel: Int32 = 1, noteNumber: Int32, atSeconds: Double? = nil) {
+        cxxEngine.sendVirtualNoteOff(channel: channel, noteNumber: noteNumber, atSeconds: atSeconds ?? -1)
+    }
+
+    public func sendVirtualController(channel: Int32 = 1, controller: Int32, value: Int32, atSeconds: Double? = nil) {
+        cxxEngine.sendVirtualController(channel: channel, controller: controller, value: value, atSeconds: atSeconds ?? -1)
+    }
+
+    /// Timing of the playback graph rebuilds after batches that added or removed tracks, clips or plugins
+    public var graphRebuildTimes: GraphRebuildTimes {
+        GraphRebuildTimes(cxxEngine.graphRebuildStats)
+    }
+
+    public func resetGraphRebuildStats() {
+        cxxEngine.resetGraphRebuildStats()
+    }
+
+    /// True when the audio callback is being checked for allocations, locks and blocking calls
+    public var isCheckingRealtimeSafety: Bool {
+        cxxEngine.isCheckingRealtimeSafety
+    }
+
+    /// Realtime-safety violations in the audio callback since the last reset
+    public var realtimeViolations: RealtimeViolationCounts {
+        RealtimeViolationCounts(cxxEngine.realtimeViolations)
+    }
+
+    public func resetRealtimeViolations() {
+        cxxEngine.resetRealtimeViolations()
+    }
+
+    /// Memory by subsystem and the process's resident size; cheap enough to poll every few seconds
+    public var memoryUsage: MemoryUsage {
+        MemoryUsage(cxxEngine.memoryReport)
+    }
+
+    /// Transport state as of the last audio block; lock-free, so a playhead can poll it every frame
+    public var playhead: PlayheadState {
+        PlayheadState(cxxEngine.transportSnapshot)
+    }
+
+    /// Tempo-synced clips still stretching live while their proxy renders in the background
+    public var pendingStretchProxies: Int {
+        Int(cxxEngine.pendingStretchProxies)
+    }
+
     public func exportAudio(to url: URL) {
         DispatchQueue.main.async { [weak self] in
             self?.cxxEngine.exportAudio(to: std.string(url.path)) { progress in
@@ -33,6 +193,76 @@ public class AudioEngineManager: ObservableObject {
         }
     }
 
+    /// Renders segments of the timeline in parallel (`chunks` 0 = one per CPU), each with
+    /// `preRoll` seconds of lead-in, and joins them sample-exactly. Scales with core count on long edits.
+    @discardableResult
+    public func exportAudio(to url: URL, chunks: Int, preRoll: Double = 2.0) -> Bool {
+        return cxxEngine.exportAudioChunked(to: std.string(url.path), numChunks: Int32(chunks),
+                                            preRollSeconds: preRoll) { progress in
+            print("Export progress: \(progress)")
+        }
+    }
+
+    /// Exports normalised to `targetLufs` integrated loudness with a true-peak ceiling.
+    /// The analysis pass is skipped when the edit is unchanged since the last export.
+    @discardableResult
+    public func exportNormalizedAudio(to url: URL, targetLufs: Double = -14, truePeakCeiling: Double = -1) -> Bool {
+        return cxxEngine.exportNormalisedAudio(to: std.string(url.path), targetLufs: targetLufs,
+                                               truePeakCeilingDb: truePeakCeiling) { progress in
+            print("Export progress: \(progress)")
+        }
+    }
+
+    /// Renders once and writes every format in parallel. Returns the number of files written.
+    @discardableResult
+    public func exportAudio(formats: [ExportFormat]) -> Int {
+        var builder = ExportBuilder()
+        for format in formats {
+            builder.addTarget(filePath: std.string(format.url.path), bitDepth: Int32(format.bitDepth),
+                              dither: format.dither, sampleRate: format.sampleRate, quality: Int32(format.quality))
+        }
+        return Int(cxxEngine.exportAudioFormats(builder: builder) { progress in
+            print("Export progress: \(progress)")
+        })
+    }
+
+    /// Saves the edit as a compact binary snapshot
+    @discardableResult
+    public func saveSnapshot(to url: URL, compressed: Bool = true) -> Bool {
+        return cxxEngine.saveSnapshot(to: std.string(url.path), compress: compressed)
+    }
+
+    /// Replaces the edit with a saved snapshot. Managers created earlier carry on with the
+    /// new edit; fails while one of them is batching or recording.
+    @discardableResult
+    public func loadSnapshot(from url: URL) -> Bool {
+        guard cxxEngine.loadSnapshot(from: std.string(url.path)) else { return false }
+        isPlaying = false
+        tempo = cxxEngine.tempo
+        return true
+    }
+
+    /// Journals every edit change into `directory` on a background thread, compacting
+    /// into a snapshot as the journal grows. An earlier session's files are moved into
+    /// `directory/previous-session`, where `recoverAutosave` can still find them.
+    @discardableResult
+    public func enableAutosave(directory: URL, interval: TimeInterval = 2) -> Bool {
+        return cxxEngine.enableAutosave(directory: std.string(directory.path), intervalMs: Int32(interval * 1000))
+    }
+
+    public func disableAutosave() {
+        cxxEngine.disableAutosave()
+    }
+
+    /// Restores the edit from an autosave directory after a crash. Managers follow the new edit.
+    @discardableResult
+    public func recoverAutosave(directory: URL) -> Bool {
+        guard cxxEngine.recoverAutosave(directory: std.string(directory.path)) else { return false }
+        isPlaying = false
+        tempo = cxxEngine.tempo
+        return true
+    }
+
     public func getEdit() -> OpaquePointer? {
         return cxxEngine.getEdit()
     }
@@ -56,4 +286,214 @@ public class AudioEngineManager: ObservableObject {
         }
         return MidiClipManagerWrapper(cxxMidiClipManager: cxxMidiClipManager)
     }
+
+    public var audioThreads: Int {
+        get { Int(cxxEngine.numAudioThreads) }
+        set { cxxEngine.setNumAudioThreads(Int32(newValue)) }
+    }
+
+    /// Converts samples and audio clips loaded from now on to the device rate up front
+    public var preResampleSamples: Bool {
+        get { cxxEngine.isPreResamplingSamples }
+        set { cxxEngine.setPreResampleSamples(newValue) }
+    }
+
+    /// True when the engine writes no temp project, resample cache or stretch proxy files. Freezing,
+    /// exports and recordings without a directory still use the engine's temp directory.
+    public var isInMemoryProject: Bool {
+        return cxxEngine.isInMemoryProject
+    }
+
+    public var cpuUsage: Double {
+        return cxxEngine.cpuUsage
+    }
+
+    /// Per-track plugin chain load, heaviest track first
+    public func trackCpuUsage() -> [TrackLoad] {
+        let usage = cxxEngine.getTrackCpuUsage()
+        return (0..<usage.size()).map { index in
+            let entry = usage[index]
+            return TrackLoad(trackID: entry.trackID, numPlugins: Int(entry.numPlugins), cpuUsage: entry.cpuUsage)
+        }
+    }
+
+    /// Master output levels. Lock-free and never changes the edit.
+    public func masterMeter() -> MeterLevels {
+        return MeterLevels(cxxEngine.getMasterMeter())
+    }
+
+    /// Post-fader levels of a track created through a `TrackManager`. Lock-free and never
+    /// changes the edit.
+    public func trackMeter(trackID: Int32) -> MeterLevels {
+        return MeterLevels(cxxEngine.getTrackMeter(trackID: trackID))
+    }
+
+    /// Restarts integrated loudness on all meters
+    public func resetLoudness() {
+        cxxEngine.resetLoudness()
+    }
+}
+
+public struct TrackLoad {
+    public let trackID: Int32
+    public let numPlugins: Int
+    public let cpuUsage: Double
+}
+
+/// Durations in milliseconds of the playback graph rebuilds made after edits
+public struct GraphRebuildTimes {
+    public let count: Int
+    public let lastMs: Double
+    public let maxMs: Double
+    public let averageMs: Double
+
+    init(_ stats: GraphRebuildStats) {
+        count = Int(stats.count)
+        lastMs = stats.lastMs
+        maxMs = stats.maxMs
+        averageMs = stats.averageMs
+    }
+}
+
+/// Calls made in the audio callback that can block or allocate; all zero on a realtime-safe path
+public struct RealtimeViolationCounts {
+    public let allocations: Int64
+    public let deallocations: Int64
+    public let locks: Int64
+    public let blockingCalls: Int64
+    /// Counted, but printed without a stack trace because the report queue was full
+    public let unreported: Int64
+
+    init(_ violations: RealtimeViolations) {
+        allocations = violations.allocations
+        deallocations = violations.deallocations
+        locks = violations.locks
+        blockingCalls = violations.blockingCalls
+        unreported = violations.unreported
+    }
+}
+
+/// MIDI recording counters since the last reset
+public struct MidiRecordingCounts {
+    public let eventsReceived: Int64
+    /// Events lost to a full queue
+    public let eventsDropped: Int64
+    public let notesRecorded: Int64
+    public let controllersRecorded: Int64
+
+    init(_ stats: MidiRecordingStats) {
+        eventsReceived = stats.eventsReceived
+        eventsDropped = stats.eventsDropped
+        notesRecorded = stats.notesRecorded
+        controllersRecorded = stats.controllersRecorded
+    }
+}
+
+/// Bytes held per subsystem. All but `resident` are computed from object sizes, and `other`
+/// is the resident memory not attributed to any of them.
+public struct MemoryUsage {
+    public let samplerSamples: Int64
+    public let sampleCache: Int64
+    public let audioFileCache: Int64
+    public let undoHistory: Int64
+    public let editState: Int64
+    public let playbackBuffers: Int64
+    public let pluginInstances: Int64
+    public let numPlugins: Int
+    public let resident: Int64
+    public let other: Int64
+
+    init(_ report: MemoryReport) {
+        samplerSamples = report.samplerSampleBytes
+        sampleCache = report.sampleCacheBytes
+        audioFileCache = report.audioFileCacheBytes
+        undoHistory = report.undoHistoryBytes
+        editState = report.editStateBytes
+        playbackBuffers = report.playbackBufferBytes
+        pluginInstances = report.pluginInstanceBytes
+        numPlugins = Int(report.numPlugins)
+        resident = report.residentBytes
+        other = report.otherBytes
+    }
+}
+
+/// Transport position, tempo and loop at the start of the last audio block. While playing,
+/// advance `seconds` by the time elapsed since `hostTimeNs` for a smooth playhead.
+public struct PlayheadState {
+    public let isPlaying: Bool
+    public let isLooping: Bool
+    public let samplePosition: Int64
+    public let seconds: Double
+    public let beats: Double
+    /// Zero-based bar, and the beats into it
+    public let bar: Int
+    public let beatInBar: Double
+    public let bpm: Double
+    public let timeSigNumerator: Int
+    public let timeSigDenominator: Int
+    public let loopStartSeconds: Double
+    public let loopEndSeconds: Double
+    public let sampleRate: Double
+    /// Monotonic host time of the block, in nanoseconds
+    public let hostTimeNs: Int64
+    /// Audio blocks published so far; 0 until the device has run
+    public let blockCount: Int64
+
+    init(_ snapshot: TransportSnapshot) {
+        isPlaying = snapshot.isPlaying
+        isLooping = snapshot.isLooping
+        samplePosition = snapshot.samplePosition
+        seconds = snapshot.seconds
+        beats = snapshot.beats
+        bar = Int(snapshot.bar)
+        beatInBar = snapshot.beatInBar
+        bpm = snapshot.bpm
+        timeSigNumerator = Int(snapshot.timeSigNumerator)
+        timeSigDenominator = Int(snapshot.timeSigDenominator)
+        loopStartSeconds = snapshot.loopStartSeconds
+        loopEndSeconds = snapshot.loopEndSeconds
+        sampleRate = snapshot.sampleRate
+        hostTimeNs = snapshot.hostTimeNs
+        blockCount = snapshot.blockCount
+    }
+}
+
+/// Peak/RMS in dBFS over the last 100 ms and loudness in LUFS; silence reads as -100
+public struct MeterLevels {
+    public let peakLeft: Float
+    public let peakRight: Float
+    public let rmsLeft: Float
+    public let rmsRight: Float
+    public let momentaryLufs: Float
+    public let shortTermLufs: Float
+    public let integratedLufs: Float
+
+    init(_ reading: MeterReading) {
+        peakLeft = reading.peakLeft
+        peakRight = reading.peakRight
+        rmsLeft = reading.rmsLeft
+        rmsRight = reading.rmsRight
+        momentaryLufs = reading.momentaryLufs
+        shortTermLufs = reading.shortTermLufs
+        integratedLufs = reading.integratedLufs
+    }
+}
+
+/// One deliverable for `exportAudio(formats:)`; the file extension picks the encoder
+public struct ExportFormat {
+    public let url: URL
+    public let bitDepth: Int
+    public let dither: Bool
+    /// 0 keeps the engine's rate
+    public let sampleRate: Double
+    /// Encoder quality option index, e.g. Ogg bitrate (-1 = default)
+    public let quality: Int
+
+    public init(url: URL, bitDepth: Int = 24, dither: Bool = false, sampleRate: Double = 0, quality: Int = -1) {
+        self.url = url
+        self.bitDepth = bitDepth
+        self.dither = dither
+        self.sampleRate = sampleRate
+        self.quality = quality
+    }
 }
@@ -67,4 +67,11 @@ public class MidiClipManagerWrapper {
         }
         return notes
     }
+
+    /// Applies every clip and note change made in `body` with a single playback graph rebuild.
+    public func performBatch(_ body: () -> Void) {
+        cxxMidiClipManager.beginBatch()
+        body()
+        cxxMidiClipManager.commitBatch()
+    }
 }
@@ -1,28 +1,45 @@
 public struct Sample {
     public let filePath: String
     public let noteNumber: Int
+    /// Samples sharing a non-zero choke group cut each other off (high-performance mode only)
+    public let chokeGroup: Int
 
     public init(
         filePath: String,
-        noteNumber: Int
+        noteNumber: Int,
+        chokeGroup: Int = 0
     ) {
         self.filePath = filePath
         self.noteNumber = noteNumber
+        self.chokeGroup = chokeGroup
     }
 }
 
+public enum SamplerMode {
+    /// Tracktion's built-in sampler
+    case standard
+    /// Preallocated voices, vectorised mixing, choke groups and a polyphony limit
+    case highPerformance
+}
+
 public struct SamplerPluginConfig {
     public let name: String
     public let trackID: Int
     public let samples: [Sample]
+    public let mode: SamplerMode
+    public let maxPolyphony: Int
 
     public init(
         name: String,
         trackID: Int,
-        samples: [Sample]
+        samples: [Sample],
+        mode: SamplerMode = .standard,
+        maxPolyphony: Int = 32
     ) {
         self.name = name
         self.trackID = trackID
         self.samples = samples
+        self.mode = mode
+        self.maxPolyphony = maxPolyphony
     }
 }
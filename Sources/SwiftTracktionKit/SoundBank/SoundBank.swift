@@ -1,3 +1,4 @@
+@_implementationOnly import CJuceTracktion
 import Foundation
 
 public struct SoundBank {
@@ -8,4 +9,20 @@ public struct SoundBank {
         self.name = name
         self.presetURL = presetURL
     }
+
+    /// Adds the preset file to the shared registry under `name`; it is parsed once, on
+    /// first use or by `prewarm()`, and reused for every plugin created from it.
+    @discardableResult
+    public func register() -> Bool {
+        guard let presetURL else { return false }
+        return PresetRegistry.registerPreset(name: std.string(name), filePath: std.string(presetURL.path))
+    }
+
+    /// Registers the banks and parses them on a background thread, ready for browsing
+    public static func prewarm(_ banks: [SoundBank]) {
+        for bank in banks {
+            bank.register()
+        }
+        PresetRegistry.prewarm()
+    }
 }
@@ -20,6 +20,13 @@ public class TrackManagerWrapper {
         return cxxTrackManager.addAudioClip(forTrackID: trackID, filePath: std.string(filePath), startBar: startBar, lengthInBars: lengthInBars)
     }
 
+    /// Adds a clip that follows the edit tempo; `sourceBpm` is the file's own tempo
+    public func addAudioClip(forTrackID trackID: Int32, filePath: String, startBar: Double, lengthInBars: Double,
+                             sourceBpm: Double) -> Bool {
+        return cxxTrackManager.addAudioClip(forTrackID: trackID, filePath: std.string(filePath), startBar: startBar,
+                                            lengthInBars: lengthInBars, sourceBpm: sourceBpm)
+    }
+
     public func addMidiClip(forTrackID trackID: Int32, startBar: Double, lengthInBars: Double) -> Int32 {
         return cxxTrackManager.addMidiClip(forTrackID: trackID, startBar: startBar, lengthInBars: lengthInBars)
     }
@@ -27,8 +34,114 @@ public class TrackManagerWrapper {
     public func createSamplerPlugin(config: SamplerPluginConfig) {
         var builder = SamplerPluginBuilder()
         for sample in config.samples {
-            builder.addSample(filePath: std.string(sample.filePath), noteNumber: Int32(sample.noteNumber))
+            builder.addSample(filePath: std.string(sample.filePath), noteNumber: Int32(sample.noteNumber), chokeGroup: Int32(sample.chokeGroup))
+        }
+
+        switch config.mode {
+        case .standard:
+            cxxTrackManager.createSamplerPlugin(trackID: Int32(config.trackID), builder: builder)
+        case .highPerformance:
+            builder.setMaxPolyphony(Int32(config.maxPolyphony))
+            cxxTrackManager.createDrumSamplerPlugin(trackID: Int32(config.trackID), builder: builder)
+        }
+    }
+
+    /// Inserts a plugin set up from a registered preset (built-in "Organ"/"Lead" or a SoundBank)
+    @discardableResult
+    public func createPresetPlugin(trackID: Int32, presetName: String) -> Bool {
+        return cxxTrackManager.createPresetPlugin(trackID: trackID, presetName: std.string(presetName))
+    }
+
+    /// Switches the plugin at `pluginIndex` on each track to the preset, without reparsing it
+    public func applyPreset(_ presetName: String, toTracks trackIDs: [Int32], pluginIndex: Int32 = 0) {
+        let name = std.string(presetName)
+        performBatch {
+            for trackID in trackIDs {
+                _ = cxxTrackManager.applyPreset(trackID: trackID, pluginIndex: pluginIndex, presetName: name)
+            }
         }
-        cxxTrackManager.createSamplerPlugin(trackID: Int32(config.trackID), builder: builder)
+    }
+
+    /// Renders the track to audio in the background and bypasses its DSP until it is edited again.
+    public func freezeTrack(byID trackID: Int32) -> Bool {
+        return cxxTrackManager.freezeTrack(byID: trackID)
+    }
+
+    public func unfreezeTrack(byID trackID: Int32) -> Bool {
+        return cxxTrackManager.unfreezeTrack(byID: trackID)
+    }
+
+    public func isTrackFrozen(byID trackID: Int32) -> Bool {
+        return cxxTrackManager.isTrackFrozen(byID: trackID)
+    }
+
+    /// Arms the track to record `numChannels` (1 or 2) device inputs starting at `firstInputChannel`.
+    /// Fails for inputs that don't exist; set a fake input first to arm against its channels.
+    @discardableResult
+    public func armTrack(byID trackID: Int32, firstInputChannel: Int32 = 0, numChannels: Int32 = 2) -> Bool {
+        return cxxTrackManager.armTrack(byID: trackID, firstInputChannel: firstInputChannel, numChannels: numChannels)
+    }
+
+    @discardableResult
+    public func disarmTrack(byID trackID: Int32) -> Bool {
+        return cxxTrackManager.disarmTrack(byID: trackID)
+    }
+
+    public func isTrackArmed(byID trackID: Int32) -> Bool {
+        return cxxTrackManager.isTrackArmed(byID: trackID)
+    }
+
+    /// Streams the armed tracks' input to WAV files in `directory` (a temp directory when nil)
+    @discardableResult
+    public func startRecording(directory: URL? = nil) -> Bool {
+        return cxxTrackManager.startRecording(directory: std.string(directory?.path ?? ""))
+    }
+
+    /// Finishes the files and adds each take as a clip where recording started, less the device's
+    /// input and output latency; returns the clips added
+    @discardableResult
+    public func stopRecording() -> Int {
+        return Int(cxxTrackManager.stopRecording())
+    }
+
+    public var isRecording: Bool {
+        cxxTrackManager.isRecording
+    }
+
+    /// Disk backlog and dropouts of the current or last recording
+    public var recordingCounts: AudioRecordingCounts {
+        AudioRecordingCounts(cxxTrackManager.recordingStats)
+    }
+
+    /// Records from a file played in real time instead of the audio device; nil goes back to the device
+    @discardableResult
+    public func setFakeRecordingInput(_ url: URL?, loop: Bool = true) -> Bool {
+        return cxxTrackManager.setFakeRecordingInput(filePath: std.string(url?.path ?? ""), loop: loop)
+    }
+
+    /// Applies every structural change made in `body` with a single playback graph rebuild.
+    public func performBatch(_ body: () -> Void) {
+        cxxTrackManager.beginBatch()
+        body()
+        cxxTrackManager.commitBatch()
+    }
+}
+
+/// Audio recording progress. Dropouts are input blocks lost because the disk fell too far behind.
+public struct AudioRecordingCounts {
+    public let samplesWritten: Int64
+    public let dropouts: Int64
+    public let droppedSamples: Int64
+    public let backlogSeconds: Double
+    public let peakBacklogSeconds: Double
+    public let writeErrors: Int64
+
+    init(_ stats: AudioRecordingStats) {
+        samplesWritten = stats.samplesWritten
+        dropouts = stats.dropouts
+        droppedSamples = stats.droppedSamples
+        backlogSeconds = stats.backlogSeconds
+        peakBacklogSeconds = stats.peakBacklogSeconds
+        writeErrors = stats.writeErrors
     }
 }
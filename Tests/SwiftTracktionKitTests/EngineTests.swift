@@ -12,4 +12,30 @@ final class EngineTests: XCTestCase {
         let edit = engine.getEdit()
         XCTAssertNotNil(edit)
     }
+
+    func testBatchedTrackCreation() {
+        let engine = AudioEngineManager(name: "Test")
+        let trackManager = engine.createTrackManager()
+        var trackIDs: [Int32] = []
+        trackManager.performBatch {
+            for index in 0..<200 {
+                trackIDs.append(trackManager.createAudioTrack(name: "Track \(index)"))
+            }
+        }
+        XCTAssertEqual(trackIDs.count, 200)
+        XCTAssertFalse(trackIDs.contains(-1))
+        XCTAssertEqual(Set(trackIDs).count, 200)
+    }
+
+    func testSnapshotRoundTrip() {
+        let engine = AudioEngineManager(name: "Test")
+        engine.setTempo(98)
+        let url = FileManager.default.temporaryDirectory.appendingPathComponent("snapshot-\(UUID().uuidString).stks")
+        defer { try? FileManager.default.removeItem(at: url) }
+
+        XCTAssertTrue(engine.saveSnapshot(to: url))
+        engine.setTempo(140)
+        XCTAssertTrue(engine.loadSnapshot(from: url))
+        XCTAssertEqual(engine.tempo, 98, accuracy: 0.001)
+    }
 }
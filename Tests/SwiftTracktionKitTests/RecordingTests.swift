@@ -0,0 +1,146 @@
+import AVFoundation
+@testable import SwiftTracktionKit
+import XCTest
+
+final class RecordingTests: XCTestCase {
+    func testMidiRecordingOfVirtualNotes() {
+        let engine = AudioEngineManager(name: "Test")
+        engine.setTempo(120)
+        let trackManager = engine.createTrackManager()
+        let clipManager = engine.createMidiClipManager()
+
+        let trackID = trackManager.createAudioTrack(name: "Keys")
+        let clipID = clipManager.createMidiClip(trackID: trackID, name: "Take", startBar: 0, lengthInBars: 1)
+        XCTAssertGreaterThan(clipID, 0)
+        XCTAssertTrue(engine.startMidiRecording(clipID: clipID, incremental: false))
+
+        // At 120 bpm a beat is half a second; the last note runs past the clip's end
+        engine.sendVirtualNoteOn(noteNumber: 60, velocity: 100, atSeconds: 0.0)
+        engine.sendVirtualNoteOff(noteNumber: 60, atSeconds: 0.5)
+        engine.sendVirtualNoteOn(noteNumber: 64, velocity: 90, atSeconds: 1.0)
+        engine.sendVirtualNoteOff(noteNumber: 64, atSeconds: 1.25)
+        engine.sendVirtualNoteOn(noteNumber: 67, velocity: 80, atSeconds: 1.5)
+        engine.sendVirtualNoteOff(noteNumber: 67, atSeconds: 2.5)
+
+        XCTAssertEqual(engine.stopMidiRecording(), 3)
+        XCTAssertEqual(engine.midiRecordingCounts.eventsDropped, 0)
+
+        let notes = clipManager.getNotes(clipID: clipID).sorted { $0.startBeat < $1.startBeat }
+        XCTAssertEqual(notes.map(\.noteNumber), [60, 64, 67])
+        XCTAssertEqual(notes.map(\.velocity), [100, 90, 80])
+
+        let expected: [(start: Double, length: Double)] = [(0, 1), (2, 0.5), (3, 2)]
+        for (note, timing) in zip(notes, expected) {
+            XCTAssertEqual(note.startBeat, timing.start, accuracy: 0.001)
+            XCTAssertEqual(note.lengthInBeats, timing.length, accuracy: 0.001)
+        }
+    }
+
+    func testMidiRecordingOfLiveVirtualNotes() throws {
+        let engine = AudioEngineManager(name: "Test")
+        engine.setTempo(120)
+        let trackManager = engine.createTrackManager()
+        let clipManager = engine.createMidiClipManager()
+
+        let trackID = trackManager.createAudioTrack(name: "Keys")
+        let clipID = clipManager.createMidiClip(trackID: trackID, name: "Take", startBar: 0, lengthInBars: 2)
+        XCTAssertTrue(engine.startMidiRecording(clipID: clipID, incremental: false))
+
+        engine.start()
+        defer { engine.stop() }
+
+        // Without atSeconds the notes are stamped from the playing transport
+        let deadline = Date().addingTimeInterval(2)
+        while !engine.playhead.isPlaying && Date() < deadline {
+            Thread.sleep(forTimeInterval: 0.01)
+        }
+        var playhead = engine.playhead
+        try XCTSkipUnless(playhead.isPlaying, "No audio device is running")
+
+        // Far enough in that the output latency can't wrap the note to the loop's end
+        Thread.sleep(forTimeInterval: 0.2)
+        playhead = engine.playhead
+        let sentAt = playhead.seconds + Double(engine.hostTimeNs - playhead.hostTimeNs) / 1.0e9
+        engine.sendVirtualNoteOn(noteNumber: 62, velocity: 100)
+        Thread.sleep(forTimeInterval: 0.25)
+        engine.sendVirtualNoteOff(noteNumber: 62)
+
+        XCTAssertEqual(engine.stopMidiRecording(), 1)
+
+        let note = try XCTUnwrap(clipManager.getNotes(clipID: clipID).first)
+        XCTAssertEqual(note.noteNumber, 62)
+
+        // Output latency only ever moves a note earlier, and the loop keeps it inside 0-4 s
+        let startSeconds = note.startBeat / 2
+        XCTAssertLessThanOrEqual(startSeconds, sentAt + 0.05)
+        XCTAssertGreaterThanOrEqual(startSeconds, 0)
+        XCTAssertLessThan(startSeconds, playhead.loopEndSeconds)
+
+        // Lengths come from host times, so they don't depend on block boundaries
+        XCTAssertEqual(note.lengthInBeats, 0.5, accuracy: 0.1)
+    }
+
+    func testAudioRecordingFromFakeInput() throws {
+        let directory = FileManager.default.temporaryDirectory.appendingPathComponent("recording-\(UUID().uuidString)")
+        defer { try? FileManager.default.removeItem(at: directory) }
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+
+        // A one-second ramp, so every sample in the loop is distinct
+        let source = (0..<44100).map { Float($0) / 44100 * 0.9 - 0.45 }
+        let input = directory.appendingPathComponent("input.wav")
+        try writeMonoFile(source, to: input)
+
+        let takes = directory.appendingPathComponent("takes")
+        let engine = AudioEngineManager(name: "Test")
+        let trackManager = engine.createTrackManager()
+        let trackID = trackManager.createAudioTrack(name: "Vocal")
+
+        XCTAssertTrue(trackManager.setFakeRecordingInput(input, loop: true))
+        XCTAssertFalse(trackManager.armTrack(byID: trackID, firstInputChannel: 1, numChannels: 1))
+        XCTAssertTrue(trackManager.armTrack(byID: trackID, firstInputChannel: 0, numChannels: 1))
+
+        XCTAssertTrue(trackManager.startRecording(directory: takes))
+        Thread.sleep(forTimeInterval: 0.5)
+        XCTAssertEqual(trackManager.stopRecording(), 1)
+
+        let counts = trackManager.recordingCounts
+        XCTAssertGreaterThan(counts.samplesWritten, 0)
+        XCTAssertEqual(counts.dropouts, 0)
+        XCTAssertEqual(counts.writeErrors, 0)
+
+        let files = try FileManager.default.contentsOfDirectory(at: takes, includingPropertiesForKeys: nil)
+        XCTAssertEqual(files.count, 1)
+        let recorded = try readMonoFile(try XCTUnwrap(files.first))
+        XCTAssertEqual(Int64(recorded.count), counts.samplesWritten)
+
+        // The take starts wherever the looping input had got to, then follows it exactly
+        let offset = try XCTUnwrap(source.indices.min { abs(source[$0] - recorded[0]) < abs(source[$1] - recorded[0]) })
+        for (index, sample) in recorded.enumerated() {
+            XCTAssertEqual(sample, source[(offset + index) % source.count], accuracy: 1.0e-5)
+        }
+    }
+
+    private func writeMonoFile(_ samples: [Float], to url: URL) throws {
+        let format = try XCTUnwrap(AVAudioFormat(standardFormatWithSampleRate: 44100, channels: 1))
+        let buffer = try XCTUnwrap(AVAudioPCMBuffer(pcmFormat: format, frameCapacity: AVAudioFrameCount(samples.count)))
+        buffer.frameLength = buffer.frameCapacity
+        samples.withUnsafeBufferPointer { buffer.floatChannelData![0].update(from: $0.baseAddress!, count: samples.count) }
+
+        let settings: [String: Any] = [
+            AVFormatIDKey: kAudioFormatLinearPCM,
+            AVSampleRateKey: 44100,
+            AVNumberOfChannelsKey: 1,
+            AVLinearPCMBitDepthKey: 32,
+            AVLinearPCMIsFloatKey: true,
+        ]
+        let file = try AVAudioFile(forWriting: url, settings: settings)
+        try file.write(from: buffer)
+    }
+
+    private func readMonoFile(_ url: URL) throws -> [Float] {
+        let file = try AVAudioFile(forReading: url)
+        let buffer = try XCTUnwrap(AVAudioPCMBuffer(pcmFormat: file.processingFormat, frameCapacity: AVAudioFrameCount(file.length)))
+        try file.read(into: buffer)
+        return Array(UnsafeBufferPointer(start: buffer.floatChannelData![0], count: Int(buffer.frameLength)))
+    }
+}